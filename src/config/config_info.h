@@ -13,6 +13,7 @@ struct IniConfigInfo
     struct {
         QString type;  // sqlite or mysql
         QString path;  // for sqlite
+        int max_connections = 8;  // per-thread connections incl. the main one
     } database;
 
     // [MYSQL] section
@@ -24,6 +25,17 @@ struct IniConfigInfo
         QString database;
     } mysql;
 
+    // [SQLITE] section - pragmas applied to every SQLite connection
+    struct {
+        QString journal_mode = "WAL";
+        QString synchronous = "NORMAL";
+        int cache_size_kb = 8192;
+        qint64 mmap_size = 268435456;
+        QString temp_store = "MEMORY";
+        int busy_timeout_ms = 5000;
+        int checkpoint_interval_ms = 30000;     // WAL checkpoint period, 0 = off
+    } sqlite;
+
     // [LOG] section
     struct {
         QString level;
@@ -54,6 +66,24 @@ struct IniConfigInfo
         QString can_type;          // CAN device type
         int can_channel = 0;       // CAN channel
         int can_baudrate = 500000; // CAN baudrate
+        int command_window = 4;         // JF commands awaiting a reply per board
+        int command_timeout_ms = 500;
+        int command_retries = 2;
+        int io_threads = 0;             // JFPlate I/O threads, 0 = one per core
+        QString io_balance = "count";   // count | traffic
+        int max_concurrent_connects = 16;   // boards connecting/logging in at once
+        int reconnect_base_ms = 1000;
+        int reconnect_max_ms = 60000;
+        int connect_timeout_ms = 10000;
+        int ai_filter = 10;             // MoNi samples per filter window, <= 1 = unfiltered
+        QString ai_filter_mode = "average"; // average | median | off
+        int ai_deadband = 0;            // min change (raw units) before a MoNi value is published
+        int do_coalesce_ms = 0;         // DO writes merged per board, 0 = end of event-loop tick
+        bool forward_do = false;        // setValue drives JF DO outputs (setDO layout unconfirmed)
+        int read_interval_ms = 120;     // DI poll period, <= 0 = no polling
+        int poll_min_ms = 60;           // adaptive polling bounds
+        int poll_max_ms = 1000;
+        bool poll_adaptive = true;
         QMap<QString, QString> options;  // Other hardware options
     } hardio;
 
@@ -67,6 +97,45 @@ struct IniConfigInfo
         QMap<int, QString> port_mappings;  // port id -> mapping
     } qjcustom;
 
+    // [Persist] section - write-behind md value persistence
+    struct {
+        QString mode = "journal";           // memory | journal | db (when setValue is acked)
+        QString journal_path = "md_journal.log";
+        int flush_interval_ms = 200;        // batch commit period
+        int max_batch = 1000;               // flush early once this many md ids are pending
+    } persist;
+
+    // [Pipeline] section - MetaManage stage queue depths
+    struct {
+        int parse_queue_depth = 4096;   // receive -> parser
+        int state_queue_depth = 4096;   // parser -> state writer
+        int egress_queue_depth = 1024;  // state writer -> egress
+        int hardware_queue_depth = 65536;  // CAN/JF boards -> state writer, newest dropped when full
+    } pipeline;
+
+    // [Cache] section - warm-start table cache
+    struct {
+        bool enabled = true;
+        QString path = "table_cache.bin";   // relative to the application dir
+    } cache;
+
+    // [History] section - embedded md value history
+    struct {
+        bool enabled = true;
+        QString dir = "history";        // relative to the application dir
+        int ring_size = 256;            // in-memory samples per md id
+        int segment_mb = 16;
+        int retention_hours = 168;
+        int flush_interval_ms = 1000;
+    } history;
+
+    // [Reload] section - automatic reload on database changes
+    struct {
+        bool auto_detect = true;
+        int poll_interval_ms = 5000;
+        int bucket_size = 1024;         // pk_id range covered by one checksum
+    } reload;
+
     // Version and metadata
     QString program_name = "NENet";
     QString version = "V20230918.02";
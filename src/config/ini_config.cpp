@@ -15,6 +15,7 @@ bool IniConfig::loadConfig(const QString& filePath, IniConfigInfo& config)
     settings.beginGroup("DATABASE");
     config.database.type = settings.value("Type", "sqlite").toString();
     config.database.path = settings.value("Path", "nengine.db").toString();
+    config.database.max_connections = settings.value("MaxConnections", 8).toInt();
     settings.endGroup();
 
     // Load MYSQL section
@@ -26,6 +27,17 @@ bool IniConfig::loadConfig(const QString& filePath, IniConfigInfo& config)
     config.mysql.database = settings.value("Database", "nenet").toString();
     settings.endGroup();
 
+    // Load SQLITE section
+    settings.beginGroup("SQLITE");
+    config.sqlite.journal_mode = settings.value("JournalMode", "WAL").toString();
+    config.sqlite.synchronous = settings.value("Synchronous", "NORMAL").toString();
+    config.sqlite.cache_size_kb = settings.value("CacheSizeKB", 8192).toInt();
+    config.sqlite.mmap_size = settings.value("MmapSize", 268435456).toLongLong();
+    config.sqlite.temp_store = settings.value("TempStore", "MEMORY").toString();
+    config.sqlite.busy_timeout_ms = settings.value("BusyTimeoutMs", 5000).toInt();
+    config.sqlite.checkpoint_interval_ms = settings.value("CheckpointIntervalMs", 30000).toInt();
+    settings.endGroup();
+
     // Load LOG section
     settings.beginGroup("LOG");
     config.log.level = settings.value("Level", "INFO").toString();
@@ -85,6 +97,63 @@ bool IniConfig::loadConfig(const QString& filePath, IniConfigInfo& config)
     config.hardio.can_type = settings.value("CAN_Type", "USBCAN").toString();
     config.hardio.can_channel = settings.value("CAN_Channel", 0).toInt();
     config.hardio.can_baudrate = settings.value("CAN_Baudrate", 500000).toInt();
+    config.hardio.command_window = settings.value("CommandWindow", 4).toInt();
+    config.hardio.command_timeout_ms = settings.value("CommandTimeoutMs", 500).toInt();
+    config.hardio.command_retries = settings.value("CommandRetries", 2).toInt();
+    config.hardio.io_threads = settings.value("IoThreads", 0).toInt();
+    config.hardio.io_balance = settings.value("IoBalance", "count").toString();
+    config.hardio.max_concurrent_connects = settings.value("MaxConcurrentConnects", 16).toInt();
+    config.hardio.reconnect_base_ms = settings.value("ReconnectBaseMs", 1000).toInt();
+    config.hardio.reconnect_max_ms = settings.value("ReconnectMaxMs", 60000).toInt();
+    config.hardio.connect_timeout_ms = settings.value("ConnectTimeoutMs", 10000).toInt();
+    config.hardio.ai_filter = settings.value("AIFilter", 10).toInt();
+    config.hardio.ai_filter_mode = settings.value("AIFilterMode", "average").toString();
+    config.hardio.ai_deadband = settings.value("AIDeadband", 0).toInt();
+    config.hardio.do_coalesce_ms = settings.value("DoCoalesceMs", 0).toInt();
+    config.hardio.forward_do = settings.value("ForwardDO", false).toBool();
+    config.hardio.read_interval_ms = settings.value("ReadInterval", 120).toInt();
+    config.hardio.poll_min_ms = settings.value("PollMinMs", 60).toInt();
+    config.hardio.poll_max_ms = settings.value("PollMaxMs", 1000).toInt();
+    config.hardio.poll_adaptive = settings.value("PollAdaptive", true).toBool();
+    settings.endGroup();
+
+    // Load Persist section
+    settings.beginGroup("Persist");
+    config.persist.mode = settings.value("Mode", "journal").toString();
+    config.persist.journal_path = settings.value("JournalPath", "md_journal.log").toString();
+    config.persist.flush_interval_ms = settings.value("FlushIntervalMs", 200).toInt();
+    config.persist.max_batch = settings.value("MaxBatch", 1000).toInt();
+    settings.endGroup();
+
+    // Load Pipeline section
+    settings.beginGroup("Pipeline");
+    config.pipeline.parse_queue_depth = settings.value("ParseQueueDepth", 4096).toInt();
+    config.pipeline.state_queue_depth = settings.value("StateQueueDepth", 4096).toInt();
+    config.pipeline.egress_queue_depth = settings.value("EgressQueueDepth", 1024).toInt();
+    config.pipeline.hardware_queue_depth = settings.value("HardwareQueueDepth", 65536).toInt();
+    settings.endGroup();
+
+    // Load Cache section
+    settings.beginGroup("Cache");
+    config.cache.enabled = settings.value("Enable", true).toBool();
+    config.cache.path = settings.value("Path", "table_cache.bin").toString();
+    settings.endGroup();
+
+    // Load History section
+    settings.beginGroup("History");
+    config.history.enabled = settings.value("Enable", true).toBool();
+    config.history.dir = settings.value("Dir", "history").toString();
+    config.history.ring_size = settings.value("RingSize", 256).toInt();
+    config.history.segment_mb = settings.value("SegmentMB", 16).toInt();
+    config.history.retention_hours = settings.value("RetentionHours", 168).toInt();
+    config.history.flush_interval_ms = settings.value("FlushIntervalMs", 1000).toInt();
+    settings.endGroup();
+
+    // Load Reload section
+    settings.beginGroup("Reload");
+    config.reload.auto_detect = settings.value("AutoDetect", true).toBool();
+    config.reload.poll_interval_ms = settings.value("PollIntervalMs", 5000).toInt();
+    config.reload.bucket_size = settings.value("BucketSize", 1024).toInt();
     settings.endGroup();
 
     return true;
@@ -98,6 +167,7 @@ bool IniConfig::saveConfig(const QString& filePath, const IniConfigInfo& config)
     settings.beginGroup("DATABASE");
     settings.setValue("Type", config.database.type);
     settings.setValue("Path", config.database.path);
+    settings.setValue("MaxConnections", config.database.max_connections);
     settings.endGroup();
 
     // Save MYSQL section
@@ -109,6 +179,17 @@ bool IniConfig::saveConfig(const QString& filePath, const IniConfigInfo& config)
     settings.setValue("Database", config.mysql.database);
     settings.endGroup();
 
+    // Save SQLITE section
+    settings.beginGroup("SQLITE");
+    settings.setValue("JournalMode", config.sqlite.journal_mode);
+    settings.setValue("Synchronous", config.sqlite.synchronous);
+    settings.setValue("CacheSizeKB", config.sqlite.cache_size_kb);
+    settings.setValue("MmapSize", config.sqlite.mmap_size);
+    settings.setValue("TempStore", config.sqlite.temp_store);
+    settings.setValue("BusyTimeoutMs", config.sqlite.busy_timeout_ms);
+    settings.setValue("CheckpointIntervalMs", config.sqlite.checkpoint_interval_ms);
+    settings.endGroup();
+
     // Save LOG section
     settings.beginGroup("LOG");
     settings.setValue("Level", config.log.level);
@@ -0,0 +1,198 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QVector>
+#include <deque>
+#include <utility>
+
+/**
+ * @brief Fixed-capacity multi-producer/multi-consumer queue
+ *
+ * Used between pipeline stages. Producers that must never stall (socket
+ * receive) use tryPush() and account drops; internal stages use push()
+ * which blocks while the queue is full and so propagates backpressure.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(int capacity = 1024)
+        : m_capacity(capacity > 0 ? capacity : 1)
+    {
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * @brief Change capacity (only meaningful before producers start)
+     */
+    void setCapacity(int capacity)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_capacity = capacity > 0 ? capacity : 1;
+    }
+
+    /**
+     * @brief Enqueue without blocking
+     * @return false if the queue is full or closed (item is dropped)
+     */
+    bool tryPush(T item)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_closed || static_cast<int>(m_items.size()) >= m_capacity) {
+            ++m_dropped;
+            return false;
+        }
+        enqueueLocked(std::move(item));
+        return true;
+    }
+
+    /**
+     * @brief Enqueue, waiting while the queue is full
+     * @return false if the queue was closed
+     */
+    bool push(T item)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_closed && static_cast<int>(m_items.size()) >= m_capacity) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_closed) {
+            ++m_dropped;
+            return false;
+        }
+        enqueueLocked(std::move(item));
+        return true;
+    }
+
+    /**
+     * @brief Dequeue one item
+     * @param timeoutMs negative waits forever
+     * @return false on timeout, or when closed and drained
+     */
+    bool pop(T& out, int timeoutMs = -1)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!waitNotEmptyLocked(timeoutMs)) {
+            return false;
+        }
+        out = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    /**
+     * @brief Dequeue everything currently queued (up to maxItems)
+     * @return number of items appended to out
+     */
+    int popAll(QVector<T>& out, int maxItems, int timeoutMs = -1)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!waitNotEmptyLocked(timeoutMs)) {
+            return 0;
+        }
+        int taken = 0;
+        while (!m_items.empty() && taken < maxItems) {
+            out.append(std::move(m_items.front()));
+            m_items.pop_front();
+            ++taken;
+        }
+        m_notFull.wakeAll();
+        return taken;
+    }
+
+    /**
+     * @brief Reject further pushes and wake all waiters
+     */
+    void close()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    /**
+     * @brief Drop queued items and accept pushes again
+     */
+    void reset()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_items.clear();
+        m_closed = false;
+        m_highWatermark = 0;
+        m_dropped = 0;
+    }
+
+    bool isClosed() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_closed;
+    }
+
+    int size() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return static_cast<int>(m_items.size());
+    }
+
+    int capacity() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_capacity;
+    }
+
+    int highWatermark() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_highWatermark;
+    }
+
+    quint64 droppedCount() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_dropped;
+    }
+
+private:
+    void enqueueLocked(T&& item)
+    {
+        m_items.push_back(std::move(item));
+        const int depth = static_cast<int>(m_items.size());
+        if (depth > m_highWatermark) {
+            m_highWatermark = depth;
+        }
+        m_notEmpty.wakeOne();
+    }
+
+    bool waitNotEmptyLocked(int timeoutMs)
+    {
+        while (m_items.empty()) {
+            if (m_closed) {
+                return false;
+            }
+            if (timeoutMs < 0) {
+                m_notEmpty.wait(&m_mutex);
+            } else if (!m_notEmpty.wait(&m_mutex, static_cast<unsigned long>(timeoutMs))) {
+                return !m_items.empty();
+            }
+        }
+        return true;
+    }
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    std::deque<T> m_items;
+    int m_capacity = 1024;
+    int m_highWatermark = 0;
+    quint64 m_dropped = 0;
+    bool m_closed = false;
+};
+
+#endif // BOUNDED_QUEUE_H
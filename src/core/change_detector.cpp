@@ -0,0 +1,196 @@
+#include "change_detector.h"
+#include "meta_manage.h"
+#include "logging/logger.h"
+#include "database/db_queries.h"
+#include <QThread>
+#include <QList>
+#include <QSet>
+#include <algorithm>
+
+ChangeDetector& ChangeDetector::instance()
+{
+    static ChangeDetector s_instance;
+    return s_instance;
+}
+
+ChangeDetector::~ChangeDetector()
+{
+    cleanup();
+}
+
+bool ChangeDetector::captureBaseline(int bucketSize)
+{
+    m_bucketSize = qMax(1, bucketSize);
+
+    // version first: a commit racing the checksums shows up on the first poll
+    m_ownWrites = DBQueries::metadataWriteCount();
+    m_ownWriteSkips = 0;
+    bool settled = true;
+    m_haveVersion = DBQueries::selectDataVersion(m_version, settled);
+    if (!settled) {
+        m_version = kUnsettledVersion;
+    }
+    if (!DBQueries::selectBucketChecksums("ne_plate_type", m_bucketSize, m_plateSums)
+        || !DBQueries::selectBucketChecksums("ne_md_info", m_bucketSize, m_mdSums)) {
+        Logger::instance().warning("Change detection baseline failed, tables will not be watched");
+        m_haveBaseline = false;
+        return false;
+    }
+
+    m_haveBaseline = true;
+    Logger::instance().debug(QString("Change detection baseline: %1 plate / %2 md buckets of %3 ids%4")
+                                 .arg(m_plateSums.size())
+                                 .arg(m_mdSums.size())
+                                 .arg(m_bucketSize)
+                                 .arg(m_haveVersion ? "" : ", no data version (checksum every poll)"));
+    return true;
+}
+
+bool ChangeDetector::start(int pollIntervalMs)
+{
+    if (m_thread) {
+        return true;
+    }
+    if (!m_haveBaseline) {
+        return false;
+    }
+
+    m_pollIntervalMs = qMax(100, pollIntervalMs);
+    m_stopping = false;
+    m_thread = QThread::create([this] { pollLoop(); });
+    m_thread->setObjectName("DbChangeDetector");
+    m_thread->start();
+
+    Logger::instance().info(QString("Watching plate/md tables for changes every %1 ms").arg(m_pollIntervalMs));
+    return true;
+}
+
+void ChangeDetector::cleanup()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    Logger::instance().info("Change detection stopped: " + statsSummary());
+}
+
+QString ChangeDetector::statsSummary() const
+{
+    return QString("changes: polls=%1 checksums=%2 ownWriteDeferrals=%3 detected=%4 failures=%5")
+        .arg(m_polls.load())
+        .arg(m_checksumRuns.load())
+        .arg(m_ownWriteDeferrals.load())
+        .arg(m_changes.load())
+        .arg(m_failures.load());
+}
+
+void ChangeDetector::pollLoop()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopping) {
+        m_wake.wait(&m_mutex, static_cast<unsigned long>(m_pollIntervalMs));
+        if (m_stopping) {
+            break;
+        }
+
+        locker.unlock();
+        poll();
+        locker.relock();
+    }
+}
+
+void ChangeDetector::poll()
+{
+    ++m_polls;
+
+    // Own writes are read first: one committed between the two reads then
+    // looks foreign and costs a checksum run, never a missed edit.
+    const quint64 ownWrites = DBQueries::metadataWriteCount();
+    qint64 version = 0;
+    bool settled = true;
+    const bool haveVersion = DBQueries::selectDataVersion(version, settled);
+    const bool comparable = haveVersion && m_haveVersion;
+    if (comparable && version == m_version && m_ownWriteSkips == 0) {
+        return;
+    }
+
+    // NENet's md value commits move the version too. Defer while they do; a
+    // foreign edit in the same window is caught by the deferred run.
+    if (comparable && version != m_version && ownWrites != m_ownWrites && m_ownWriteSkips < kMaxOwnWriteSkips) {
+        ++m_ownWriteSkips;
+        ++m_ownWriteDeferrals;
+        m_version = settled ? version : kUnsettledVersion;
+        m_ownWrites = ownWrites;
+        return;
+    }
+
+    ++m_checksumRuns;
+    QHash<int, QString> plateSums;
+    QHash<int, QString> mdSums;
+    if (!DBQueries::selectBucketChecksums("ne_plate_type", m_bucketSize, plateSums)
+        || !DBQueries::selectBucketChecksums("ne_md_info", m_bucketSize, mdSums)) {
+        ++m_failures;
+        return;
+    }
+
+    const QVector<QPair<int, int>> plateRanges = changedRanges(m_plateSums, plateSums, m_bucketSize);
+    const QVector<QPair<int, int>> mdRanges = changedRanges(m_mdSums, mdSums, m_bucketSize);
+    if (!plateRanges.isEmpty() || !mdRanges.isEmpty()) {
+        Logger::instance().info(QString("Database change detected: %1 plate / %2 md id ranges, reloading")
+                                    .arg(plateRanges.size())
+                                    .arg(mdRanges.size()));
+        if (!MetaManage::instance().requestPartialReload(plateRanges, mdRanges)) {
+            ++m_failures;
+            return;
+        }
+        ++m_changes;
+        m_plateSums.swap(plateSums);
+        m_mdSums.swap(mdSums);
+    }
+
+    m_haveVersion = haveVersion;
+    m_version = settled ? version : kUnsettledVersion;
+    m_ownWrites = ownWrites;
+    m_ownWriteSkips = 0;
+}
+
+QVector<QPair<int, int>> ChangeDetector::changedRanges(const QHash<int, QString>& before,
+                                                       const QHash<int, QString>& after, int bucketSize)
+{
+    QSet<int> changed;
+    for (auto it = after.constBegin(); it != after.constEnd(); ++it) {
+        const auto old = before.constFind(it.key());
+        if (old == before.constEnd() || old.value() != it.value()) {
+            changed.insert(it.key());
+        }
+    }
+    for (auto it = before.constBegin(); it != before.constEnd(); ++it) {
+        if (!after.contains(it.key())) {
+            changed.insert(it.key());   // every row of the bucket deleted
+        }
+    }
+
+    QList<int> buckets = changed.values();
+    std::sort(buckets.begin(), buckets.end());
+
+    QVector<QPair<int, int>> ranges;
+    for (int bucket : buckets) {
+        const int first = bucket * bucketSize;
+        const int last = first + bucketSize - 1;
+        if (!ranges.isEmpty() && ranges.last().second + 1 == first) {
+            ranges.last().second = last;
+        } else {
+            ranges.append(qMakePair(first, last));
+        }
+    }
+    return ranges;
+}
@@ -0,0 +1,98 @@
+#ifndef CHANGE_DETECTOR_H
+#define CHANGE_DETECTOR_H
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+
+class QThread;
+
+/**
+ * @brief Polls ne_plate_type / ne_md_info for edits and reloads what changed
+ *
+ * Each poll first reads a cheap commit counter (DBQueries::selectDataVersion)
+ * and stops there if it has not moved. Otherwise the tables are summed per
+ * pk_id bucket; buckets whose checksum differs from the baseline are merged
+ * into id ranges and only those rows are fetched and handed to
+ * MetaManage::requestPartialReload(). The baseline only advances once the
+ * reload has been queued, so a failed poll is retried on the next one.
+ *
+ * NENet's own md value commits move the counter too. A move that coincides
+ * with them is deferred to the next quiet poll, or to kMaxOwnWriteSkips
+ * polls at most: under steady md traffic an edit is picked up that much
+ * later, and the table scans still run once per such window.
+ */
+class ChangeDetector
+{
+public:
+    static ChangeDetector& instance();
+
+    /**
+     * @brief Checksum the tables as they are now; call right before they are loaded
+     *
+     * Edits committed during the load then differ from the baseline and are
+     * reloaded by the first poll (reloading an unchanged range is harmless).
+     */
+    bool captureBaseline(int bucketSize);
+
+    /**
+     * @brief Start polling every pollIntervalMs (needs a captured baseline)
+     */
+    bool start(int pollIntervalMs);
+
+    void cleanup();
+
+    /**
+     * @brief One-line counters: polls, checksum runs, changes, failures
+     */
+    QString statsSummary() const;
+
+private:
+    ChangeDetector() = default;
+    ~ChangeDetector();
+
+    ChangeDetector(const ChangeDetector&) = delete;
+    ChangeDetector& operator=(const ChangeDetector&) = delete;
+
+    void pollLoop();
+    void poll();
+
+    /**
+     * @brief Id ranges of the buckets that differ, adjacent buckets merged
+     */
+    static QVector<QPair<int, int>> changedRanges(const QHash<int, QString>& before,
+                                                  const QHash<int, QString>& after, int bucketSize);
+
+    static constexpr int kMaxOwnWriteSkips = 12;
+    // kept instead of a version that may still absorb an edit; never equals a read one
+    static constexpr qint64 kUnsettledVersion = -1;
+
+    int m_bucketSize = 1024;
+    int m_pollIntervalMs = 5000;
+    bool m_haveBaseline = false;
+
+    QThread* m_thread = nullptr;
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    bool m_stopping = false;
+
+    // baseline, owned by the poll thread once started
+    bool m_haveVersion = false;
+    qint64 m_version = 0;
+    quint64 m_ownWrites = 0;    // DBQueries::metadataWriteCount() at m_version
+    int m_ownWriteSkips = 0;    // polls deferred since the last checksum run
+    QHash<int, QString> m_plateSums;
+    QHash<int, QString> m_mdSums;
+
+    std::atomic<quint64> m_polls{0};
+    std::atomic<quint64> m_checksumRuns{0};
+    std::atomic<quint64> m_ownWriteDeferrals{0};
+    std::atomic<quint64> m_changes{0};
+    std::atomic<quint64> m_failures{0};
+};
+
+#endif // CHANGE_DETECTOR_H
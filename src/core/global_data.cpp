@@ -1,5 +1,6 @@
 #include "global_data.h"
 #include "logging/logger.h"
+#include "hardware/jf_plate_pool.h"
 
 GlobalData& GlobalData::instance()
 {
@@ -30,7 +31,7 @@ QMap<int, JFHardControl>& GlobalData::getJFHardDict()
     return m_jfHardAllDict;
 }
 
-QMap<int, JFPlate>& GlobalData::getJFPlateDict()
+QMap<int, JFPlate*>& GlobalData::getJFPlateDict()
 {
     return m_jfPlateDict;
 }
@@ -60,6 +61,86 @@ std::queue<HardwareEvent>& GlobalData::getHardwareEventQueue()
     return m_hardwareEventQueue;
 }
 
+bool GlobalData::pushHardwareEvent(HardwareEvent event)
+{
+    std::function<void()> notifier;
+    {
+        QMutexLocker locker(&m_hardwareEventMutex);
+        if (m_hardwareEventQueue.size() >= m_hardwareEventCapacity) {
+            ++m_hardwareEventsDropped;
+            return false;
+        }
+        if (m_hardwareEventQueue.empty()) {
+            notifier = m_hardwareEventNotifier;
+        }
+        m_hardwareEventQueue.push(std::move(event));
+    }
+
+    if (notifier) {
+        notifier();
+    }
+    return true;
+}
+
+int GlobalData::pushHardwareEvents(QVector<HardwareEvent>& events)
+{
+    if (events.isEmpty()) {
+        return 0;
+    }
+
+    std::function<void()> notifier;
+    int queued = 0;
+    {
+        QMutexLocker locker(&m_hardwareEventMutex);
+        if (m_hardwareEventQueue.empty()) {
+            notifier = m_hardwareEventNotifier;
+        }
+        const size_t room = m_hardwareEventCapacity > m_hardwareEventQueue.size()
+                                ? m_hardwareEventCapacity - m_hardwareEventQueue.size() : 0;
+        queued = static_cast<int>(qMin<size_t>(room, static_cast<size_t>(events.size())));
+        for (int i = 0; i < queued; ++i) {
+            m_hardwareEventQueue.push(std::move(events[i]));
+        }
+        m_hardwareEventsDropped += static_cast<quint64>(events.size() - queued);
+    }
+    events.clear();
+
+    if (notifier && queued > 0) {
+        notifier();
+    }
+    return queued;
+}
+
+int GlobalData::takeHardwareEvents(QVector<HardwareEvent>& events)
+{
+    QMutexLocker locker(&m_hardwareEventMutex);
+    const int count = static_cast<int>(m_hardwareEventQueue.size());
+    events.reserve(events.size() + count);
+    while (!m_hardwareEventQueue.empty()) {
+        events.append(std::move(m_hardwareEventQueue.front()));
+        m_hardwareEventQueue.pop();
+    }
+    return count;
+}
+
+void GlobalData::setHardwareEventNotifier(std::function<void()> notifier)
+{
+    QMutexLocker locker(&m_hardwareEventMutex);
+    m_hardwareEventNotifier = std::move(notifier);
+}
+
+void GlobalData::setHardwareEventCapacity(int capacity)
+{
+    QMutexLocker locker(&m_hardwareEventMutex);
+    m_hardwareEventCapacity = capacity > 0 ? static_cast<size_t>(capacity) : 1;
+}
+
+quint64 GlobalData::hardwareEventsDropped() const
+{
+    QMutexLocker locker(&m_hardwareEventMutex);
+    return m_hardwareEventsDropped;
+}
+
 std::queue<NECMessage>& GlobalData::getNECMessageQueue()
 {
     return m_necMessageQueue;
@@ -82,8 +163,11 @@ void GlobalData::clearAllData()
     m_listFlowInfo.clear();
 
     // Clear queues
-    while (!m_hardwareEventQueue.empty()) {
-        m_hardwareEventQueue.pop();
+    {
+        QMutexLocker eventLocker(&m_hardwareEventMutex);
+        while (!m_hardwareEventQueue.empty()) {
+            m_hardwareEventQueue.pop();
+        }
     }
     while (!m_necMessageQueue.empty()) {
         m_necMessageQueue.pop();
@@ -98,6 +182,15 @@ void GlobalData::logState(const QString& context)
     Logger::instance().info(QString("Program: %1 %2").arg(m_config.program_name, m_config.version));
     Logger::instance().info(QString("Plates: %1").arg(m_listPlate.size()));
     Logger::instance().info(QString("Metadata: %1").arg(m_listMdInfo.size()));
-    Logger::instance().info(QString("Hardware Events: %1").arg(static_cast<int>(m_hardwareEventQueue.size())));
+
+    Logger::instance().info(QString("JFPlate sessions: %1 (ready %2)")
+                                .arg(JFPlatePool::instance().size())
+                                .arg(JFPlatePool::instance().readyCount()));
+    int hardwareEvents = 0;
+    {
+        QMutexLocker eventLocker(&m_hardwareEventMutex);
+        hardwareEvents = static_cast<int>(m_hardwareEventQueue.size());
+    }
+    Logger::instance().info(QString("Hardware Events: %1").arg(hardwareEvents));
     Logger::instance().info(QString("NEC Messages: %1").arg(static_cast<int>(m_necMessageQueue.size())));
 }
@@ -5,7 +5,9 @@
 #include <QList>
 #include <QMap>
 #include <QMutex>
+#include <QVector>
 #include <queue>
+#include <functional>
 #include "database/data_structures.h"
 #include "config/config_info.h"
 #include "hardware/jf_plate.h"
@@ -30,7 +32,7 @@ public:
 
     // Hardware data
     QMap<int, JFHardControl>& getJFHardDict();
-    QMap<int, JFPlate>& getJFPlateDict();
+    QMap<int, JFPlate*>& getJFPlateDict();  // sessions owned by JFPlatePool
 
     // Plate and metadata info
     QList<ne_plate>& getPlatelist();
@@ -40,6 +42,34 @@ public:
 
     // Message queues
     std::queue<HardwareEvent>& getHardwareEventQueue();
+
+    /**
+     * @brief Queue a hardware event from any thread
+     *
+     * The notifier runs (on the caller's thread) when the queue was empty,
+     * so the consumer is woken once per burst rather than per event.
+     * @return false if the queue is full and the event was dropped
+     */
+    bool pushHardwareEvent(HardwareEvent event);
+
+    /**
+     * @brief Queue a batch of hardware events under one lock and at most one wake-up; events is emptied
+     * @return number of events queued, the rest were dropped because the queue is full
+     */
+    int pushHardwareEvents(QVector<HardwareEvent>& events);
+
+    /**
+     * @brief Move every queued hardware event into events (thread-safe)
+     */
+    int takeHardwareEvents(QVector<HardwareEvent>& events);
+
+    void setHardwareEventNotifier(std::function<void()> notifier);
+
+    /**
+     * @brief Bound the hardware event queue (set before CAN/JF sessions start)
+     */
+    void setHardwareEventCapacity(int capacity);
+    quint64 hardwareEventsDropped() const;
     std::queue<NECMessage>& getNECMessageQueue();
 
     // Mutex for thread-safe access
@@ -62,7 +92,7 @@ private:
 
     // Hardware data
     QMap<int, JFHardControl> m_jfHardAllDict;
-    QMap<int, JFPlate> m_jfPlateDict;
+    QMap<int, JFPlate*> m_jfPlateDict;
 
     // Plate and metadata
     QList<ne_plate> m_listPlate;
@@ -72,6 +102,10 @@ private:
 
     // Message queues for inter-thread communication
     std::queue<HardwareEvent> m_hardwareEventQueue;
+    mutable QMutex m_hardwareEventMutex;
+    std::function<void()> m_hardwareEventNotifier;
+    size_t m_hardwareEventCapacity = 65536;
+    quint64 m_hardwareEventsDropped = 0;
     std::queue<NECMessage> m_necMessageQueue;
 
     // Thread synchronization
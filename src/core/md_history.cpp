@@ -0,0 +1,517 @@
+#include "md_history.h"
+#include "logging/logger.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char kSegmentMagic[4] = {'N', 'E', 'H', 'S'};
+constexpr quint8 kSegmentVersion = 1;
+constexpr int kHeaderSize = 4 + 1 + 8;
+
+// low-rate sites would otherwise keep one segment forever and never expire it
+constexpr qint64 kSegmentMaxAgeMs = 60 * 60 * 1000;
+
+// wake the flush thread early once this much is encoded
+constexpr int kEagerFlushBytes = 256 * 1024;
+
+inline quint64 zigzag(qint64 v)
+{
+    return (static_cast<quint64>(v) << 1) ^ static_cast<quint64>(v >> 63);
+}
+
+inline qint64 unzigzag(quint64 v)
+{
+    return static_cast<qint64>(v >> 1) ^ -static_cast<qint64>(v & 1);
+}
+
+inline void putVarint(QByteArray& out, quint64 v)
+{
+    while (v >= 0x80) {
+        out.append(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.append(static_cast<char>(v));
+}
+
+inline bool getVarint(const uchar*& p, const uchar* end, quint64& v)
+{
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        const uchar byte = *p++;
+        v |= static_cast<quint64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline qint64 nowMs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+} // namespace
+
+MdHistory& MdHistory::instance()
+{
+    static MdHistory s_instance;
+    return s_instance;
+}
+
+MdHistory::~MdHistory()
+{
+    cleanup();
+}
+
+bool MdHistory::initialize(const QString& dir, int ringCapacity, int segmentMb,
+                           int retentionHours, int flushIntervalMs)
+{
+    if (m_thread) {
+        return true;
+    }
+
+    if (!QDir().mkpath(dir)) {
+        Logger::instance().error(QString("Cannot create md history directory %1").arg(dir));
+        return false;
+    }
+
+    m_dir = dir;
+    m_ringCapacity = ringCapacity > 0 ? ringCapacity : 256;
+    m_segmentLimit = static_cast<qint64>(segmentMb > 0 ? segmentMb : 16) * 1024 * 1024;
+    m_retentionMs = static_cast<qint64>(qMax(0, retentionHours)) * 60 * 60 * 1000;
+    m_flushIntervalMs = flushIntervalMs > 0 ? flushIntervalMs : 1000;
+    m_stopping = false;
+
+    // A run never appends to an older segment: its encoder state is gone.
+    qint64 baseMs = nowMs();
+    const QList<SegmentFile> existing = listSegments();
+    if (!existing.isEmpty()) {
+        baseMs = qMax(baseMs, existing.last().baseMs + 1);
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_segmentBaseMs = baseMs;
+        m_segmentWritten = 0;
+        m_cursors.clear();
+    }
+    {
+        QMutexLocker fileLocker(&m_fileMutex);
+        if (!openSegment(baseMs)) {
+            return false;
+        }
+    }
+    enforceRetention();
+
+    m_thread = QThread::create([this] { flushLoop(); });
+    m_thread->setObjectName("MdHistory");
+    m_thread->start();
+
+    Logger::instance().info(QString("Md history started: dir=%1 ring=%2 segment=%3MB retention=%4h (%5 old segments)")
+                                .arg(m_dir)
+                                .arg(m_ringCapacity)
+                                .arg(m_segmentLimit / (1024 * 1024))
+                                .arg(retentionHours)
+                                .arg(existing.size()));
+    return true;
+}
+
+void MdHistory::cleanup()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    flushPending();
+    {
+        QMutexLocker fileLocker(&m_fileMutex);
+        m_segment.close();
+    }
+
+    Logger::instance().info("Md history stopped: " + statsSummary());
+}
+
+bool MdHistory::isRunning() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_thread != nullptr && !m_stopping;
+}
+
+void MdHistory::record(const QList<QPair<int, int>>& changes, qint64 tsMs)
+{
+    if (changes.isEmpty()) {
+        return;
+    }
+    if (tsMs == 0) {
+        tsMs = nowMs();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_thread || m_stopping) {
+        return;
+    }
+
+    for (const auto& change : changes) {
+        Ring& ring = m_rings[change.first];
+        if (ring.samples.isEmpty()) {
+            ring.samples.resize(m_ringCapacity);
+        }
+        HistorySample& slot = ring.samples[ring.head];
+        slot.tsMs = tsMs;
+        slot.value = change.second;
+        ring.head = (ring.head + 1) % m_ringCapacity;
+        ring.count = qMin(ring.count + 1, m_ringCapacity);
+
+        appendRecordLocked(change.first, tsMs, change.second);
+    }
+    m_samples += static_cast<quint64>(changes.size());
+
+    if (m_pending.size() >= kEagerFlushBytes) {
+        m_wake.wakeAll();
+    }
+}
+
+void MdHistory::appendRecordLocked(int mdId, qint64 tsMs, int value)
+{
+    auto it = m_cursors.find(mdId);
+    if (it == m_cursors.end()) {
+        SegmentCursor cursor;
+        cursor.lastTsMs = m_segmentBaseMs;
+        it = m_cursors.insert(mdId, cursor);
+    }
+
+    putVarint(m_pending, zigzag(mdId));
+    putVarint(m_pending, zigzag(tsMs - it->lastTsMs));
+    putVarint(m_pending, zigzag(static_cast<qint64>(value) - it->lastValue));
+
+    it->lastTsMs = tsMs;
+    it->lastValue = value;
+}
+
+QHash<int, QVector<HistorySample>> MdHistory::range(const QList<int>& mdIds, qint64 fromMs, qint64 toMs)
+{
+    QHash<int, QVector<HistorySample>> result;
+    QHash<int, QVector<HistorySample>> fromRing;
+    QHash<int, qint64> diskUpperBound;   // id -> samples from disk must be older than this
+    qint64 diskTo = fromMs - 1;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_queries;
+
+        for (int mdId : mdIds) {
+            result.insert(mdId, QVector<HistorySample>());
+
+            const auto it = m_rings.constFind(mdId);
+            if (it == m_rings.constEnd() || it->count == 0) {
+                diskUpperBound.insert(mdId, toMs + 1);
+                diskTo = toMs;
+                continue;
+            }
+
+            const Ring& ring = *it;
+            const int capacity = ring.samples.size();
+            const int oldest = (ring.head - ring.count + capacity) % capacity;
+            const qint64 oldestTs = ring.samples[oldest].tsMs;
+
+            // the ring holds every change since its oldest entry
+            if (oldestTs > fromMs) {
+                diskUpperBound.insert(mdId, oldestTs);
+                diskTo = qMax(diskTo, qMin(toMs, oldestTs - 1));
+            }
+
+            QVector<HistorySample>& samples = fromRing[mdId];
+            for (int i = 0; i < ring.count; ++i) {
+                const HistorySample& sample = ring.samples[(oldest + i) % capacity];
+                if (sample.tsMs >= fromMs && sample.tsMs <= toMs) {
+                    samples.append(sample);
+                }
+            }
+        }
+
+        if (!diskUpperBound.isEmpty()) {
+            ++m_diskQueries;
+        }
+    }
+
+    if (!diskUpperBound.isEmpty() && diskTo >= fromMs) {
+        // records that already left the ring may still be waiting in m_pending
+        flushPending();
+
+        QHash<int, QVector<HistorySample>*> wanted;
+        for (auto it = diskUpperBound.constBegin(); it != diskUpperBound.constEnd(); ++it) {
+            wanted.insert(it.key(), &result[it.key()]);
+        }
+
+        const QList<SegmentFile> segments = listSegments();
+        for (int i = 0; i < segments.size(); ++i) {
+            const qint64 segmentEnd = i + 1 < segments.size() ? segments[i + 1].baseMs : std::numeric_limits<qint64>::max();
+            if (segments[i].baseMs > diskTo || segmentEnd <= fromMs) {
+                continue;
+            }
+            readSegment(segments[i].path, wanted, fromMs, diskTo);
+        }
+
+        for (auto it = diskUpperBound.constBegin(); it != diskUpperBound.constEnd(); ++it) {
+            QVector<HistorySample>& samples = result[it.key()];
+            const qint64 bound = it.value();
+            samples.erase(std::remove_if(samples.begin(), samples.end(),
+                                         [bound](const HistorySample& s) { return s.tsMs >= bound; }),
+                          samples.end());
+        }
+    }
+
+    for (auto it = fromRing.constBegin(); it != fromRing.constEnd(); ++it) {
+        result[it.key()] += it.value();
+    }
+    return result;
+}
+
+QVector<HistoryBucket> MdHistory::downsample(const QVector<HistorySample>& samples,
+                                             qint64 fromMs, qint64 stepMs)
+{
+    QVector<HistoryBucket> buckets;
+    if (stepMs <= 0) {
+        return buckets;
+    }
+
+    double sum = 0.0;
+    for (const HistorySample& sample : samples) {
+        if (sample.tsMs < fromMs) {
+            continue;
+        }
+
+        const qint64 startMs = fromMs + ((sample.tsMs - fromMs) / stepMs) * stepMs;
+        if (buckets.isEmpty() || buckets.last().startMs != startMs) {
+            if (!buckets.isEmpty()) {
+                buckets.last().avg = sum / buckets.last().count;
+            }
+            HistoryBucket bucket;
+            bucket.startMs = startMs;
+            bucket.min = sample.value;
+            bucket.max = sample.value;
+            buckets.append(bucket);
+            sum = 0.0;
+        }
+
+        HistoryBucket& bucket = buckets.last();
+        bucket.min = qMin(bucket.min, sample.value);
+        bucket.max = qMax(bucket.max, sample.value);
+        bucket.last = sample.value;
+        ++bucket.count;
+        sum += sample.value;
+    }
+
+    if (!buckets.isEmpty()) {
+        buckets.last().avg = sum / buckets.last().count;
+    }
+    return buckets;
+}
+
+QString MdHistory::statsSummary() const
+{
+    QMutexLocker locker(&m_mutex);
+    return QString("history: ids=%1 samples=%2 pending=%3B written=%4B segments=%5 queries=%6 (disk %7)")
+        .arg(m_rings.size())
+        .arg(m_samples)
+        .arg(m_pending.size())
+        .arg(m_bytesWritten)
+        .arg(m_segmentsOpened)
+        .arg(m_queries)
+        .arg(m_diskQueries);
+}
+
+void MdHistory::flushLoop()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopping) {
+        m_wake.wait(&m_mutex, static_cast<unsigned long>(m_flushIntervalMs));
+        if (m_stopping) {
+            break;
+        }
+
+        locker.unlock();
+        flushPending();
+        locker.relock();
+    }
+}
+
+void MdHistory::flushPending()
+{
+    QMutexLocker fileLocker(&m_fileMutex);
+
+    QByteArray chunk;
+    bool roll = false;
+    qint64 newBaseMs = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        chunk.swap(m_pending);
+        m_segmentWritten += chunk.size();
+
+        const qint64 now = nowMs();
+        if (m_segmentWritten >= m_segmentLimit
+            || (m_segmentWritten > 0 && now - m_segmentBaseMs >= kSegmentMaxAgeMs)) {
+            // later records encode against the new segment from here on
+            roll = true;
+            newBaseMs = qMax(now, m_segmentBaseMs + 1);
+            m_segmentBaseMs = newBaseMs;
+            m_segmentWritten = 0;
+            m_cursors.clear();
+        }
+    }
+
+    if (!chunk.isEmpty() && m_segment.isOpen()) {
+        const qint64 written = m_segment.write(chunk);
+        m_segment.flush();
+        if (written != chunk.size()) {
+            Logger::instance().warning(QString("Md history write to %1 failed: %2")
+                                           .arg(m_segment.fileName(), m_segment.errorString()));
+        }
+
+        QMutexLocker locker(&m_mutex);
+        m_bytesWritten += static_cast<quint64>(qMax<qint64>(0, written));
+    }
+
+    if (roll) {
+        openSegment(newBaseMs);
+        fileLocker.unlock();
+        enforceRetention();
+    }
+}
+
+bool MdHistory::openSegment(qint64 baseMs)
+{
+    m_segment.close();
+    m_segment.setFileName(QDir(m_dir).filePath(QString("md_%1.hseg").arg(baseMs)));
+    if (!m_segment.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        Logger::instance().error(QString("Cannot open md history segment %1: %2")
+                                     .arg(m_segment.fileName(), m_segment.errorString()));
+        return false;
+    }
+
+    QByteArray header(kSegmentMagic, sizeof(kSegmentMagic));
+    header.append(static_cast<char>(kSegmentVersion));
+    char base[8];
+    qToLittleEndian<qint64>(baseMs, base);
+    header.append(base, sizeof(base));
+    m_segment.write(header);
+    m_segment.flush();
+
+    QMutexLocker locker(&m_mutex);
+    ++m_segmentsOpened;
+    return true;
+}
+
+void MdHistory::enforceRetention()
+{
+    if (m_retentionMs <= 0) {
+        return;
+    }
+
+    const qint64 cutoff = nowMs() - m_retentionMs;
+    const QList<SegmentFile> segments = listSegments();
+
+    // a segment is expired once the next one started before the cutoff
+    for (int i = 0; i + 1 < segments.size(); ++i) {
+        if (segments[i + 1].baseMs >= cutoff) {
+            break;
+        }
+        if (QFile::remove(segments[i].path)) {
+            Logger::instance().debug(QString("Md history segment %1 expired").arg(segments[i].path));
+        }
+    }
+}
+
+QList<MdHistory::SegmentFile> MdHistory::listSegments() const
+{
+    QList<SegmentFile> segments;
+    const QFileInfoList files = QDir(m_dir).entryInfoList({"md_*.hseg"}, QDir::Files);
+    for (const QFileInfo& info : files) {
+        bool ok = false;
+        const qint64 baseMs = info.completeBaseName().mid(3).toLongLong(&ok);
+        if (ok) {
+            segments.append({info.absoluteFilePath(), baseMs});
+        }
+    }
+
+    std::sort(segments.begin(), segments.end(),
+              [](const SegmentFile& a, const SegmentFile& b) { return a.baseMs < b.baseMs; });
+    return segments;
+}
+
+void MdHistory::readSegment(const QString& path, const QHash<int, QVector<HistorySample>*>& wanted,
+                            qint64 fromMs, qint64 toMs)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < kHeaderSize) {
+        return;
+    }
+
+    const qint64 size = file.size();
+    uchar* data = file.map(0, size);
+    if (!data) {
+        return;
+    }
+
+    const uchar* p = data;
+    const uchar* end = data + size;
+    if (memcmp(p, kSegmentMagic, sizeof(kSegmentMagic)) != 0 || p[4] != kSegmentVersion) {
+        Logger::instance().warning(QString("Md history segment %1 has an unknown format").arg(path));
+        file.unmap(data);
+        return;
+    }
+    const qint64 baseMs = qFromLittleEndian<qint64>(p + 5);
+    p += kHeaderSize;
+
+    // every id's cursor must be followed, wanted or not
+    QHash<int, SegmentCursor> cursors;
+    while (p < end) {
+        quint64 rawId = 0;
+        quint64 rawDt = 0;
+        quint64 rawDv = 0;
+        if (!getVarint(p, end, rawId) || !getVarint(p, end, rawDt) || !getVarint(p, end, rawDv)) {
+            break;  // torn tail after a crash
+        }
+
+        const int mdId = static_cast<int>(unzigzag(rawId));
+        auto it = cursors.find(mdId);
+        if (it == cursors.end()) {
+            SegmentCursor cursor;
+            cursor.lastTsMs = baseMs;
+            it = cursors.insert(mdId, cursor);
+        }
+        it->lastTsMs += unzigzag(rawDt);
+        it->lastValue = static_cast<int>(it->lastValue + unzigzag(rawDv));
+
+        if (it->lastTsMs < fromMs || it->lastTsMs > toMs) {
+            continue;
+        }
+        const auto target = wanted.constFind(mdId);
+        if (target != wanted.constEnd()) {
+            HistorySample sample;
+            sample.tsMs = it->lastTsMs;
+            sample.value = it->lastValue;
+            target.value()->append(sample);
+        }
+    }
+
+    file.unmap(data);
+}
@@ -0,0 +1,155 @@
+#ifndef MD_HISTORY_H
+#define MD_HISTORY_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QHash>
+#include <QVector>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+
+class QThread;
+
+/**
+ * @brief One recorded md value
+ */
+struct HistorySample
+{
+    qint64 tsMs = 0;
+    int value = 0;
+};
+
+/**
+ * @brief Aggregate of the samples falling into one downsampling window
+ */
+struct HistoryBucket
+{
+    qint64 startMs = 0;
+    int min = 0;
+    int max = 0;
+    double avg = 0.0;
+    int last = 0;
+    int count = 0;
+};
+
+/**
+ * @brief Embedded time-series store of md value changes
+ *
+ * Every change is kept in a fixed-size in-memory ring per md id and
+ * appended to segmented files on disk. A segment starts with a small
+ * header (magic, version, base time); each record is three varints:
+ * md id, zigzag(time delta), zigzag(value delta), where the deltas are
+ * against the previous record of the same id in the same segment (the
+ * segment base time and 0 for its first record). Segments roll by size
+ * and are deleted once older than the retention period.
+ *
+ * record() only touches memory; a background thread writes the encoded
+ * records out. Queries are answered from the rings when they cover the
+ * window and from the segment files otherwise; the SQL database is never
+ * involved.
+ */
+class MdHistory
+{
+public:
+    static MdHistory& instance();
+
+    /**
+     * @brief Open a new segment in dir and start the flush thread
+     */
+    bool initialize(const QString& dir, int ringCapacity, int segmentMb,
+                    int retentionHours, int flushIntervalMs);
+
+    /**
+     * @brief Write out pending records and stop the flush thread
+     */
+    void cleanup();
+
+    bool isRunning() const;
+
+    /**
+     * @brief Record (md id, value) changes, all stamped with tsMs (0: now)
+     */
+    void record(const QList<QPair<int, int>>& changes, qint64 tsMs = 0);
+
+    /**
+     * @brief Samples of each id with fromMs <= ts <= toMs, oldest first
+     */
+    QHash<int, QVector<HistorySample>> range(const QList<int>& mdIds, qint64 fromMs, qint64 toMs);
+
+    /**
+     * @brief Group samples into stepMs windows starting at fromMs (empty windows omitted)
+     */
+    static QVector<HistoryBucket> downsample(const QVector<HistorySample>& samples,
+                                             qint64 fromMs, qint64 stepMs);
+
+    /**
+     * @brief One-line counters: samples, bytes written, segments, queries
+     */
+    QString statsSummary() const;
+
+private:
+    struct Ring {
+        QVector<HistorySample> samples;
+        int head = 0;       // next write position
+        int count = 0;
+    };
+
+    struct SegmentCursor {
+        qint64 lastTsMs = 0;
+        int lastValue = 0;
+    };
+
+    struct SegmentFile {
+        QString path;
+        qint64 baseMs = 0;
+    };
+
+    MdHistory() = default;
+    ~MdHistory();
+
+    MdHistory(const MdHistory&) = delete;
+    MdHistory& operator=(const MdHistory&) = delete;
+
+    void flushLoop();
+    void flushPending();
+    bool openSegment(qint64 baseMs);
+    void enforceRetention();
+    QList<SegmentFile> listSegments() const;
+    void appendRecordLocked(int mdId, qint64 tsMs, int value);
+
+    static void readSegment(const QString& path, const QHash<int, QVector<HistorySample>*>& wanted,
+                            qint64 fromMs, qint64 toMs);
+
+    QString m_dir;
+    int m_ringCapacity = 256;
+    qint64 m_segmentLimit = 16 * 1024 * 1024;
+    qint64 m_retentionMs = 0;
+    int m_flushIntervalMs = 1000;
+
+    QThread* m_thread = nullptr;
+    bool m_stopping = false;
+
+    // rings, pending encoded bytes and the encoder state of the open segment
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    QHash<int, Ring> m_rings;
+    QByteArray m_pending;
+    QHash<int, SegmentCursor> m_cursors;
+    qint64 m_segmentBaseMs = 0;
+    qint64 m_segmentWritten = 0;
+
+    // serializes file writes and segment rolls (flush thread and queries)
+    QMutex m_fileMutex;
+    QFile m_segment;
+
+    // counters
+    quint64 m_samples = 0;
+    quint64 m_bytesWritten = 0;
+    quint64 m_segmentsOpened = 0;
+    quint64 m_queries = 0;
+    quint64 m_diskQueries = 0;
+};
+
+#endif // MD_HISTORY_H
@@ -3,10 +3,52 @@
 #include "logging/logger.h"
 #include "network/udp_interface.h"
 #include "network/protocol.h"
+#include "database/md_persister.h"
 #include "database/db_queries.h"
+#include "hardware/jf_plate_pool.h"
+#include "topology_builder.h"
+#include "table_cache.h"
+#include "md_history.h"
 #include <QThread>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QHash>
+#include <QSet>
+#include <QDateTime>
+
+namespace {
+// egress drains at most this many items per wake-up so snapshots coalesce
+constexpr int kEgressBatch = 256;
+
+// history queries are rare and expensive; excess requests are dropped
+constexpr int kHistoryQueueDepth = 64;
+constexpr qint64 kDefaultHistoryWindowMs = 10 * 60 * 1000;
+constexpr int kMaxHistoryIds = 256;
+constexpr qint64 kMaxHistoryBuckets = 100000;
+// stay below the UDP datagram limit
+constexpr int kMaxHistoryReplyBytes = 60000;
+// hardware values the persister rejected are retried this often while the writer is idle
+constexpr int kHardwarePersistRetryMs = 1000;
+
+QJsonValue historyAggregate(const HistoryBucket& bucket, const QString& agg)
+{
+    if (agg == "min") return bucket.min;
+    if (agg == "max") return bucket.max;
+    if (agg == "avg") return bucket.avg;
+    if (agg == "count") return bucket.count;
+    return bucket.last;
+}
+
+bool inRanges(int id, const QVector<QPair<int, int>>& ranges)
+{
+    for (const auto& range : ranges) {
+        if (id >= range.first && id <= range.second) {
+            return true;
+        }
+    }
+    return false;
+}
+}
 
 MetaManage& MetaManage::instance()
 {
@@ -15,7 +57,7 @@ MetaManage& MetaManage::instance()
 }
 
 MetaManage::MetaManage(QObject* parent)
-    : QObject(parent), m_udpInterface(nullptr), m_sendThread(nullptr)
+    : QObject(parent), m_udpInterface(nullptr)
 {
 }
 
@@ -32,9 +74,30 @@ bool MetaManage::initialize()
         const auto& config = GlobalData::instance().getConfig();
         m_necPort = config.network.nenet_nec_port;
         m_interfacePort = config.network.interface_port;
+        m_forwardDO = config.hardio.forward_do;
 
         rebuildMetaRouteCache();
 
+        m_parseQueue.setCapacity(config.pipeline.parse_queue_depth);
+        m_stateQueue.setCapacity(config.pipeline.state_queue_depth);
+        m_historyQueue.setCapacity(kHistoryQueueDepth);
+        m_egressQueue.setCapacity(config.pipeline.egress_queue_depth);
+        startPipeline();
+
+        // boards report on the I/O threads; the writer applies the changes.
+        // Never block here: the events already sit in the hardware queue, so a
+        // full state queue only means the writer is busy, and it checks the
+        // pending flag after every message.
+        GlobalData::instance().setHardwareEventNotifier([this] {
+            m_hardwareEventsPending.store(true, std::memory_order_release);
+            ParsedMessage wake;
+            wake.source = MessageSource::Control;
+            wake.hardwareEvents = true;
+            wake.receivedNs = PipelineClock::nowNs();
+            wake.enqueuedNs = wake.receivedNs;
+            m_stateQueue.tryPush(std::move(wake));
+        });
+
         m_udpInterface = &UDPInterface::instance();
         if (!m_udpInterface->initialize()) {
             Logger::instance().error("Failed to initialize UDP interface");
@@ -56,6 +119,7 @@ bool MetaManage::initialize()
             QOverload<quint16, const QHostAddress&, quint16, const QByteArray&>::of(&UDPInterface::dataReceivedOnPort),
             this,
             [this](quint16 localPort, const QHostAddress& senderAddress, quint16 senderPort, const QByteArray& data) {
+                // Runs on the UDP worker thread: only hand off, never process here.
                 if (localPort == m_necPort) {
                     onNECDataReceived(senderAddress, senderPort, data);
                 } else if (localPort == m_interfacePort) {
@@ -88,79 +152,437 @@ bool MetaManage::initialize()
 
 void MetaManage::cleanup()
 {
+    GlobalData::instance().setHardwareEventNotifier(nullptr);
+    stopPipeline();
+
     if (m_udpInterface) {
         m_udpInterface->cleanup();
     }
 
-    if (m_sendThread) {
-        m_sendThread->quit();
-        m_sendThread->wait();
-        delete m_sendThread;
-        m_sendThread = nullptr;
-    }
-
     m_registeredClients.clear();
+    if (!m_unpersistedHardware.isEmpty()) {
+        Logger::instance().error(QString("%1 hardware md values were never persisted")
+                                     .arg(m_unpersistedHardware.size()));
+        m_unpersistedHardware.clear();
+    }
     m_metaRouteById.clear();
+    m_mdIndexById.clear();
 }
 
-void MetaManage::processHardwareEvents() {}
+void MetaManage::processHardwareEvents()
+{
+    QVector<HardwareEvent> events;
+    if (GlobalData::instance().takeHardwareEvents(events) == 0 && m_unpersistedHardware.isEmpty()) {
+        return;
+    }
+
+    QMap<int, JFHardControl>& jfHardDict = GlobalData::instance().getJFHardDict();
+    QList<QPair<int, int>> updates;
+
+    for (const HardwareEvent& event : events) {
+        if (event.type != HardwareEvent::CHANNELS_CHANGED) {
+            if (m_unhandledHardwareEvents.fetch_add(1, std::memory_order_relaxed) == 0) {
+                Logger::instance().warning(QString("Hardware event type %1 from source %2 has no md mapping, "
+                                                   "discarding (further ones are only counted)")
+                                               .arg(static_cast<int>(event.type))
+                                               .arg(event.source_id));
+            }
+            continue;
+        }
+        auto controlIt = jfHardDict.find(event.source_id);
+        if (controlIt == jfHardDict.end()) {
+            continue;
+        }
+        JFHardControl& control = controlIt.value();
+
+        for (const ChannelChange& change : event.changes) {
+            if (change.channel >= 16) {
+                continue;
+            }
+            const QMap<int, QVector<int>>& idMap = change.kind == ChannelChange::DI ? control.allDIIdMap
+                                                 : change.kind == ChannelChange::DO ? control.allDOIdMap
+                                                                                    : control.allMNdMap;
+            const auto idIt = idMap.constFind(change.hardAddr);
+            if (idIt == idMap.constEnd()) {
+                continue;
+            }
+
+            if (change.kind == ChannelChange::DI && control.allDIValue.contains(change.hardAddr)) {
+                control.allDIValue[change.hardAddr][change.channel] = change.value;
+            } else if (change.kind == ChannelChange::DO && control.allDOValue.contains(change.hardAddr)) {
+                control.allDOValue[change.hardAddr][change.channel] = change.value;
+            }
+
+            const int mdId = idIt.value().value(change.channel);
+            if (mdId > 0) {
+                updates.append(qMakePair(mdId, change.value));
+            }
+        }
+    }
+
+    // values a failed submit left behind go first; newer reports override them
+    QHash<int, int> latest;
+    latest.swap(m_unpersistedHardware);
+    for (const auto& item : updates) {
+        latest.insert(item.first, item.second);
+    }
+
+    QList<ne_md_info>& mdList = GlobalData::instance().getMetaInfoList();
+    QList<QPair<int, int>> changes;
+    for (auto it = latest.constBegin(); it != latest.constEnd(); ++it) {
+        const auto indexIt = m_mdIndexById.constFind(it.key());
+        if (indexIt != m_mdIndexById.constEnd() && mdList[indexIt.value()].current_value != it.value()) {
+            changes.append(qMakePair(it.key(), it.value()));
+        }
+    }
+    if (changes.isEmpty()) {
+        return;
+    }
+
+    // As for setValue: memory only changes once the configured durability
+    // accepted the values. The board will not report them again, so a failed
+    // batch is kept and retried (writerLoop wakes up for it while idle).
+    if (!MdPersister::instance().submit(changes)) {
+        for (const auto& item : changes) {
+            m_unpersistedHardware.insert(item.first, item.second);
+        }
+        m_hardwareRetryDueNs = PipelineClock::nowNs() + kHardwarePersistRetryMs * 1000000LL;
+        Logger::instance().warning(QString("Persisting %1 hardware md values failed, retrying in %2 ms")
+                                       .arg(changes.size())
+                                       .arg(kHardwarePersistRetryMs));
+        return;
+    }
+
+    for (const auto& item : changes) {
+        mdList[m_mdIndexById.value(item.first)].current_value = item.second;
+    }
+    MdHistory::instance().record(changes);
+    emitMdInSnapshotToNEC();
+}
 void MetaManage::sendToNECClients() {}
 void MetaManage::processSendQueue() {}
 
 void MetaManage::sendMessageToNEC(const QString& message)
 {
-    if (!m_udpInterface) {
-        return;
-    }
-
     const auto& config = GlobalData::instance().getConfig();
-    const QHostAddress necAddress(config.network.nec_ip);
-    m_udpInterface->sendBytesByPort(config.network.nenet_nec_port,
-                                    necAddress,
-                                    config.network.nec_port,
-                                    message.toUtf8());
+
+    EgressItem item;
+    item.sourcePort = static_cast<quint16>(config.network.nenet_nec_port);
+    item.address = QHostAddress(config.network.nec_ip);
+    item.port = static_cast<quint16>(config.network.nec_port);
+    item.payload = message.toUtf8();
+    enqueueEgress(std::move(item));
 }
 
 void MetaManage::sendMessageToInterface(const QHostAddress& address, quint16 port, const QString& message)
 {
-    if (!m_udpInterface) {
+    const auto& config = GlobalData::instance().getConfig();
+
+    EgressItem item;
+    item.sourcePort = static_cast<quint16>(config.network.interface_port);
+    item.address = address;
+    item.port = port;
+    item.payload = message.toUtf8();
+    enqueueEgress(std::move(item));
+}
+
+void MetaManage::sendMessageToQI(const QString& message)
+{
+    const auto& config = GlobalData::instance().getConfig();
+
+    EgressItem item;
+    item.address = QHostAddress(config.network.qi_ip);
+    item.port = static_cast<quint16>(config.network.qi_port);
+    item.payload = message.toUtf8();
+    enqueueEgress(std::move(item));
+}
+
+QStringList MetaManage::pipelineReport() const
+{
+    QStringList lines;
+    lines << QString("parseQueue: depth=%1/%2 high=%3 dropped=%4")
+                 .arg(m_parseQueue.size())
+                 .arg(m_parseQueue.capacity())
+                 .arg(m_parseQueue.highWatermark())
+                 .arg(m_parseQueue.droppedCount());
+    lines << QString("stateQueue: depth=%1/%2 high=%3")
+                 .arg(m_stateQueue.size())
+                 .arg(m_stateQueue.capacity())
+                 .arg(m_stateQueue.highWatermark());
+    lines << QString("egressQueue: depth=%1/%2 high=%3")
+                 .arg(m_egressQueue.size())
+                 .arg(m_egressQueue.capacity())
+                 .arg(m_egressQueue.highWatermark());
+    lines << QString("historyQueue: depth=%1/%2 dropped=%3")
+                 .arg(m_historyQueue.size())
+                 .arg(m_historyQueue.capacity())
+                 .arg(m_historyQueue.droppedCount());
+    lines << QString("hardwareEvents: queueDropped=%1 unhandled=%2")
+                 .arg(GlobalData::instance().hardwareEventsDropped())
+                 .arg(m_unhandledHardwareEvents.load(std::memory_order_relaxed));
+    lines << m_parseStats.summary("parser");
+    lines << m_writerStats.summary("writer");
+    lines << m_egressStats.summary("egress");
+    lines << m_endToEndStats.summary("receive->send");
+    return lines;
+}
+
+void MetaManage::startPipeline()
+{
+    if (m_parserThread) {
         return;
     }
 
-    const auto& config = GlobalData::instance().getConfig();
-    m_udpInterface->sendBytesByPort(config.network.interface_port, address, port, message.toUtf8());
+    m_parseQueue.reset();
+    m_stateQueue.reset();
+    m_egressQueue.reset();
+    m_historyQueue.reset();
+
+    m_parserThread = QThread::create([this] { parserLoop(); });
+    m_writerThread = QThread::create([this] { writerLoop(); });
+    m_egressThread = QThread::create([this] { egressLoop(); });
+    m_historyThread = QThread::create([this] { historyLoop(); });
+    m_parserThread->setObjectName("MetaParser");
+    m_writerThread->setObjectName("MetaWriter");
+    m_egressThread->setObjectName("MetaEgress");
+    m_historyThread->setObjectName("MetaHistory");
+
+    m_egressThread->start();
+    m_historyThread->start();
+    m_writerThread->start();
+    m_parserThread->start();
 }
 
-void MetaManage::sendMessageToQI(const QString& message)
+void MetaManage::stopPipeline()
+{
+    // Close front to back so each stage drains what is already queued.
+    const auto stopStage = [](auto& queue, QThread*& thread) {
+        queue.close();
+        if (thread) {
+            thread->wait();
+            delete thread;
+            thread = nullptr;
+        }
+    };
+
+    stopStage(m_parseQueue, m_parserThread);
+    stopStage(m_stateQueue, m_writerThread);
+    stopStage(m_historyQueue, m_historyThread);
+    stopStage(m_egressQueue, m_egressThread);
+}
+
+void MetaManage::enqueueInbound(MessageSource source, const QHostAddress& senderAddress,
+                                quint16 senderPort, const QByteArray& data)
+{
+    InboundDatagram datagram;
+    datagram.source = source;
+    datagram.sender = senderAddress;
+    datagram.senderPort = senderPort;
+    datagram.data = data;
+    datagram.receivedNs = PipelineClock::nowNs();
+
+    // Never block the socket thread; a full queue is accounted as a drop.
+    if (!m_parseQueue.tryPush(std::move(datagram))) {
+        const quint64 dropped = m_parseQueue.droppedCount();
+        if (dropped == 1 || dropped % 1000 == 0) {
+            Logger::instance().warning(QString("Parse queue full, dropped datagram from %1:%2 (total dropped=%3)")
+                                           .arg(senderAddress.toString())
+                                           .arg(senderPort)
+                                           .arg(dropped));
+        }
+    }
+}
+
+void MetaManage::parserLoop()
+{
+    InboundDatagram datagram;
+    while (m_parseQueue.pop(datagram)) {
+        const qint64 startNs = PipelineClock::nowNs();
+
+        ParsedMessage parsed;
+        parsed.source = datagram.source;
+        parsed.sender = datagram.sender;
+        parsed.senderPort = datagram.senderPort;
+        parsed.receivedNs = datagram.receivedNs;
+
+        try {
+            if (datagram.source == MessageSource::NEC && datagram.data == "NECRunSuccess") {
+                parsed.runSuccess = true;
+            } else {
+                const QJsonObject msgObj = Protocol::parseJsonMessage(QString::fromUtf8(datagram.data));
+                parsed.valid = Protocol::isValidMessage(msgObj);
+                if (parsed.valid) {
+                    parsed.typeStr = msgObj.value("t").toString();
+                    parsed.type = Protocol::getMessageTypeEnum(parsed.typeStr);
+                    if (parsed.type == Protocol::MSG_SET_VALUE) {
+                        parsed.msg = Protocol::parseMessage(msgObj);
+                    } else if (parsed.type == Protocol::MSG_HISTORY_QUERY) {
+                        parsed.history = Protocol::parseHistoryQuery(msgObj);
+                    }
+                }
+            }
+        } catch (const std::exception& e) {
+            Logger::instance().error(QString("Error parsing inbound data: %1").arg(e.what()));
+            parsed.valid = false;
+        }
+
+        const qint64 endNs = PipelineClock::nowNs();
+        m_parseStats.record(startNs - datagram.receivedNs, endNs - startNs);
+
+        if (!parsed.runSuccess && !parsed.valid) {
+            continue;
+        }
+
+        // history reads never touch writer state, keep them off its queue
+        if (parsed.type == Protocol::MSG_HISTORY_QUERY) {
+            if (parsed.source == MessageSource::Interface && !m_historyQueue.tryPush(std::move(parsed))) {
+                Logger::instance().warning("History queue full, historyQuery dropped");
+            }
+            continue;
+        }
+
+        parsed.enqueuedNs = endNs;
+        if (!m_stateQueue.push(std::move(parsed))) {
+            break;
+        }
+    }
+}
+
+void MetaManage::writerLoop()
+{
+    ParsedMessage parsed;
+    for (;;) {
+        const int timeoutMs = m_unpersistedHardware.isEmpty() ? -1 : kHardwarePersistRetryMs;
+        if (!m_stateQueue.pop(parsed, timeoutMs)) {
+            if (m_stateQueue.isClosed()) {
+                break;
+            }
+            processHardwareEvents();    // retry values the persister rejected
+            continue;
+        }
+        const qint64 startNs = PipelineClock::nowNs();
+        m_currentReceivedNs = parsed.receivedNs;
+
+        try {
+            if (parsed.source == MessageSource::NEC) {
+                processNECMessage(parsed);
+            } else if (parsed.source == MessageSource::Interface) {
+                processInterfaceMessage(parsed);
+            } else if (parsed.reload) {
+                applyReload(*parsed.reload);
+            }
+            // the wake-up message itself carries nothing; the flag may also be
+            // set by a notifier whose wake-up did not fit the queue
+            if (m_hardwareEventsPending.exchange(false, std::memory_order_acq_rel) ||
+                (!m_unpersistedHardware.isEmpty() && startNs >= m_hardwareRetryDueNs)) {
+                processHardwareEvents();
+            }
+        } catch (const std::exception& e) {
+            Logger::instance().error(QString("Error processing %1 message: %2")
+                                         .arg(parsed.source == MessageSource::NEC ? "NEC"
+                                              : parsed.source == MessageSource::Interface ? "interface"
+                                                                                          : "control")
+                                         .arg(e.what()));
+        }
+
+        m_currentReceivedNs = 0;
+        m_writerStats.record(startNs - parsed.enqueuedNs, PipelineClock::nowNs() - startNs);
+    }
+}
+
+void MetaManage::egressLoop()
+{
+    QVector<EgressItem> batch;
+    batch.reserve(kEgressBatch);
+
+    while (m_egressQueue.popAll(batch, kEgressBatch) > 0) {
+        // Only the newest md snapshot in a batch is worth serializing.
+        int lastSnapshot = -1;
+        for (int i = 0; i < batch.size(); ++i) {
+            if (batch[i].kind == EgressItem::MdSnapshot) {
+                lastSnapshot = i;
+            }
+        }
+
+        for (int i = 0; i < batch.size(); ++i) {
+            const EgressItem& item = batch[i];
+            if (item.kind == EgressItem::MdSnapshot && i != lastSnapshot) {
+                continue;
+            }
+
+            const qint64 startNs = PipelineClock::nowNs();
+            transmit(item);
+            const qint64 endNs = PipelineClock::nowNs();
+
+            m_egressStats.record(startNs - item.enqueuedNs, endNs - startNs);
+            if (item.receivedNs > 0) {
+                m_endToEndStats.record(startNs - item.receivedNs, endNs - startNs);
+            }
+        }
+
+        batch.clear();
+    }
+}
+
+void MetaManage::historyLoop()
+{
+    ParsedMessage parsed;
+    while (m_historyQueue.pop(parsed)) {
+        try {
+            serveHistoryQuery(parsed);
+        } catch (const std::exception& e) {
+            Logger::instance().error(QString("Error serving historyQuery: %1").arg(e.what()));
+        }
+    }
+}
+
+void MetaManage::enqueueEgress(EgressItem item)
+{
+    if (item.receivedNs == 0 && QThread::currentThread() == m_writerThread) {
+        item.receivedNs = m_currentReceivedNs;
+    }
+    item.enqueuedNs = PipelineClock::nowNs();
+
+    if (!m_egressQueue.push(std::move(item))) {
+        Logger::instance().warning("Egress queue closed, outbound message dropped");
+    }
+}
+
+void MetaManage::transmit(const EgressItem& item)
 {
     if (!m_udpInterface) {
         return;
     }
 
-    const auto& config = GlobalData::instance().getConfig();
-    const QHostAddress qiAddress(config.network.qi_ip);
-    m_udpInterface->sendBytes(qiAddress, config.network.qi_port, message.toUtf8());
+    QByteArray payload = item.payload;
+    if (item.kind == EgressItem::MdSnapshot) {
+        Protocol::Message msg;
+        msg.t = "md_in";
+        msg.i.reserve(item.snapshot.size());
+        for (const auto& entry : item.snapshot) {
+            Protocol::MetaInfo meta;
+            meta.d = entry.first;
+            meta.v = QString::number(entry.second);
+            msg.i.append(meta);
+        }
+        payload = Protocol::createJsonMessage(Protocol::messageToJson(msg)).toUtf8();
+    }
+
+    if (item.sourcePort == 0) {
+        m_udpInterface->sendBytes(item.address, item.port, payload);
+    } else {
+        m_udpInterface->sendBytesByPort(item.sourcePort, item.address, item.port, payload);
+    }
 }
 
 void MetaManage::onNECDataReceived(const QHostAddress& senderAddress, quint16 senderPort, const QByteArray& data)
 {
-    Q_UNUSED(senderAddress)
-    Q_UNUSED(senderPort)
-
-    try {
-        processNECMessage(QString::fromUtf8(data));
-    } catch (const std::exception& e) {
-        Logger::instance().error(QString("Error processing NEC data: %1").arg(e.what()));
-    }
+    enqueueInbound(MessageSource::NEC, senderAddress, senderPort, data);
 }
 
 void MetaManage::onInterfaceDataReceived(const QHostAddress& senderAddress, quint16 senderPort, const QByteArray& data)
 {
-    try {
-        processInterfaceMessage(senderAddress, senderPort, QString::fromUtf8(data));
-    } catch (const std::exception& e) {
-        Logger::instance().error(QString("Error processing interface data: %1").arg(e.what()));
-    }
+    enqueueInbound(MessageSource::Interface, senderAddress, senderPort, data);
 }
 
 void MetaManage::onUDPError(const QString& errorString)
@@ -168,9 +590,9 @@ void MetaManage::onUDPError(const QString& errorString)
     Logger::instance().error(QString("UDP Error: %1").arg(errorString));
 }
 
-void MetaManage::processNECMessage(const QString& messageStr)
+void MetaManage::processNECMessage(const ParsedMessage& parsed)
 {
-    if (messageStr == "NECRunSuccess") {
+    if (parsed.runSuccess) {
         if (!m_necConnected) {
             m_necConnected = true;
             sendMessageToNEC("NENetRunSuccess");
@@ -179,12 +601,7 @@ void MetaManage::processNECMessage(const QString& messageStr)
         return;
     }
 
-    const QJsonObject msgObj = Protocol::parseJsonMessage(messageStr);
-    if (!Protocol::isValidMessage(msgObj)) {
-        return;
-    }
-
-    const auto type = Protocol::getMessageTypeEnum(msgObj.value("t").toString());
+    const auto type = parsed.type;
 
     // Legacy behavior from C# project:
     // when receiving NEC messages, trigger hardware DO commands.
@@ -195,21 +612,15 @@ void MetaManage::processNECMessage(const QString& messageStr)
     }
 }
 
-void MetaManage::processInterfaceMessage(const QHostAddress& senderAddress,
-                                         quint16 senderPort,
-                                         const QString& messageStr)
+void MetaManage::processInterfaceMessage(const ParsedMessage& parsed)
 {
-    const QJsonObject msgObj = Protocol::parseJsonMessage(messageStr);
-    if (!Protocol::isValidMessage(msgObj)) {
-        return;
-    }
-
-    const QString messageType = msgObj.value("t").toString();
-    const auto type = Protocol::getMessageTypeEnum(messageType);
+    const QHostAddress& senderAddress = parsed.sender;
+    const quint16 senderPort = parsed.senderPort;
+    const QString& messageType = parsed.typeStr;
 
-    switch (type) {
+    switch (parsed.type) {
     case Protocol::MSG_SET_VALUE:
-        if (applySetValue(messageStr)) {
+        if (applySetValue(parsed.msg)) {
             sendMessageToInterface(senderAddress, senderPort, "{\"t\":\"setValueAck\",\"ok\":1}");
             emitMdInSnapshotToNEC();
         } else {
@@ -234,27 +645,377 @@ void MetaManage::processInterfaceMessage(const QHostAddress& senderAddress,
     }
 }
 
+void MetaManage::serveHistoryQuery(const ParsedMessage& parsed)
+{
+    static const QStringList kAggregates = {"raw", "min", "max", "avg", "last", "count"};
+
+    Protocol::HistoryQuery query = parsed.history;
+    if (query.to <= 0) {
+        query.to = QDateTime::currentMSecsSinceEpoch();
+    }
+    if (query.from <= 0) {
+        query.from = query.to - kDefaultHistoryWindowMs;
+    }
+    if (query.limit <= 0) {
+        query.limit = Protocol::HistoryQuery().limit;
+    }
+
+    QJsonObject reply;
+    reply["t"] = "historyQueryAck";
+
+    QString error;
+    if (!MdHistory::instance().isRunning()) {
+        error = "history disabled";
+    } else if (query.ids.isEmpty() || query.ids.size() > kMaxHistoryIds) {
+        error = QString("ids must hold 1..%1 md ids").arg(kMaxHistoryIds);
+    } else if (query.from > query.to || query.step < 0) {
+        error = "bad time window";
+    } else if (!kAggregates.contains(query.agg)) {
+        error = "unknown agg";
+    } else if (query.step > 0 && (query.to - query.from) / query.step > kMaxHistoryBuckets) {
+        error = "step too small for the window";
+    }
+
+    if (!error.isEmpty()) {
+        reply["ok"] = 0;
+        reply["err"] = error;
+        sendMessageToInterface(parsed.sender, parsed.senderPort, Protocol::createJsonMessage(reply));
+        return;
+    }
+
+    const QHash<int, QVector<HistorySample>> ranges = MdHistory::instance().range(query.ids, query.from, query.to);
+    const bool raw = query.agg == "raw";
+
+    QJsonArray results;
+    for (int mdId : query.ids) {
+        const QVector<HistorySample> samples = ranges.value(mdId);
+
+        QJsonObject entry;
+        entry["d"] = mdId;
+
+        if (query.step == 0 && raw) {
+            // newest samples win when the window holds more than limit
+            const int first = qMax(0, samples.size() - query.limit);
+            QJsonArray points;
+            for (int i = first; i < samples.size(); ++i) {
+                points.append(QJsonArray{static_cast<double>(samples[i].tsMs), samples[i].value});
+            }
+            entry["s"] = points;
+            if (first > 0) {
+                entry["more"] = 1;
+            }
+        } else if (query.step == 0) {
+            // whole window as a single bucket
+            const QVector<HistoryBucket> whole = MdHistory::downsample(samples, query.from, query.to - query.from + 1);
+            entry["n"] = whole.isEmpty() ? 0 : whole.first().count;
+            if (!whole.isEmpty()) {
+                entry["v"] = historyAggregate(whole.first(), query.agg);
+            }
+        } else {
+            const QVector<HistoryBucket> buckets = MdHistory::downsample(samples, query.from, query.step);
+            const int first = qMax(0, buckets.size() - query.limit);
+            QJsonArray rows;
+            for (int i = first; i < buckets.size(); ++i) {
+                const HistoryBucket& bucket = buckets[i];
+                if (raw) {
+                    rows.append(QJsonArray{static_cast<double>(bucket.startMs), bucket.min, bucket.max,
+                                           bucket.avg, bucket.last, bucket.count});
+                } else {
+                    rows.append(QJsonArray{static_cast<double>(bucket.startMs), historyAggregate(bucket, query.agg)});
+                }
+            }
+            entry["b"] = rows;
+            if (first > 0) {
+                entry["more"] = 1;
+            }
+        }
+
+        results.append(entry);
+    }
+
+    reply["ok"] = 1;
+    reply["r"] = results;
+
+    QString payload = Protocol::createJsonMessage(reply);
+    if (payload.toUtf8().size() > kMaxHistoryReplyBytes) {
+        QJsonObject tooLarge;
+        tooLarge["t"] = "historyQueryAck";
+        tooLarge["ok"] = 0;
+        tooLarge["err"] = "reply too large, use fewer ids, a larger step or a smaller limit";
+        payload = Protocol::createJsonMessage(tooLarge);
+    }
+    sendMessageToInterface(parsed.sender, parsed.senderPort, payload);
+}
+
+bool MetaManage::requestReload()
+{
+    // fingerprint first: a change racing the reads makes it look stale, never fresh
+    TableFingerprint fingerprint;
+    const bool haveFingerprint = DBQueries::selectTableFingerprint(fingerprint);
+
+    auto data = QSharedPointer<ReloadData>::create();
+    if (!DBQueries::selectAllPlates(data->plates) || !DBQueries::selectAllMetaInfo(data->mds)) {
+        Logger::instance().error("Reload aborted: failed to read plate/md tables");
+        return false;
+    }
+    TableCache::instance().setReloadedFingerprint(haveFingerprint ? fingerprint.plates : QString(),
+                                                  haveFingerprint ? fingerprint.mds : QString());
+
+    ParsedMessage request;
+    request.source = MessageSource::Control;
+    request.reload = data;
+    request.receivedNs = PipelineClock::nowNs();
+    request.enqueuedNs = request.receivedNs;
+    return m_stateQueue.push(std::move(request));
+}
+
+bool MetaManage::requestPartialReload(const QVector<QPair<int, int>>& plateRanges,
+                                      const QVector<QPair<int, int>>& mdRanges)
+{
+    TableFingerprint fingerprint;
+    const bool haveFingerprint = DBQueries::selectTableFingerprint(fingerprint);
+
+    auto data = QSharedPointer<ReloadData>::create();
+    data->partial = true;
+    data->plateRanges = plateRanges;
+    data->mdRanges = mdRanges;
+    for (const auto& range : plateRanges) {
+        if (!DBQueries::selectPlatesInRange(range.first, range.second, data->plates)) {
+            Logger::instance().error("Partial reload aborted: failed to read ne_plate_type");
+            return false;
+        }
+    }
+    for (const auto& range : mdRanges) {
+        if (!DBQueries::selectMetaInfoInRange(range.first, range.second, data->mds)) {
+            Logger::instance().error("Partial reload aborted: failed to read ne_md_info");
+            return false;
+        }
+    }
+    TableCache::instance().setReloadedFingerprint(haveFingerprint ? fingerprint.plates : QString(),
+                                                  haveFingerprint ? fingerprint.mds : QString());
+
+    ParsedMessage request;
+    request.source = MessageSource::Control;
+    request.reload = data;
+    request.receivedNs = PipelineClock::nowNs();
+    request.enqueuedNs = request.receivedNs;
+    return m_stateQueue.push(std::move(request));
+}
+
+void MetaManage::applyReload(const ReloadData& data)
+{
+    GlobalData& global = GlobalData::instance();
+    QList<ne_plate>& plateList = global.getPlatelist();
+    QMap<int, ne_plate>& plateDict = global.getPlateDict();
+    QList<ne_md_info>& mdList = global.getMetaInfoList();
+    QMap<int, JFHardControl>& jfHardDict = global.getJFHardDict();
+
+    // a partial reload is diffed against the live rows inside its ranges only
+    QList<ne_plate> livePlates;
+    QList<ne_md_info> liveMds;
+    if (data.partial) {
+        for (const auto& plate : plateList) {
+            if (inRanges(plate.pk_id, data.plateRanges)) {
+                livePlates.append(plate);
+            }
+        }
+        for (const auto& md : mdList) {
+            if (inRanges(md.pk_id, data.mdRanges)) {
+                liveMds.append(md);
+            }
+        }
+    }
+
+    const TopologyDiff diff = data.partial
+        ? TopologyBuilder::diff(livePlates, liveMds, data.plates, data.mds)
+        : TopologyBuilder::diff(plateList, mdList, data.plates, data.mds);
+    if (diff.isEmpty()) {
+        Logger::instance().info("Reload: no changes");
+        return;
+    }
+
+    // Controllers whose own row or any child row changed are rebuilt as a
+    // unit; every other controller only gets md slot updates.
+    QSet<int> dirtyControllers;
+    for (const auto& plate : diff.insertedPlates) {
+        dirtyControllers.insert(TopologyBuilder::owningController(plate));
+    }
+    for (const auto& plate : diff.updatedPlates) {
+        dirtyControllers.insert(TopologyBuilder::owningController(plate));
+        dirtyControllers.insert(TopologyBuilder::owningController(plateDict.value(plate.pk_id)));
+    }
+    for (int plateId : diff.deletedPlateIds) {
+        dirtyControllers.insert(TopologyBuilder::owningController(plateDict.value(plateId)));
+    }
+
+    // md rows: apply to the list and the route cache, unmap old slots.
+    QSet<int> deletedMdIds;
+    for (int mdId : diff.deletedMdIds) {
+        const ne_md_info& old = mdList[m_mdIndexById.value(mdId)];
+        TopologyBuilder::unmapMetadata(jfHardDict, old);
+        m_metaRouteById.remove(mdId);
+        deletedMdIds.insert(mdId);
+    }
+    for (const auto& md : diff.updatedMds) {
+        ne_md_info& live = mdList[m_mdIndexById.value(md.pk_id)];
+        TopologyBuilder::unmapMetadata(jfHardDict, live);
+        const int currentValue = live.current_value;
+        const QString currentValueStr = live.current_value_str;
+        live = md;
+        live.current_value = currentValue;  // runtime value stays authoritative
+        live.current_value_str = currentValueStr;
+        setMetaRoute(live);
+    }
+    if (!deletedMdIds.isEmpty()) {
+        for (int i = mdList.size() - 1; i >= 0; --i) {
+            if (deletedMdIds.contains(mdList[i].pk_id)) {
+                mdList.removeAt(i);
+            }
+        }
+    }
+    for (const auto& md : diff.insertedMds) {
+        mdList.append(md);
+        setMetaRoute(md);
+    }
+    if (!deletedMdIds.isEmpty()) {
+        rebuildMdIndex();       // removals shift every later index
+    } else {
+        for (int i = mdList.size() - diff.insertedMds.size(); i < mdList.size(); ++i) {
+            m_mdIndexById.insert(mdList[i].pk_id, i);
+        }
+    }
+
+    // plate rows
+    for (int plateId : diff.deletedPlateIds) {
+        plateDict.remove(plateId);
+    }
+    for (const auto& plate : diff.updatedPlates) {
+        plateDict[plate.pk_id] = plate;
+    }
+    for (const auto& plate : diff.insertedPlates) {
+        plateDict[plate.pk_id] = plate;
+    }
+    if (diff.hasPlateChanges() && !data.partial) {
+        plateList = data.plates;
+    } else if (diff.hasPlateChanges()) {
+        QSet<int> deletedPlateIds;
+        for (int plateId : diff.deletedPlateIds) {
+            deletedPlateIds.insert(plateId);
+        }
+        for (int i = plateList.size() - 1; i >= 0; --i) {
+            if (deletedPlateIds.contains(plateList[i].pk_id)) {
+                plateList.removeAt(i);
+            } else if (plateDict.contains(plateList[i].pk_id)) {
+                plateList[i] = plateDict.value(plateList[i].pk_id);
+            }
+        }
+        plateList.append(diff.insertedPlates);
+    }
+
+    // Rebuild dirty controllers from the new rows, keeping live channel values.
+    JFPlatePool& pool = JFPlatePool::instance();
+    for (int controlId : dirtyControllers) {
+        const bool existed = jfHardDict.contains(controlId);
+        const JFHardControl old = jfHardDict.take(controlId);
+
+        const auto plateIt = plateDict.constFind(controlId);
+        if (plateIt == plateDict.constEnd() || !TopologyBuilder::isController(plateIt.value())) {
+            if (existed) {
+                pool.removeSession(controlId);
+            }
+            continue;
+        }
+
+        QList<ne_plate> children;
+        for (const auto& plate : plateList) {
+            if (!TopologyBuilder::isController(plate) && plate.plate_parent_id == controlId) {
+                children.append(plate);
+            }
+        }
+        QList<ne_md_info> mds;
+        for (const auto& md : mdList) {
+            if (TopologyBuilder::owningController(md) == controlId) {
+                mds.append(md);
+            }
+        }
+
+        JFHardControl rebuilt = TopologyBuilder::buildController(plateIt.value(), children, mds);
+        for (auto it = old.allDOValue.constBegin(); it != old.allDOValue.constEnd(); ++it) {
+            if (rebuilt.allDOValue.contains(it.key())) {
+                rebuilt.allDOValue[it.key()] = it.value();
+            }
+        }
+        for (auto it = old.allDIValue.constBegin(); it != old.allDIValue.constEnd(); ++it) {
+            if (rebuilt.allDIValue.contains(it.key())) {
+                rebuilt.allDIValue[it.key()] = it.value();
+            }
+        }
+        jfHardDict.insert(controlId, rebuilt);
+
+        if (!existed || !TopologyBuilder::sameConnection(old, rebuilt)) {
+            pool.addSession(rebuilt);
+        }
+    }
+
+    // Remaining md slot changes on untouched controllers.
+    for (const auto& md : diff.updatedMds) {
+        if (!dirtyControllers.contains(TopologyBuilder::owningController(md))) {
+            TopologyBuilder::mapMetadata(jfHardDict, md);
+        }
+    }
+    for (const auto& md : diff.insertedMds) {
+        if (!dirtyControllers.contains(TopologyBuilder::owningController(md))) {
+            TopologyBuilder::mapMetadata(jfHardDict, md);
+        }
+    }
+
+    Logger::instance().info(
+        QString("Reload applied: plates +%1 ~%2 -%3, md +%4 ~%5 -%6, controllers rebuilt=%7")
+            .arg(diff.insertedPlates.size())
+            .arg(diff.updatedPlates.size())
+            .arg(diff.deletedPlateIds.size())
+            .arg(diff.insertedMds.size())
+            .arg(diff.updatedMds.size())
+            .arg(diff.deletedMdIds.size())
+            .arg(dirtyControllers.size()));
+
+    emitMdInSnapshotToNEC();
+}
+
 void MetaManage::rebuildMetaRouteCache()
 {
     m_metaRouteById.clear();
     const QList<ne_md_info>& mdList = GlobalData::instance().getMetaInfoList();
 
     for (const auto& md : mdList) {
-        MetaRoute route;
-        route.mdId = md.pk_id;
-        route.plateType = md.plate_type_id;
-        route.controlId = md.plate_control_id;
-        route.hardAddr = md.plate_hard_addr;
-        route.tport = md.tport;
-        m_metaRouteById[md.pk_id] = route;
+        setMetaRoute(md);
+    }
+    rebuildMdIndex();
+}
+
+void MetaManage::rebuildMdIndex()
+{
+    const QList<ne_md_info>& mdList = GlobalData::instance().getMetaInfoList();
+    m_mdIndexById.clear();
+    m_mdIndexById.reserve(mdList.size());
+    for (int i = 0; i < mdList.size(); ++i) {
+        m_mdIndexById.insert(mdList[i].pk_id, i);
     }
 }
 
-bool MetaManage::applySetValue(const QString& messageStr)
+void MetaManage::setMetaRoute(const ne_md_info& md)
 {
-    const QJsonObject msgObj = Protocol::parseJsonMessage(messageStr);
-    const Protocol::Message msg = Protocol::parseMessage(msgObj);
+    MetaRoute route;
+    route.mdId = md.pk_id;
+    route.plateType = md.plate_type_id;
+    route.controlId = md.plate_control_id;
+    route.hardAddr = md.plate_hard_addr;
+    route.tport = md.tport;
+    m_metaRouteById[md.pk_id] = route;
+}
 
+bool MetaManage::applySetValue(const Protocol::Message& msg)
+{
     if (msg.i.isEmpty()) {
         return false;
     }
@@ -274,29 +1035,49 @@ bool MetaManage::applySetValue(const QString& messageStr)
         return false;
     }
 
-    if (!DBQueries::updateMetadataValues(updates)) {
+    // Ack timing follows the configured durability (memory / journal / db).
+    if (!MdPersister::instance().submit(updates)) {
         return false;
     }
 
     QMap<int, JFHardControl>& jfHardDict = GlobalData::instance().getJFHardDict();
     QList<ne_md_info>& mdList = GlobalData::instance().getMetaInfoList();
+    QList<QPair<int, int>> changes;
+    QHash<int, QMap<int, quint16>> doWrites;     // controlId -> hard addr -> module bits
 
     for (const auto& item : updates) {
         const int mdId = item.first;
         const int v = item.second;
 
-        for (auto& md : mdList) {
-            if (md.pk_id == mdId) {
-                md.current_value = v;
-                break;
+        // a board value still waiting for a retry must not overwrite this write
+        m_unpersistedHardware.remove(mdId);
+
+        const auto indexIt = m_mdIndexById.constFind(mdId);
+        if (indexIt != m_mdIndexById.constEnd()) {
+            ne_md_info& md = mdList[indexIt.value()];
+            if (md.current_value != v) {
+                changes.append(item);
             }
+            md.current_value = v;
         }
 
         const MetaRoute& route = m_metaRouteById[mdId];
         if (route.plateType == 3 && jfHardDict.contains(route.controlId) &&
             jfHardDict[route.controlId].allDOValue.contains(route.hardAddr) &&
             route.tport >= 0 && route.tport < 16) {
-            jfHardDict[route.controlId].allDOValue[route.hardAddr][route.tport] = v;
+            QVector<int>& module = jfHardDict[route.controlId].allDOValue[route.hardAddr];
+            module[route.tport] = v;
+            // Off unless [HardIO] ForwardDO: the setDO layout is unconfirmed.
+            // The whole module goes out, addressed like the board's getDO report.
+            if (m_forwardDO) {
+                quint16 bits = 0;
+                for (int tport = 0; tport < module.size() && tport < 16; ++tport) {
+                    if (module[tport] != 0) {
+                        bits |= static_cast<quint16>(1u << tport);
+                    }
+                }
+                doWrites[route.controlId][route.hardAddr] = bits;
+            }
         }
 
         if (route.plateType == 4 && jfHardDict.contains(route.controlId) &&
@@ -306,53 +1087,66 @@ bool MetaManage::applySetValue(const QString& messageStr)
         }
     }
 
+    // one post per board; the session merges the writes into a single setDO frame
+    JFPlatePool& pool = JFPlatePool::instance();
+    for (auto it = doWrites.constBegin(); it != doWrites.constEnd(); ++it) {
+        const QMap<int, quint16> modules = it.value();
+        pool.post(it.key(), [modules](JFPlate& plate) {
+            for (auto module = modules.constBegin(); module != modules.constEnd(); ++module) {
+                plate.setEachDO(module.key(), module.value());
+            }
+        }, false);
+    }
+
+    MdHistory::instance().record(changes);
     return allKnown;
 }
 
 void MetaManage::emitMdInSnapshotToNEC()
 {
-    Protocol::Message msg;
-    msg.t = "md_in";
+    // Copy values here (state owner); JSON serialization happens on egress.
+    const auto& config = GlobalData::instance().getConfig();
+
+    EgressItem item;
+    item.kind = EgressItem::MdSnapshot;
+    item.sourcePort = static_cast<quint16>(config.network.nenet_nec_port);
+    item.address = QHostAddress(config.network.nec_ip);
+    item.port = static_cast<quint16>(config.network.nec_port);
 
     const QList<ne_md_info>& mdList = GlobalData::instance().getMetaInfoList();
+    item.snapshot.reserve(mdList.size());
     for (const auto& md : mdList) {
-        Protocol::MetaInfo meta;
-        meta.d = md.pk_id;
-        meta.v = QString::number(md.current_value);
-        meta.n = 0;
-        meta.model = 0;
-        msg.i.append(meta);
+        item.snapshot.append(qMakePair(md.pk_id, md.current_value));
     }
 
-    sendMessageToNEC(Protocol::createJsonMessage(Protocol::messageToJson(msg)));
+    enqueueEgress(std::move(item));
 }
 
 void MetaManage::triggerLegacyNecHardwareDO()
 {
-    // 当前阶段先基于控制器数量即时触发，等后续接入真实 JFPlate 实例池。
-    QMap<int, JFHardControl>& jfHardDict = GlobalData::instance().getJFHardDict();
+    // Flush pending DO on the pooled, already-authenticated sessions; the
+    // socket writes themselves run on the pool's I/O thread.
+    const QMap<int, JFHardControl>& jfHardDict = GlobalData::instance().getJFHardDict();
+    JFPlatePool& pool = JFPlatePool::instance();
 
     int okCount = 0;
-    int failCount = 0;
-
-    for (auto it = jfHardDict.begin(); it != jfHardDict.end(); ++it) {
-        Q_UNUSED(it)
-
-        JFPlate eachJfP;
-        eachJfP.initialize();
+    int skipCount = 0;
 
-        const bool ok1 = eachJfP.setEachDO(true, 0, 0);
-        const bool ok2 = eachJfP.setSlaveEachDO(true, 0, 0);
+    for (auto it = jfHardDict.constBegin(); it != jfHardDict.constEnd(); ++it) {
+        const bool queued = pool.post(it.key(), [](JFPlate& plate) {
+            plate.flushDO();
+            plate.setSlaveEachDO(true, 0, 0);
+        });
 
-        if (ok1 && ok2) {
+        if (queued) {
             ++okCount;
         } else {
-            ++failCount;
+            ++skipCount;
         }
     }
 
-    Logger::instance().info(QString("triggerLegacyNecHardwareDO executed, controllers=%1, ok=%2, fail=%3")
-                                .arg(jfHardDict.size())
-                                .arg(okCount)
-                                .arg(failCount));
+    Logger::instance().debug(QString("triggerLegacyNecHardwareDO executed, controllers=%1, queued=%2, notReady=%3")
+                                 .arg(jfHardDict.size())
+                                 .arg(okCount)
+                                 .arg(skipCount));
 }
@@ -2,11 +2,20 @@
 #define META_MANAGE_H
 
 #include <QString>
+#include <QStringList>
 #include <QObject>
 #include <QMap>
+#include <QHash>
 #include <QHostAddress>
 #include <QList>
+#include <QVector>
+#include <QPair>
+#include <QSharedPointer>
+#include <atomic>
 #include "network/protocol.h"
+#include "database/data_structures.h"
+#include "bounded_queue.h"
+#include "pipeline_stats.h"
 
 class UDPInterface;
 class QThread;
@@ -14,6 +23,14 @@ class QThread;
 /**
  * @brief Metadata management and core processing
  * Handles UDP communication with NEC, Interface, and QI services
+ *
+ * Inbound datagrams flow through a staged pipeline so that slow work never
+ * stalls socket receive:
+ *   UDP worker (receive) -> parser -> state writer -> egress
+ * Each arrow is a BoundedQueue. The state writer is the only thread that
+ * mutates metadata values, the route cache and the hardware maps after
+ * initialize() returns. historyQuery requests branch off at the parser to
+ * a history thread, which reads MdHistory only and replies via egress.
  */
 class MetaManage : public QObject
 {
@@ -25,12 +42,39 @@ public:
     bool initialize();
     void cleanup();
 
+    /**
+     * @brief Apply queued board channel changes to md values (state writer thread)
+     */
     void processHardwareEvents();
     void sendToNECClients();
     void sendMessageToNEC(const QString& message);
     void sendMessageToInterface(const QHostAddress& address, quint16 port, const QString& message);
     void sendMessageToQI(const QString& message);
 
+    /**
+     * @brief Reload ne_plate / ne_md_info and apply only the differences
+     *
+     * Rows are read on the calling thread; the diff is computed and applied
+     * by the state writer between two messages, so traffic keeps flowing.
+     * @return false if the tables could not be read
+     */
+    bool requestReload();
+
+    /**
+     * @brief Reload only the plate / md rows whose pk_id falls in the given ranges
+     *
+     * Same as requestReload() restricted to [first, second] id ranges, for
+     * changes found by ChangeDetector. Live rows inside a range that are
+     * missing from the fetched rows count as deleted.
+     */
+    bool requestPartialReload(const QVector<QPair<int, int>>& plateRanges,
+                              const QVector<QPair<int, int>>& mdRanges);
+
+    /**
+     * @brief Queue depths and per-stage latency, one line per item
+     */
+    QStringList pipelineReport() const;
+
     UDPInterface* getUDPInterface() const { return m_udpInterface; }
 
 private slots:
@@ -48,29 +92,128 @@ private:
         int tport = 0;
     };
 
+    enum class MessageSource {
+        NEC,
+        Interface,
+        Control     // internal requests (reload, hardware events), bypass the parser
+    };
+
+    struct ReloadData {
+        QList<ne_plate> plates;
+        QList<ne_md_info> mds;
+        bool partial = false;                   // rows cover only the ranges below
+        QVector<QPair<int, int>> plateRanges;
+        QVector<QPair<int, int>> mdRanges;
+    };
+
+    // receive -> parser
+    struct InboundDatagram {
+        MessageSource source = MessageSource::NEC;
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        QByteArray data;
+        qint64 receivedNs = 0;
+    };
+
+    // parser -> state writer
+    struct ParsedMessage {
+        MessageSource source = MessageSource::NEC;
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        bool runSuccess = false;    // bare "NECRunSuccess" handshake
+        bool valid = false;
+        Protocol::MessageType type = Protocol::MSG_UNKNOWN;
+        QString typeStr;
+        Protocol::Message msg;      // body, only parsed for setValue
+        QSharedPointer<ReloadData> reload;  // Control: freshly loaded tables
+        bool hardwareEvents = false;        // Control: drain the hardware event queue
+        Protocol::HistoryQuery history;     // historyQuery request
+        qint64 receivedNs = 0;
+        qint64 enqueuedNs = 0;
+    };
+
+    // state writer -> egress
+    struct EgressItem {
+        enum Kind {
+            Datagram,
+            MdSnapshot
+        };
+
+        Kind kind = Datagram;
+        quint16 sourcePort = 0;     // 0: any bound worker
+        QHostAddress address;
+        quint16 port = 0;
+        QByteArray payload;
+        QVector<QPair<int, int>> snapshot;  // (md id, value) for MdSnapshot
+        qint64 receivedNs = 0;      // 0 when not caused by an inbound message
+        qint64 enqueuedNs = 0;
+    };
+
     MetaManage(QObject* parent = nullptr);
     ~MetaManage() override;
 
     MetaManage(const MetaManage&) = delete;
     MetaManage& operator=(const MetaManage&) = delete;
 
-    void processNECMessage(const QString& messageStr);
-    void processInterfaceMessage(const QHostAddress& senderAddress, quint16 senderPort, const QString& messageStr);
+    // pipeline stages
+    void startPipeline();
+    void stopPipeline();
+    void enqueueInbound(MessageSource source, const QHostAddress& senderAddress,
+                        quint16 senderPort, const QByteArray& data);
+    void parserLoop();
+    void writerLoop();
+    void egressLoop();
+    void historyLoop();
+    void enqueueEgress(EgressItem item);
+    void transmit(const EgressItem& item);
+
+    // state writer
+    void processNECMessage(const ParsedMessage& parsed);
+    void processInterfaceMessage(const ParsedMessage& parsed);
+
+    // history thread
+    void serveHistoryQuery(const ParsedMessage& parsed);
+
+    void applyReload(const ReloadData& data);
 
     void rebuildMetaRouteCache();
-    bool applySetValue(const QString& messageStr);
+    void rebuildMdIndex();
+    void setMetaRoute(const ne_md_info& md);
+    bool applySetValue(const Protocol::Message& msg);
     void emitMdInSnapshotToNEC();
     void triggerLegacyNecHardwareDO();
 
     UDPInterface* m_udpInterface = nullptr;
-    QThread* m_sendThread = nullptr;
+    QThread* m_parserThread = nullptr;
+    QThread* m_writerThread = nullptr;
+    QThread* m_egressThread = nullptr;
+    QThread* m_historyThread = nullptr;
+
+    BoundedQueue<InboundDatagram> m_parseQueue;
+    BoundedQueue<ParsedMessage> m_stateQueue;
+    BoundedQueue<EgressItem> m_egressQueue;
+    BoundedQueue<ParsedMessage> m_historyQueue;
+
+    StageStats m_parseStats;
+    StageStats m_writerStats;
+    StageStats m_egressStats;
+    StageStats m_endToEndStats;
 
     bool m_necConnected = false;
     quint16 m_necPort = 6001;
     quint16 m_interfacePort = 7000;
+    bool m_forwardDO = false;       // setValue drives JF DO outputs ([HardIO] ForwardDO)
+
+    // receive time of the message the state writer is currently handling
+    qint64 m_currentReceivedNs = 0;
+    std::atomic<bool> m_hardwareEventsPending{false};  // set by the notifier, cleared by the writer
+    std::atomic<quint64> m_unhandledHardwareEvents{0};  // CAN data/error events, no md mapping yet
 
     QMap<QString, QPair<QHostAddress, quint16>> m_registeredClients;
     QMap<int, MetaRoute> m_metaRouteById;
+    QHash<int, int> m_mdIndexById;      // md pk_id -> index in GlobalData's md list, writer-owned
+    QHash<int, int> m_unpersistedHardware;  // md id -> board value the persister rejected, retried
+    qint64 m_hardwareRetryDueNs = 0;
 };
 
 #endif // META_MANAGE_H
@@ -0,0 +1,95 @@
+#include "pipeline_stats.h"
+#include <QElapsedTimer>
+#include <QtAlgorithms>
+
+qint64 PipelineClock::nowNs()
+{
+    static const QElapsedTimer s_timer = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return s_timer.nsecsElapsed();
+}
+
+void StageStats::record(qint64 queueWaitNs, qint64 serviceNs)
+{
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_waitTotalNs.fetch_add(queueWaitNs, std::memory_order_relaxed);
+    m_serviceTotalNs.fetch_add(serviceNs, std::memory_order_relaxed);
+    updateMax(m_waitMaxNs, queueWaitNs);
+    updateMax(m_serviceMaxNs, serviceNs);
+}
+
+void StageStats::reset()
+{
+    m_count.store(0, std::memory_order_relaxed);
+    m_waitTotalNs.store(0, std::memory_order_relaxed);
+    m_waitMaxNs.store(0, std::memory_order_relaxed);
+    m_serviceTotalNs.store(0, std::memory_order_relaxed);
+    m_serviceMaxNs.store(0, std::memory_order_relaxed);
+}
+
+QString StageStats::summary(const QString& stageName) const
+{
+    const quint64 n = m_count.load(std::memory_order_relaxed);
+    const qint64 waitAvgUs = n ? m_waitTotalNs.load(std::memory_order_relaxed) / static_cast<qint64>(n) / 1000 : 0;
+    const qint64 serviceAvgUs = n ? m_serviceTotalNs.load(std::memory_order_relaxed) / static_cast<qint64>(n) / 1000 : 0;
+
+    return QString("%1: count=%2 wait(avg/max)=%3/%4us service(avg/max)=%5/%6us")
+        .arg(stageName)
+        .arg(n)
+        .arg(waitAvgUs)
+        .arg(m_waitMaxNs.load(std::memory_order_relaxed) / 1000)
+        .arg(serviceAvgUs)
+        .arg(m_serviceMaxNs.load(std::memory_order_relaxed) / 1000);
+}
+
+void StageStats::updateMax(std::atomic<qint64>& target, qint64 value)
+{
+    qint64 current = target.load(std::memory_order_relaxed);
+    while (value > current &&
+           !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::record(qint64 us)
+{
+    int bucket = 0;
+    if (us > 1) {
+        bucket = qMin(kBuckets - 1, 63 - static_cast<int>(qCountLeadingZeroBits(static_cast<quint64>(us))));
+    }
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+}
+
+qint64 LatencyHistogram::percentileUs(double percentile) const
+{
+    quint64 total = 0;
+    quint64 counts[kBuckets];
+    for (int i = 0; i < kBuckets; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    const quint64 rank = qMax<quint64>(1, static_cast<quint64>(total * qBound(0.0, percentile, 100.0) / 100.0 + 0.5));
+    quint64 seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return qint64(1) << (i + 1);
+        }
+    }
+    return qint64(1) << kBuckets;
+}
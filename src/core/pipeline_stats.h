@@ -0,0 +1,80 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @brief Monotonic clock shared by all pipeline stages
+ */
+class PipelineClock
+{
+public:
+    /**
+     * @brief Nanoseconds since process start (monotonic)
+     */
+    static qint64 nowNs();
+
+private:
+    PipelineClock() = delete;
+};
+
+/**
+ * @brief Lock-free latency counters for one pipeline stage
+ *
+ * Queue wait is the time an item spent in the stage's input queue,
+ * service time is the time the stage spent processing it.
+ */
+class StageStats
+{
+public:
+    void record(qint64 queueWaitNs, qint64 serviceNs);
+    void reset();
+
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief One-line summary: count, avg/max wait and service in microseconds
+     */
+    QString summary(const QString& stageName) const;
+
+private:
+    static void updateMax(std::atomic<qint64>& target, qint64 value);
+
+    std::atomic<quint64> m_count{0};
+    std::atomic<qint64> m_waitTotalNs{0};
+    std::atomic<qint64> m_waitMaxNs{0};
+    std::atomic<qint64> m_serviceTotalNs{0};
+    std::atomic<qint64> m_serviceMaxNs{0};
+};
+
+/**
+ * @brief Lock-free power-of-two latency histogram
+ *
+ * Bucket i counts samples in [2^i, 2^(i+1)) microseconds (bucket 0 also
+ * takes everything below 1 us), so percentiles are upper bounds accurate
+ * to a factor of two.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int kBuckets = 32;
+
+    void record(qint64 us);
+    void reset();
+
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Upper bound of the bucket holding the given percentile, 0 if empty
+     * @param percentile 0..100
+     */
+    qint64 percentileUs(double percentile) const;
+
+private:
+    std::atomic<quint64> m_buckets[kBuckets] = {};
+    std::atomic<quint64> m_count{0};
+};
+
+#endif // PIPELINE_STATS_H
@@ -4,24 +4,119 @@
 #include "config/ini_config.h"
 #include "database/db_connection.h"
 #include "database/db_queries.h"
+#include "database/md_persister.h"
 #include "hardware/can_interface.h"
+#include "hardware/jf_plate_pool.h"
+#include "hardware/jf_poll_scheduler.h"
 #include "meta_manage.h"
+#include "topology_builder.h"
+#include "table_cache.h"
+#include "md_history.h"
+#include "change_detector.h"
 #include <QCoreApplication>
 #include <QDir>
 #include <QVector>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QtConcurrent>
+
+namespace {
+
+template <typename Row>
+struct TableLoad
+{
+    QList<Row> rows;
+    bool ok = false;
+    qint64 elapsedMs = 0;
+};
+
+/**
+ * @brief Run one DBQueries loader on the global thread pool
+ *
+ * Pool threads get their own database connection from DBConnection.
+ */
+template <typename Row>
+QFuture<TableLoad<Row>> loadTableAsync(bool (*loader)(QList<Row>&))
+{
+    return QtConcurrent::run([loader] {
+        TableLoad<Row> result;
+        QElapsedTimer timer;
+        timer.start();
+        result.ok = loader(result.rows);
+        result.elapsedMs = timer.elapsed();
+        return result;
+    });
+}
+
+/**
+ * @brief Cold start: load the three tables in parallel and build the maps
+ * @return false if any table failed to load
+ */
+bool loadTablesFromDatabase(TopologyStats& topo)
+{
+    Logger::instance().info("Loading plate, metadata and flow tables...");
+    QFuture<TableLoad<ne_plate>> plateLoad = loadTableAsync(&DBQueries::selectAllPlates);
+    QFuture<TableLoad<ne_md_info>> mdLoad = loadTableAsync(&DBQueries::selectAllMetaInfo);
+    QFuture<TableLoad<ne_flow_info>> flowLoad = loadTableAsync(&DBQueries::selectAllFlowInfo);
+
+    QList<ne_plate>& plateList = GlobalData::instance().getPlatelist();
+    QMap<int, ne_plate>& plateDict = GlobalData::instance().getPlateDict();
+
+    const TableLoad<ne_plate> plates = plateLoad.result();
+    if (!plates.ok) {
+        Logger::instance().warning("Failed to load plates from database");
+    }else {
+        plateList = plates.rows;
+        plateDict.clear();
+        for (const auto& plate : plateList) {
+            plateDict[plate.pk_id] = plate;
+        }
+        Logger::instance().info(QString("Loaded %1 plates in %2 ms").arg(plateList.size()).arg(plates.elapsedMs));
+    }
+
+    // Lay out controllers while metadata is still loading
+    Logger::instance().info("Rebuilding legacy hardware maps...");
+    QElapsedTimer topoTimer;
+    topoTimer.start();
+    QMap<int, JFHardControl>& jfHardDict = GlobalData::instance().getJFHardDict();
+    TopologyBuilder::buildPlates(plateList, jfHardDict, topo);
+    qint64 topoMs = topoTimer.elapsed();
+
+    QList<ne_md_info>& mdInfoList = GlobalData::instance().getMetaInfoList();
+    const TableLoad<ne_md_info> mds = mdLoad.result();
+    if (!mds.ok) {
+        Logger::instance().warning("Failed to load metadata info from database");
+    }else {
+        mdInfoList = mds.rows;
+        Logger::instance().info(QString("Loaded %1 metadata items in %2 ms").arg(mdInfoList.size()).arg(mds.elapsedMs));
+    }
+
+    // Map metadata into the controllers (aligned with C# selectSqlData)
+    topoTimer.restart();
+    TopologyBuilder::mapAllMetadata(mdInfoList, jfHardDict, topo);
+    topoMs += topoTimer.elapsed();
+    Logger::instance().info(QString("Legacy hardware maps built in %1 ms").arg(topoMs));
+
+    QList<ne_flow_info>& flowInfoList = GlobalData::instance().getFlowInfoList();
+    const TableLoad<ne_flow_info> flows = flowLoad.result();
+    if (!flows.ok) {
+        Logger::instance().warning("Failed to load flow info from database");
+    }else {
+        flowInfoList = flows.rows;
+        Logger::instance().info(QString("Loaded %1 flow items in %2 ms").arg(flowInfoList.size()).arg(flows.elapsedMs));
+    }
+
+    return plates.ok && mds.ok && flows.ok;
+}
+
+} // namespace
 
 bool Startup::dataInit()
 {
     Logger::instance().info("=== Starting Data Initialization ===");
 
     try {
-        // Step 1: Initialize CAN interface
-        Logger::instance().info("Initializing CAN interface...");
-        if (!CANInterface::instance().initialize()) {
-            Logger::instance().warning("CAN interface initialization failed or not available");
-        }
-
-        // Step 2: Load configuration from INI file
+        // Step 1: Load configuration from INI file
         Logger::instance().info("Loading INI configuration...");
         const QString configPath = QCoreApplication::applicationDirPath() + "/Config/NEngineConfig.ini";
         Logger::instance().info(QString("INI config path: %1").arg(configPath));
@@ -34,10 +129,31 @@ bool Startup::dataInit()
 
         Logger::instance().info(QString("Loaded Interface_Port=%1").arg(config.network.interface_port));
         GlobalData::instance().setConfig(config);
+        GlobalData::instance().setHardwareEventCapacity(config.pipeline.hardware_queue_depth);
+
+        // Step 2: Initialize CAN interface (receiving starts once the pipeline is up)
+        Logger::instance().info("Initializing CAN interface...");
+        const bool canReady = CANInterface::instance().initialize(config.hardio.can_type,
+                                                                  config.hardio.can_channel,
+                                                                  config.hardio.can_baudrate);
+        if (!canReady) {
+            Logger::instance().warning("CAN interface initialization failed or not available");
+        }
 
         // Step 3: Initialize database connection
         Logger::instance().info("Initializing database connection...");
         DBConnection& dbConn = DBConnection::instance();
+        dbConn.setMaxConnections(config.database.max_connections);
+
+        DBConnection::SqliteOptions sqliteOptions;
+        sqliteOptions.journalMode = config.sqlite.journal_mode;
+        sqliteOptions.synchronous = config.sqlite.synchronous;
+        sqliteOptions.cacheSizeKb = config.sqlite.cache_size_kb;
+        sqliteOptions.mmapSize = config.sqlite.mmap_size;
+        sqliteOptions.tempStore = config.sqlite.temp_store;
+        sqliteOptions.busyTimeoutMs = config.sqlite.busy_timeout_ms;
+        sqliteOptions.checkpointIntervalMs = config.sqlite.checkpoint_interval_ms;
+        dbConn.setSqliteOptions(sqliteOptions);
 
         if (config.database.type == "sqlite" || config.database.type == "1") {
             QDir appDir(QCoreApplication::applicationDirPath());
@@ -60,145 +176,141 @@ bool Startup::dataInit()
             return false;
         }
 
-        // Step 4: Load plate data from database
-        Logger::instance().info("Loading plate data...");
-        QList<ne_plate>& plateList = GlobalData::instance().getPlatelist();
-        QMap<int, ne_plate>& plateDict = GlobalData::instance().getPlateDict();
+        // Step 3.1: Recover md values acked but not committed by the previous run
+        const QString journalPath = QDir(QCoreApplication::applicationDirPath()).filePath(config.persist.journal_path);
+        if (!MdPersister::instance().replayJournal(journalPath)) {
+            Logger::instance().warning("Md journal replay failed, continuing with database values");
+        }
 
-        if (!DBQueries::selectAllPlates(plateList)) {
-            Logger::instance().warning("Failed to load plates from database");
-        }else {
-            plateDict.clear();
-            for (const auto& plate : plateList) {
-                plateDict[plate.pk_id] = plate;
-            }
-            Logger::instance().info(QString("Loaded %1 plates").arg(plateList.size()));
+        const MdPersister::Durability durability = MdPersister::durabilityFromString(config.persist.mode);
+        if (!MdPersister::instance().initialize(durability, journalPath,
+                                                config.persist.flush_interval_ms,
+                                                config.persist.max_batch)) {
+            Logger::instance().error("Failed to start md persister");
+            return false;
         }
 
-        // Step 5: Load metadata information
-        Logger::instance().info("Loading metadata information...");
-        QList<ne_md_info>& mdInfoList = GlobalData::instance().getMetaInfoList();
-        if (!DBQueries::selectAllMetaInfo(mdInfoList)) {
-            Logger::instance().warning("Failed to load metadata info from database");
-        }else {
-            Logger::instance().info(QString("Loaded %1 metadata items").arg(mdInfoList.size()));
+        // Step 3.2: md value history store
+        if (config.history.enabled) {
+            const QString historyDir = QDir(QCoreApplication::applicationDirPath()).filePath(config.history.dir);
+            if (!MdHistory::instance().initialize(historyDir, config.history.ring_size, config.history.segment_mb,
+                                                  config.history.retention_hours,
+                                                  config.history.flush_interval_ms)) {
+                Logger::instance().warning("Md history store failed to start, history queries disabled");
+            }
         }
 
-        // Step 5.1: Rebuild legacy hardware maps (aligned with C# selectSqlData)
-        Logger::instance().info("Rebuilding legacy hardware maps...");
+        // Step 4: Load tables and build the hardware maps, from the
+        // warm-start cache when the database has not changed
+        QElapsedTimer loadTimer;
+        loadTimer.start();
+        QList<ne_plate>& plateList = GlobalData::instance().getPlatelist();
+        QMap<int, ne_plate>& plateDict = GlobalData::instance().getPlateDict();
+        QList<ne_md_info>& mdInfoList = GlobalData::instance().getMetaInfoList();
+        QList<ne_flow_info>& flowInfoList = GlobalData::instance().getFlowInfoList();
         QMap<int, JFHardControl>& jfHardDict = GlobalData::instance().getJFHardDict();
-        jfHardDict.clear();
+        TopologyStats topo;
 
-        int plateType2Count = 0;
-        int plateType3Count = 0;
-        int plateType4Count = 0;
-        int plateType5Count = 0;
-        int orphanChildPlateCount = 0;
+        // Baseline before the load: an edit committed while the tables load
+        // then differs from it and is reloaded by the first poll, instead of
+        // being in the baseline but not in memory.
+        if (config.reload.auto_detect) {
+            ChangeDetector::instance().captureBaseline(config.reload.bucket_size);
+        }
 
-        for (const auto& plate : plateList) {
-            const int plateType = plate.plate_type_id;
-            if (plateType == 2 || plateType == 5) {
-                JFHardControl control;
-                control.pk_id = plate.pk_id;
-                control.station_name = plate.station_name;
-                control.ip_addr = plate.ip_addr.isEmpty() ? plate.ip : plate.ip_addr;
-                control.ip_port = (plate.ip_port == 0) ? plate.port : plate.ip_port;
-                control.plantType = plateType;
-                control.login_name = plate.login_name;
-                control.login_password = plate.login_password;
-                jfHardDict[plate.pk_id] = control;
-
-                if (plateType == 2) {
-                    ++plateType2Count;
-                }else {
-                    ++plateType5Count;
-                    if (plate.hard_addr > 0) {
-                        jfHardDict[plate.pk_id].allMNdMap[plate.hard_addr] = QVector<int>(16, 0);
-                    }
-                }
-            }else if (plateType == 3 || plateType == 4) {
-                const int parentId = plate.plate_parent_id;
-                if (!jfHardDict.contains(parentId)) {
-                    ++orphanChildPlateCount;
-                    continue;
-                }
-
-                const int hardAddr = plate.hard_addr;
-                if (hardAddr <= 0) {
-                    continue;
-                }
-
-                if (plateType == 3) {
-                    jfHardDict[parentId].allDOIdMap[hardAddr] = QVector<int>(16, 0);
-                    jfHardDict[parentId].allDOValue[hardAddr] = QVector<int>(16, 0);
-                    ++plateType3Count;
-                }else {
-                    jfHardDict[parentId].allDIIdMap[hardAddr] = QVector<int>(16, 0);
-                    jfHardDict[parentId].allDIValue[hardAddr] = QVector<int>(16, 0);
-                    ++plateType4Count;
-                }
-            }
+        TableFingerprint fingerprint;
+        if (!DBQueries::selectTableFingerprint(fingerprint)) {
+            Logger::instance().warning("Table fingerprint unavailable, warm-start cache disabled for this run");
         }
+        TableCache::instance().setPath(QDir(QCoreApplication::applicationDirPath()).filePath(config.cache.path));
 
-        int mappedDOCount = 0;
-        int mappedDICount = 0;
-        int mappedMNCount = 0;
-
-        for (const auto& md : mdInfoList) {
-            if (md.plate_type_id == 3) {
-                if (jfHardDict.contains(md.plate_control_id) &&
-                    jfHardDict[md.plate_control_id].allDOIdMap.contains(md.plate_hard_addr) &&
-                    md.tport >= 0 && md.tport < 16) {
-                    jfHardDict[md.plate_control_id].allDOIdMap[md.plate_hard_addr][md.tport] = md.pk_id;
-                    jfHardDict[md.plate_control_id].allDOValue[md.plate_hard_addr][md.tport] = md.init_value;
-                    ++mappedDOCount;
-                }
-            }else if (md.plate_type_id == 4) {
-                if (jfHardDict.contains(md.plate_control_id) &&
-                    jfHardDict[md.plate_control_id].allDIIdMap.contains(md.plate_hard_addr) &&
-                    md.tport >= 0 && md.tport < 16) {
-                    jfHardDict[md.plate_control_id].allDIIdMap[md.plate_hard_addr][md.tport] = md.pk_id;
-                    jfHardDict[md.plate_control_id].allDIValue[md.plate_hard_addr][md.tport] = md.init_value;
-                    ++mappedDICount;
-                }
-            }else if (md.plate_type_id == 5) {
-                if (jfHardDict.contains(md.plate_id) &&
-                    jfHardDict[md.plate_id].allMNdMap.contains(md.plate_hard_addr) &&
-                    md.tport >= 0 && md.tport < 16) {
-                    jfHardDict[md.plate_id].allMNdMap[md.plate_hard_addr][md.tport] = md.pk_id;
-                    ++mappedMNCount;
-                }
+        bool warmStart = config.cache.enabled && fingerprint.isValid()
+            && TableCache::instance().load(fingerprint, plateList, mdInfoList, flowInfoList, jfHardDict, topo);
+        // runtime values are not fingerprinted: take them from the database, not the cache
+        int refreshedValues = 0;
+        if (warmStart && !DBQueries::refreshMetadataValues(mdInfoList, refreshedValues)) {
+            Logger::instance().warning("Md values could not be refreshed, loading the tables instead of the cache");
+            warmStart = false;
+            plateList.clear();
+            mdInfoList.clear();
+            flowInfoList.clear();
+            jfHardDict.clear();
+            topo = TopologyStats();
+        }
+        bool complete = true;
+        if (warmStart) {
+            plateDict.clear();
+            for (const auto& plate : plateList) {
+                plateDict[plate.pk_id] = plate;
             }
+            Logger::instance().info(QString("Warm start: %1 md values differed from the cache").arg(refreshedValues));
+        }else {
+            complete = loadTablesFromDatabase(topo);
         }
+        // a partial load must never be cached as if it were the database
+        TableCache::instance().setLoadedFingerprint(complete ? fingerprint : TableFingerprint());
+        Logger::instance().info(QString("Table load and topology finished in %1 ms (%2 start)")
+                                    .arg(loadTimer.elapsed())
+                                    .arg(warmStart ? "warm" : "cold"));
 
         Logger::instance().info(
             QString("Legacy map stats: type2=%1, type3=%2, type4=%3, type5=%4, orphanChildren=%5")
-                .arg(plateType2Count)
-                .arg(plateType3Count)
-                .arg(plateType4Count)
-                .arg(plateType5Count)
-                .arg(orphanChildPlateCount));
+                .arg(topo.plateType2)
+                .arg(topo.plateType3)
+                .arg(topo.plateType4)
+                .arg(topo.plateType5)
+                .arg(topo.orphanChildren));
         Logger::instance().info(
             QString("Legacy md map stats: DO=%1, DI=%2, MN=%3")
-                .arg(mappedDOCount)
-                .arg(mappedDICount)
-                .arg(mappedMNCount));
+                .arg(topo.mappedDO)
+                .arg(topo.mappedDI)
+                .arg(topo.mappedMN));
 
-        // Step 6: Load flow information
-        Logger::instance().info("Loading flow information...");
-        QList<ne_flow_info>& flowInfoList = GlobalData::instance().getFlowInfoList();
-        if (!DBQueries::selectAllFlowInfo(flowInfoList)) {
-            Logger::instance().warning("Failed to load flow info from database");
-        }else {
-            Logger::instance().info(QString("Loaded %1 flow items").arg(flowInfoList.size()));
+        // Step 5: Open persistent JFPlate sessions (one per controller)
+        Logger::instance().info("Starting JFPlate connection pool...");
+        JFPlate::LinkOptions linkOptions;
+        linkOptions.windowDepth = config.hardio.command_window;
+        linkOptions.commandTimeoutMs = config.hardio.command_timeout_ms;
+        linkOptions.maxRetransmits = config.hardio.command_retries;
+        linkOptions.reconnectBaseMs = qMax(10, config.hardio.reconnect_base_ms);
+        linkOptions.reconnectMaxMs = qMax(linkOptions.reconnectBaseMs, config.hardio.reconnect_max_ms);
+        linkOptions.connectTimeoutMs = qMax(100, config.hardio.connect_timeout_ms);
+        linkOptions.doCoalesceMs = config.hardio.do_coalesce_ms;
+        JFPlatePool::instance().setLinkOptions(linkOptions);
+        AnalogFilter::Options analogOptions;
+        analogOptions.window = qMax(1, config.hardio.ai_filter);
+        analogOptions.mode = config.hardio.ai_filter <= 1 ? AnalogFilter::Mode::Off
+                                                          : AnalogFilter::modeFromString(config.hardio.ai_filter_mode);
+        analogOptions.deadband = config.hardio.ai_deadband;
+        JFPlatePool::instance().setAnalogFilter(analogOptions);
+        Logger::instance().info(QString("MoNi filter: window=%1 deadband=%2 (%3)")
+                                    .arg(analogOptions.window)
+                                    .arg(analogOptions.deadband)
+                                    .arg(AnalogFilter::vectorized() ? "SSE2" : "scalar"));
+        JFPlatePool::instance().setIoThreads(config.hardio.io_threads, config.hardio.io_balance);
+        JFPlatePool::instance().setConnectLimit(config.hardio.max_concurrent_connects);
+        if (!JFPlatePool::instance().initialize(jfHardDict)) {
+            Logger::instance().warning("Failed to start JFPlate connection pool");
         }
+        JFPollScheduler::instance().initialize(config.hardio.read_interval_ms,
+                                               config.hardio.poll_min_ms,
+                                               config.hardio.poll_max_ms,
+                                               config.hardio.poll_adaptive);
 
-        // Step 7: Initialize metadata management
+        // Step 6: Initialize metadata management
         Logger::instance().info("Initializing metadata management...");
         if (!MetaManage::instance().initialize()) {
             Logger::instance().error("Failed to initialize metadata management");
             return false;
         }
+        if (canReady) {
+            CANInterface::instance().startReceiving();
+        }
+
+        // Step 7: Watch the plate/md tables and reload edited rows
+        if (config.reload.auto_detect) {
+            ChangeDetector::instance().start(config.reload.poll_interval_ms);
+        }
 
         GlobalData::instance().logState("After DataInit");
 
@@ -217,8 +329,20 @@ void Startup::cleanup()
 {
     Logger::instance().info("=== Starting Cleanup ===");
 
-    MetaManage::instance().cleanup();
+    ChangeDetector::instance().cleanup();
     CANInterface::instance().cleanup();
+    MetaManage::instance().cleanup();
+    MdHistory::instance().cleanup();
+    JFPollScheduler::instance().cleanup();
+    JFPlatePool::instance().cleanup();
+    MdPersister::instance().cleanup();
+
+    // md values are flushed by now; cache the tables for the next warm start
+    GlobalData& global = GlobalData::instance();
+    if (global.getConfig().cache.enabled) {
+        TableCache::instance().save(global.getPlatelist(), global.getMetaInfoList(), global.getFlowInfoList());
+    }
+
     DBConnection::instance().close();
     GlobalData::instance().clearAllData();
 
@@ -0,0 +1,253 @@
+#include "table_cache.h"
+#include "logging/logger.h"
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+
+namespace {
+
+const quint32 kMagic = 0x4E454E43;  // "NENC"
+const quint32 kFormatVersion = 2;  // 2: SQLite fingerprints hash string content, not length
+
+} // namespace
+
+// Stream operators live in the global namespace (internal linkage) so the
+// QList/QMap container operators find them through argument-dependent lookup.
+
+static QDataStream& operator<<(QDataStream& out, const ne_plate& p)
+{
+    return out << p.pk_id << p.sn << p.plate_type << p.plate_type_id << p.plate_parent_id
+               << p.station_name << p.ip_addr << p.ip_port << p.login_name << p.login_password
+               << p.hard_addr << p.ip << p.port << p.timeout << p.retry;
+}
+
+static QDataStream& operator>>(QDataStream& in, ne_plate& p)
+{
+    return in >> p.pk_id >> p.sn >> p.plate_type >> p.plate_type_id >> p.plate_parent_id
+              >> p.station_name >> p.ip_addr >> p.ip_port >> p.login_name >> p.login_password
+              >> p.hard_addr >> p.ip >> p.port >> p.timeout >> p.retry;
+}
+
+static QDataStream& operator<<(QDataStream& out, const ne_md_info& m)
+{
+    return out << m.pk_id << m.plate_id << m.plate_type_id << m.plate_control_id << m.plate_hard_addr
+               << m.tport << m.init_value << m.kind_id << m.current_value_str << m.md_name
+               << m.md_type << m.md_unit << m.min_value << m.max_value << m.current_value << m.status;
+}
+
+static QDataStream& operator>>(QDataStream& in, ne_md_info& m)
+{
+    return in >> m.pk_id >> m.plate_id >> m.plate_type_id >> m.plate_control_id >> m.plate_hard_addr
+              >> m.tport >> m.init_value >> m.kind_id >> m.current_value_str >> m.md_name
+              >> m.md_type >> m.md_unit >> m.min_value >> m.max_value >> m.current_value >> m.status;
+}
+
+static QDataStream& operator<<(QDataStream& out, const ne_flow_info& f)
+{
+    return out << f.pk_id << f.flow_name << f.flow_type << f.plate_id;
+}
+
+static QDataStream& operator>>(QDataStream& in, ne_flow_info& f)
+{
+    return in >> f.pk_id >> f.flow_name >> f.flow_type >> f.plate_id;
+}
+
+// board_id / board_sn / plates / metadata_map are not filled by TopologyBuilder
+static QDataStream& operator<<(QDataStream& out, const JFHardControl& c)
+{
+    return out << c.pk_id << c.station_name << c.ip_addr << c.ip_port << c.plantType
+               << c.login_name << c.login_password << c.allDIIdMap << c.allDOIdMap
+               << c.allDIValue << c.allDOValue << c.allMNdMap;
+}
+
+static QDataStream& operator>>(QDataStream& in, JFHardControl& c)
+{
+    return in >> c.pk_id >> c.station_name >> c.ip_addr >> c.ip_port >> c.plantType
+              >> c.login_name >> c.login_password >> c.allDIIdMap >> c.allDOIdMap
+              >> c.allDIValue >> c.allDOValue >> c.allMNdMap;
+}
+
+static QDataStream& operator<<(QDataStream& out, const TopologyStats& s)
+{
+    return out << s.plateType2 << s.plateType3 << s.plateType4 << s.plateType5
+               << s.orphanChildren << s.mappedDO << s.mappedDI << s.mappedMN;
+}
+
+static QDataStream& operator>>(QDataStream& in, TopologyStats& s)
+{
+    return in >> s.plateType2 >> s.plateType3 >> s.plateType4 >> s.plateType5
+              >> s.orphanChildren >> s.mappedDO >> s.mappedDI >> s.mappedMN;
+}
+
+static QDataStream& operator<<(QDataStream& out, const TableFingerprint& f)
+{
+    return out << f.plates << f.mds << f.flows;
+}
+
+static QDataStream& operator>>(QDataStream& in, TableFingerprint& f)
+{
+    return in >> f.plates >> f.mds >> f.flows;
+}
+
+TableCache& TableCache::instance()
+{
+    static TableCache s_instance;
+    return s_instance;
+}
+
+void TableCache::setPath(const QString& path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_path = path;
+}
+
+QString TableCache::path() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_path;
+}
+
+bool TableCache::load(const TableFingerprint& fingerprint,
+                      QList<ne_plate>& plates,
+                      QList<ne_md_info>& mds,
+                      QList<ne_flow_info>& flows,
+                      QMap<int, JFHardControl>& jfHardDict,
+                      TopologyStats& stats)
+{
+    const QString cachePath = path();
+    QFile file(cachePath);
+    if (cachePath.isEmpty() || !file.exists()) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        Logger::instance().warning(QString("Table cache %1 cannot be opened: %2").arg(cachePath, file.errorString()));
+        return false;
+    }
+
+    const qint64 size = file.size();
+    uchar* mapped = file.map(0, size);
+    if (!mapped) {
+        Logger::instance().warning(QString("Table cache %1 cannot be mapped: %2").arg(cachePath, file.errorString()));
+        return false;
+    }
+
+    bool ok = false;
+    {
+        const QByteArray view = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), static_cast<int>(size));
+        QDataStream in(view);
+        in.setVersion(QDataStream::Qt_5_12);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        TableFingerprint cached;
+        in >> magic >> version;
+        if (magic == kMagic && version == kFormatVersion) {
+            in >> cached;
+        }
+
+        if (magic != kMagic || version != kFormatVersion) {
+            Logger::instance().info(QString("Table cache %1 has an unknown format, ignored").arg(cachePath));
+        } else if (cached != fingerprint) {
+            Logger::instance().info("Table cache is stale (database changed), loading from database");
+        } else {
+            QList<ne_plate> cachedPlates;
+            QList<ne_md_info> cachedMds;
+            QList<ne_flow_info> cachedFlows;
+            QMap<int, JFHardControl> cachedDict;
+            TopologyStats cachedStats;
+            in >> cachedPlates >> cachedMds >> cachedFlows >> cachedDict >> cachedStats;
+
+            if (in.status() != QDataStream::Ok || !in.atEnd()) {
+                Logger::instance().warning(QString("Table cache %1 is truncated or corrupt, ignored").arg(cachePath));
+            } else {
+                plates.swap(cachedPlates);
+                mds.swap(cachedMds);
+                flows.swap(cachedFlows);
+                jfHardDict.swap(cachedDict);
+                stats = cachedStats;
+                ok = true;
+            }
+        }
+    }
+
+    file.unmap(mapped);
+    file.close();
+
+    // consumed either way: it is rewritten at the next clean shutdown
+    QFile::remove(cachePath);
+
+    if (ok) {
+        Logger::instance().info(QString("Warm start from table cache: %1 plates, %2 md, %3 flows in %4 ms")
+                                    .arg(plates.size())
+                                    .arg(mds.size())
+                                    .arg(flows.size())
+                                    .arg(timer.elapsed()));
+    }
+    return ok;
+}
+
+void TableCache::setLoadedFingerprint(const TableFingerprint& fingerprint)
+{
+    QMutexLocker locker(&m_mutex);
+    m_loaded = fingerprint;
+}
+
+void TableCache::setReloadedFingerprint(const QString& plates, const QString& mds)
+{
+    QMutexLocker locker(&m_mutex);
+    m_loaded.plates = plates;
+    m_loaded.mds = mds;
+}
+
+bool TableCache::save(const QList<ne_plate>& plates,
+                      const QList<ne_md_info>& mds,
+                      const QList<ne_flow_info>& flows)
+{
+    TableFingerprint loaded;
+    QString cachePath;
+    {
+        QMutexLocker locker(&m_mutex);
+        loaded = m_loaded;
+        cachePath = m_path;
+    }
+    if (cachePath.isEmpty()) {
+        return false;
+    }
+
+    // Tables edited while running (and not reloaded) would be cached
+    // under a fingerprint they do not match.
+    TableFingerprint current;
+    if (!loaded.isValid() || !DBQueries::selectTableFingerprint(current) || current != loaded) {
+        Logger::instance().info("Table cache not written: database differs from the loaded tables");
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QMap<int, JFHardControl> jfHardDict;
+    const TopologyStats stats = TopologyBuilder::build(plates, mds, jfHardDict);
+
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        Logger::instance().warning(QString("Table cache %1 cannot be written: %2").arg(cachePath, file.errorString()));
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << kMagic << kFormatVersion << current << plates << mds << flows << jfHardDict << stats;
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        Logger::instance().warning(QString("Table cache %1 write failed: %2").arg(cachePath, file.errorString()));
+        return false;
+    }
+
+    Logger::instance().info(QString("Table cache written to %1 in %2 ms").arg(cachePath).arg(timer.elapsed()));
+    return true;
+}
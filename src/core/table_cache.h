@@ -0,0 +1,72 @@
+#ifndef TABLE_CACHE_H
+#define TABLE_CACHE_H
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include "database/data_structures.h"
+#include "database/db_queries.h"
+#include "topology_builder.h"
+
+/**
+ * @brief Warm-start cache of the configuration tables and derived topology
+ *
+ * Written at clean shutdown, read (memory-mapped) at the next start when
+ * the database fingerprint still matches. The file is removed as soon as
+ * it has been read, so a crash always leads to a cold start from the
+ * database: md values persisted after the cache was read are never
+ * shadowed by stale cached ones.
+ */
+class TableCache
+{
+public:
+    static TableCache& instance();
+
+    void setPath(const QString& path);
+    QString path() const;
+
+    /**
+     * @brief Read the cache if it was written against this fingerprint
+     * @return false on a missing, stale or unreadable cache (outputs untouched)
+     */
+    bool load(const TableFingerprint& fingerprint,
+              QList<ne_plate>& plates,
+              QList<ne_md_info>& mds,
+              QList<ne_flow_info>& flows,
+              QMap<int, JFHardControl>& jfHardDict,
+              TopologyStats& stats);
+
+    /**
+     * @brief Record which database state the in-memory tables reflect
+     */
+    void setLoadedFingerprint(const TableFingerprint& fingerprint);
+
+    /**
+     * @brief Plate/md tables were reloaded at runtime (flow rows are not)
+     */
+    void setReloadedFingerprint(const QString& plates, const QString& mds);
+
+    /**
+     * @brief Write the in-memory tables if the database still matches them
+     *
+     * The topology is rebuilt from the rows so a warm start sees exactly
+     * what a cold start would, not runtime DO/DI values.
+     */
+    bool save(const QList<ne_plate>& plates,
+              const QList<ne_md_info>& mds,
+              const QList<ne_flow_info>& flows);
+
+private:
+    TableCache() = default;
+    ~TableCache() = default;
+
+    TableCache(const TableCache&) = delete;
+    TableCache& operator=(const TableCache&) = delete;
+
+    mutable QMutex m_mutex;
+    QString m_path;
+    TableFingerprint m_loaded;
+};
+
+#endif // TABLE_CACHE_H
@@ -0,0 +1,321 @@
+#include "topology_builder.h"
+#include <QHash>
+#include <QSet>
+
+bool TopologyDiff::isEmpty() const
+{
+    return !hasPlateChanges() && insertedMds.isEmpty() && updatedMds.isEmpty() && deletedMdIds.isEmpty();
+}
+
+bool TopologyDiff::hasPlateChanges() const
+{
+    return !insertedPlates.isEmpty() || !updatedPlates.isEmpty() || !deletedPlateIds.isEmpty();
+}
+
+TopologyStats TopologyBuilder::build(const QList<ne_plate>& plates,
+                                     const QList<ne_md_info>& mds,
+                                     QMap<int, JFHardControl>& jfHardDict)
+{
+    TopologyStats stats;
+    buildPlates(plates, jfHardDict, stats);
+    mapAllMetadata(mds, jfHardDict, stats);
+    return stats;
+}
+
+void TopologyBuilder::buildPlates(const QList<ne_plate>& plates,
+                                  QMap<int, JFHardControl>& jfHardDict,
+                                  TopologyStats& stats)
+{
+    jfHardDict.clear();
+
+    for (const auto& plate : plates) {
+        if (isController(plate)) {
+            jfHardDict[plate.pk_id] = makeController(plate, &stats);
+        } else {
+            addChildPlate(jfHardDict, plate, &stats);
+        }
+    }
+}
+
+void TopologyBuilder::mapAllMetadata(const QList<ne_md_info>& mds,
+                                     QMap<int, JFHardControl>& jfHardDict,
+                                     TopologyStats& stats)
+{
+    for (const auto& md : mds) {
+        mapMetadata(jfHardDict, md, &stats);
+    }
+}
+
+JFHardControl TopologyBuilder::buildController(const ne_plate& controllerPlate,
+                                               const QList<ne_plate>& childPlates,
+                                               const QList<ne_md_info>& mds)
+{
+    QMap<int, JFHardControl> single;
+    single[controllerPlate.pk_id] = makeController(controllerPlate, nullptr);
+
+    for (const auto& plate : childPlates) {
+        addChildPlate(single, plate, nullptr);
+    }
+    for (const auto& md : mds) {
+        mapMetadata(single, md, nullptr);
+    }
+
+    return single.value(controllerPlate.pk_id);
+}
+
+bool TopologyBuilder::isController(const ne_plate& plate)
+{
+    return plate.plate_type_id == 2 || plate.plate_type_id == 5;
+}
+
+int TopologyBuilder::owningController(const ne_md_info& md)
+{
+    return md.plate_type_id == 5 ? md.plate_id : md.plate_control_id;
+}
+
+int TopologyBuilder::owningController(const ne_plate& plate)
+{
+    return isController(plate) ? plate.pk_id : plate.plate_parent_id;
+}
+
+JFHardControl TopologyBuilder::makeController(const ne_plate& plate, TopologyStats* stats)
+{
+    JFHardControl control;
+    control.pk_id = plate.pk_id;
+    control.station_name = plate.station_name;
+    control.ip_addr = plate.ip_addr.isEmpty() ? plate.ip : plate.ip_addr;
+    control.ip_port = (plate.ip_port == 0) ? plate.port : plate.ip_port;
+    control.plantType = plate.plate_type_id;
+    control.login_name = plate.login_name;
+    control.login_password = plate.login_password;
+
+    if (plate.plate_type_id == 2) {
+        if (stats) {
+            ++stats->plateType2;
+        }
+    } else {
+        if (stats) {
+            ++stats->plateType5;
+        }
+        if (plate.hard_addr > 0) {
+            control.allMNdMap[plate.hard_addr] = QVector<int>(16, 0);
+        }
+    }
+
+    return control;
+}
+
+bool TopologyBuilder::addChildPlate(QMap<int, JFHardControl>& jfHardDict, const ne_plate& plate,
+                                    TopologyStats* stats)
+{
+    const int plateType = plate.plate_type_id;
+    if (plateType != 3 && plateType != 4) {
+        return false;
+    }
+
+    auto it = jfHardDict.find(plate.plate_parent_id);
+    if (it == jfHardDict.end()) {
+        if (stats) {
+            ++stats->orphanChildren;
+        }
+        return false;
+    }
+
+    const int hardAddr = plate.hard_addr;
+    if (hardAddr <= 0) {
+        return false;
+    }
+
+    if (plateType == 3) {
+        it->allDOIdMap[hardAddr] = QVector<int>(16, 0);
+        it->allDOValue[hardAddr] = QVector<int>(16, 0);
+        if (stats) {
+            ++stats->plateType3;
+        }
+    } else {
+        it->allDIIdMap[hardAddr] = QVector<int>(16, 0);
+        it->allDIValue[hardAddr] = QVector<int>(16, 0);
+        if (stats) {
+            ++stats->plateType4;
+        }
+    }
+    return true;
+}
+
+bool TopologyBuilder::mapMetadata(QMap<int, JFHardControl>& jfHardDict, const ne_md_info& md,
+                                  TopologyStats* stats)
+{
+    if (md.tport < 0 || md.tport >= 16) {
+        return false;
+    }
+
+    auto it = jfHardDict.find(owningController(md));
+    if (it == jfHardDict.end()) {
+        return false;
+    }
+
+    if (md.plate_type_id == 3) {
+        if (!it->allDOIdMap.contains(md.plate_hard_addr)) {
+            return false;
+        }
+        it->allDOIdMap[md.plate_hard_addr][md.tport] = md.pk_id;
+        it->allDOValue[md.plate_hard_addr][md.tport] = md.init_value;
+        if (stats) {
+            ++stats->mappedDO;
+        }
+        return true;
+    }
+
+    if (md.plate_type_id == 4) {
+        if (!it->allDIIdMap.contains(md.plate_hard_addr)) {
+            return false;
+        }
+        it->allDIIdMap[md.plate_hard_addr][md.tport] = md.pk_id;
+        it->allDIValue[md.plate_hard_addr][md.tport] = md.init_value;
+        if (stats) {
+            ++stats->mappedDI;
+        }
+        return true;
+    }
+
+    if (md.plate_type_id == 5) {
+        if (!it->allMNdMap.contains(md.plate_hard_addr)) {
+            return false;
+        }
+        it->allMNdMap[md.plate_hard_addr][md.tport] = md.pk_id;
+        if (stats) {
+            ++stats->mappedMN;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void TopologyBuilder::unmapMetadata(QMap<int, JFHardControl>& jfHardDict, const ne_md_info& md)
+{
+    if (md.tport < 0 || md.tport >= 16) {
+        return;
+    }
+
+    auto it = jfHardDict.find(owningController(md));
+    if (it == jfHardDict.end()) {
+        return;
+    }
+
+    // Only clear the slot if it still points at this md.
+    auto clearSlot = [&md](QMap<int, QVector<int>>& idMap) {
+        auto slot = idMap.find(md.plate_hard_addr);
+        if (slot != idMap.end() && (*slot)[md.tport] == md.pk_id) {
+            (*slot)[md.tport] = 0;
+        }
+    };
+
+    if (md.plate_type_id == 3) {
+        clearSlot(it->allDOIdMap);
+    } else if (md.plate_type_id == 4) {
+        clearSlot(it->allDIIdMap);
+    } else if (md.plate_type_id == 5) {
+        clearSlot(it->allMNdMap);
+    }
+}
+
+bool TopologyBuilder::samePlate(const ne_plate& a, const ne_plate& b)
+{
+    return a.pk_id == b.pk_id &&
+           a.sn == b.sn &&
+           a.plate_type == b.plate_type &&
+           a.plate_type_id == b.plate_type_id &&
+           a.plate_parent_id == b.plate_parent_id &&
+           a.station_name == b.station_name &&
+           a.ip_addr == b.ip_addr &&
+           a.ip_port == b.ip_port &&
+           a.login_name == b.login_name &&
+           a.login_password == b.login_password &&
+           a.hard_addr == b.hard_addr &&
+           a.ip == b.ip &&
+           a.port == b.port &&
+           a.timeout == b.timeout &&
+           a.retry == b.retry;
+}
+
+bool TopologyBuilder::sameMetaConfig(const ne_md_info& a, const ne_md_info& b)
+{
+    return a.pk_id == b.pk_id &&
+           a.plate_id == b.plate_id &&
+           a.plate_type_id == b.plate_type_id &&
+           a.plate_control_id == b.plate_control_id &&
+           a.plate_hard_addr == b.plate_hard_addr &&
+           a.tport == b.tport &&
+           a.init_value == b.init_value &&
+           a.kind_id == b.kind_id &&
+           a.md_name == b.md_name &&
+           a.md_type == b.md_type &&
+           a.md_unit == b.md_unit &&
+           a.min_value == b.min_value &&
+           a.max_value == b.max_value;
+}
+
+bool TopologyBuilder::sameConnection(const JFHardControl& a, const JFHardControl& b)
+{
+    return a.ip_addr == b.ip_addr &&
+           a.ip_port == b.ip_port &&
+           a.login_name == b.login_name &&
+           a.login_password == b.login_password;
+}
+
+TopologyDiff TopologyBuilder::diff(const QList<ne_plate>& livePlates,
+                                   const QList<ne_md_info>& liveMds,
+                                   const QList<ne_plate>& newPlates,
+                                   const QList<ne_md_info>& newMds)
+{
+    TopologyDiff result;
+
+    QHash<int, int> liveIndex;
+    liveIndex.reserve(livePlates.size());
+    for (int i = 0; i < livePlates.size(); ++i) {
+        liveIndex.insert(livePlates[i].pk_id, i);
+    }
+
+    QSet<int> seen;
+    seen.reserve(newPlates.size());
+    for (const auto& plate : newPlates) {
+        seen.insert(plate.pk_id);
+        const auto it = liveIndex.constFind(plate.pk_id);
+        if (it == liveIndex.constEnd()) {
+            result.insertedPlates.append(plate);
+        } else if (!samePlate(livePlates[it.value()], plate)) {
+            result.updatedPlates.append(plate);
+        }
+    }
+    for (const auto& plate : livePlates) {
+        if (!seen.contains(plate.pk_id)) {
+            result.deletedPlateIds.append(plate.pk_id);
+        }
+    }
+
+    liveIndex.clear();
+    liveIndex.reserve(liveMds.size());
+    for (int i = 0; i < liveMds.size(); ++i) {
+        liveIndex.insert(liveMds[i].pk_id, i);
+    }
+
+    seen.clear();
+    seen.reserve(newMds.size());
+    for (const auto& md : newMds) {
+        seen.insert(md.pk_id);
+        const auto it = liveIndex.constFind(md.pk_id);
+        if (it == liveIndex.constEnd()) {
+            result.insertedMds.append(md);
+        } else if (!sameMetaConfig(liveMds[it.value()], md)) {
+            result.updatedMds.append(md);
+        }
+    }
+    for (const auto& md : liveMds) {
+        if (!seen.contains(md.pk_id)) {
+            result.deletedMdIds.append(md.pk_id);
+        }
+    }
+
+    return result;
+}
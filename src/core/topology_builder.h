@@ -0,0 +1,119 @@
+#ifndef TOPOLOGY_BUILDER_H
+#define TOPOLOGY_BUILDER_H
+
+#include <QList>
+#include <QMap>
+#include "database/data_structures.h"
+
+/**
+ * @brief Counters reported after building the legacy hardware maps
+ */
+struct TopologyStats
+{
+    int plateType2 = 0;
+    int plateType3 = 0;
+    int plateType4 = 0;
+    int plateType5 = 0;
+    int orphanChildren = 0;
+    int mappedDO = 0;
+    int mappedDI = 0;
+    int mappedMN = 0;
+};
+
+/**
+ * @brief Row-level difference between live and freshly loaded tables
+ *
+ * md rows compare on configuration columns only; current_value is owned
+ * by NENet at runtime and never part of a diff.
+ */
+struct TopologyDiff
+{
+    QList<ne_plate> insertedPlates;
+    QList<ne_plate> updatedPlates;
+    QList<int> deletedPlateIds;
+    QList<ne_md_info> insertedMds;
+    QList<ne_md_info> updatedMds;
+    QList<int> deletedMdIds;
+
+    bool isEmpty() const;
+    bool hasPlateChanges() const;
+};
+
+/**
+ * @brief Builds JFHardControl maps from ne_plate / ne_md_info rows
+ * (aligned with C# selectSqlData)
+ *
+ * Type 2/5 plates are controllers, type 3 (DO) and 4 (DI) plates are
+ * 16-channel children addressed by hard_addr under plate_parent_id.
+ */
+class TopologyBuilder
+{
+public:
+    /**
+     * @brief Build all controller maps from scratch
+     */
+    static TopologyStats build(const QList<ne_plate>& plates,
+                               const QList<ne_md_info>& mds,
+                               QMap<int, JFHardControl>& jfHardDict);
+
+    /**
+     * @brief First half of build(): controllers and their child boards
+     *
+     * Lets startup lay out the controllers while ne_md_info is still loading.
+     */
+    static void buildPlates(const QList<ne_plate>& plates,
+                            QMap<int, JFHardControl>& jfHardDict,
+                            TopologyStats& stats);
+
+    /**
+     * @brief Second half of build(): map every md row into the controllers
+     */
+    static void mapAllMetadata(const QList<ne_md_info>& mds,
+                               QMap<int, JFHardControl>& jfHardDict,
+                               TopologyStats& stats);
+
+    /**
+     * @brief Build a single controller from its own row, its children and its md rows
+     */
+    static JFHardControl buildController(const ne_plate& controllerPlate,
+                                         const QList<ne_plate>& childPlates,
+                                         const QList<ne_md_info>& mds);
+
+    static bool isController(const ne_plate& plate);
+
+    /**
+     * @brief Controller id an md row maps into (plate_id for analog, else plate_control_id)
+     */
+    static int owningController(const ne_md_info& md);
+
+    /**
+     * @brief Controller id a plate row belongs to (itself, or its parent)
+     */
+    static int owningController(const ne_plate& plate);
+
+    static bool mapMetadata(QMap<int, JFHardControl>& jfHardDict, const ne_md_info& md,
+                            TopologyStats* stats = nullptr);
+    static void unmapMetadata(QMap<int, JFHardControl>& jfHardDict, const ne_md_info& md);
+
+    static bool samePlate(const ne_plate& a, const ne_plate& b);
+    static bool sameMetaConfig(const ne_md_info& a, const ne_md_info& b);
+
+    /**
+     * @brief True if a controller session must be recreated (address or login changed)
+     */
+    static bool sameConnection(const JFHardControl& a, const JFHardControl& b);
+
+    static TopologyDiff diff(const QList<ne_plate>& livePlates,
+                             const QList<ne_md_info>& liveMds,
+                             const QList<ne_plate>& newPlates,
+                             const QList<ne_md_info>& newMds);
+
+private:
+    static JFHardControl makeController(const ne_plate& plate, TopologyStats* stats);
+    static bool addChildPlate(QMap<int, JFHardControl>& jfHardDict, const ne_plate& plate,
+                              TopologyStats* stats);
+
+    TopologyBuilder() = delete;
+};
+
+#endif // TOPOLOGY_BUILDER_H
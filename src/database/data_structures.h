@@ -2,6 +2,7 @@
 #define DATA_STRUCTURES_H
 
 #include <QString>
+#include <QByteArray>
 #include <QList>
 #include <QMap>
 #include <QVector>
@@ -97,6 +98,23 @@ struct JFHardControl
     QMap<int, ne_md_info> metadata_map;
 };
 
+/**
+ * @brief One input or output channel that changed on a board
+ */
+struct ChannelChange
+{
+    enum Kind : quint8 {
+        DI = 0,     // allDIIdMap
+        DO = 1,     // allDOIdMap
+        MN = 2      // allMNdMap (analog)
+    };
+
+    Kind kind = DI;
+    quint8 channel = 0;     // tport, 0..15
+    quint16 hardAddr = 0;
+    int value = 0;
+};
+
 /**
  * @brief Hardware event message
  */
@@ -108,13 +126,16 @@ struct HardwareEvent
         PLATE_DISCONNECTED = 2,
         METADATA_CHANGED = 3,
         DATA_RECEIVED = 4,
-        ERROR_OCCURRED = 5
+        ERROR_OCCURRED = 5,
+        CHANNELS_CHANGED = 6    // changes of one board report, source_id = controller
     };
 
     EventType type = UNKNOWN;
     int source_id = 0;
     QString data;
-    long timestamp = 0;
+    QByteArray payload;     // raw frame bytes for DATA_RECEIVED, source_id = CAN id
+    qint64 timestamp = 0;   // arrival time, ns since the Unix epoch (kernel receive time for CAN frames)
+    QVector<ChannelChange> changes;
 };
 
 /**
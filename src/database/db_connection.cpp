@@ -1,7 +1,11 @@
 #include "db_connection.h"
+#include "statement_cache.h"
 #include "../logging/logger.h"
 #include <QSqlDriver>
 #include <QSqlError>
+#include <QThread>
+#include <QSqlQuery>
+#include <QStringList>
 
 DBConnection& DBConnection::instance()
 {
@@ -47,24 +51,259 @@ bool DBConnection::initialize(const QString& dbType, const QString& host,
     }
 
     Logger::instance().info(QString("Database connected: %1").arg(dbType));
+    m_ownerThread = QThread::currentThread();
     m_connected = true;
+
+    if (isSqlite()) {
+        applySqlitePragmas(m_database);
+        startCheckpointScheduler();
+    }
     return true;
 }
 
+void DBConnection::setMaxConnections(int maxConnections)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxConnections = qMax(1, maxConnections);
+}
+
+void DBConnection::setSqliteOptions(const SqliteOptions& options)
+{
+    m_sqliteOptions = options;
+}
+
 bool DBConnection::isConnected() const
 {
     return m_connected && m_database.isOpen();
 }
 
-QSqlDatabase DBConnection::getConnection() const
+QSqlDatabase DBConnection::getConnection()
+{
+    QThread* thread = QThread::currentThread();
+    if (!m_connected || thread == m_ownerThread) {
+        return m_database;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_threadConnections.constFind(thread);
+    if (it != m_threadConnections.constEnd()) {
+        return QSqlDatabase::database(it.value(), false);
+    }
+
+    if (m_threadConnections.size() + 1 >= m_maxConnections) {
+        Logger::instance().error(QString("Database connection limit (%1) reached, thread %2 has no connection")
+                                     .arg(m_maxConnections)
+                                     .arg(thread->objectName()));
+        return QSqlDatabase();
+    }
+
+    const QString name = QString("nenet_conn_%1").arg(++m_nextConnectionId);
+    QSqlDatabase db = QSqlDatabase::cloneDatabase(m_database, name);
+    if (!db.open()) {
+        Logger::instance().error(QString("Database connection for thread %1 failed: %2")
+                                     .arg(thread->objectName(), db.lastError().text()));
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+        return QSqlDatabase();
+    }
+
+    if (isSqlite()) {
+        applySqlitePragmas(db);
+    }
+    m_threadConnections.insert(thread, name);
+
+    // finished is emitted on the finishing thread itself, so the
+    // connection is closed by the thread that used it.
+    QObject::connect(thread, &QThread::finished, [this, thread] { releaseThreadConnection(thread); });
+
+    Logger::instance().info(QString("Database connection %1 opened for thread %2 (%3/%4)")
+                                .arg(name, thread->objectName())
+                                .arg(m_threadConnections.size() + 1)
+                                .arg(m_maxConnections));
+    return db;
+}
+
+int DBConnection::connectionCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_connected ? m_threadConnections.size() + 1 : 0;
+}
+
+void DBConnection::releaseThreadConnection(QThread* thread)
 {
-    return m_database;
+    QString name;
+    {
+        QMutexLocker locker(&m_mutex);
+        name = m_threadConnections.take(thread);
+    }
+    if (name.isEmpty()) {
+        return;
+    }
+
+    StatementCache::instance().release(name);
+    {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
 }
 
 void DBConnection::close()
 {
+    stopCheckpointScheduler();
+
+    QList<QThread*> threads;
+    {
+        QMutexLocker locker(&m_mutex);
+        threads = m_threadConnections.keys();
+    }
+    // Worker threads are stopped before the database in Startup::cleanup();
+    // anything left is from threads without a finished signal.
+    for (QThread* thread : threads) {
+        releaseThreadConnection(thread);
+    }
+
+    StatementCache::instance().release(m_database.connectionName());
+    if (m_database.isOpen() && isSqlite()
+        && m_sqliteOptions.journalMode.compare("WAL", Qt::CaseInsensitive) == 0) {
+        // fold the WAL back into the main file so it starts empty next run
+        runCheckpoint("TRUNCATE");
+    }
     if (m_database.isOpen()) {
         m_database.close();
     }
     m_connected = false;
 }
+
+bool DBConnection::isSqlite() const
+{
+    return m_database.driverName() == "QSQLITE";
+}
+
+void DBConnection::applySqlitePragmas(QSqlDatabase& db)
+{
+    static const QStringList kJournalModes = {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"};
+    static const QStringList kSyncLevels = {"OFF", "NORMAL", "FULL", "EXTRA"};
+    static const QStringList kTempStores = {"DEFAULT", "FILE", "MEMORY"};
+
+    const SqliteOptions& opt = m_sqliteOptions;
+    QStringList pragmas;
+
+    // busy_timeout first so the journal_mode switch can wait for other connections
+    pragmas << QString("PRAGMA busy_timeout = %1").arg(qMax(0, opt.busyTimeoutMs));
+
+    const QString journalMode = opt.journalMode.toUpper();
+    if (kJournalModes.contains(journalMode)) {
+        pragmas << QString("PRAGMA journal_mode = %1").arg(journalMode);
+    } else {
+        Logger::instance().warning(QString("Ignoring unknown SQLite journal mode: %1").arg(opt.journalMode));
+    }
+
+    const QString synchronous = opt.synchronous.toUpper();
+    if (kSyncLevels.contains(synchronous)) {
+        pragmas << QString("PRAGMA synchronous = %1").arg(synchronous);
+    } else {
+        Logger::instance().warning(QString("Ignoring unknown SQLite synchronous level: %1").arg(opt.synchronous));
+    }
+
+    // negative cache_size is in KiB rather than pages
+    pragmas << QString("PRAGMA cache_size = %1").arg(-qMax(0, opt.cacheSizeKb));
+    pragmas << QString("PRAGMA mmap_size = %1").arg(qMax<qint64>(0, opt.mmapSize));
+
+    const QString tempStore = opt.tempStore.toUpper();
+    if (kTempStores.contains(tempStore)) {
+        pragmas << QString("PRAGMA temp_store = %1").arg(tempStore);
+    } else {
+        Logger::instance().warning(QString("Ignoring unknown SQLite temp_store: %1").arg(opt.tempStore));
+    }
+
+    QSqlQuery query(db);
+    for (const QString& pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            Logger::instance().warning(QString("%1 failed: %2").arg(pragma, query.lastError().text()));
+            continue;
+        }
+        // journal_mode reports the mode actually in effect
+        if (pragma.startsWith("PRAGMA journal_mode") && query.next()) {
+            const QString actual = query.value(0).toString().toUpper();
+            if (actual != journalMode) {
+                Logger::instance().warning(QString("SQLite journal mode is %1, requested %2").arg(actual, journalMode));
+            }
+        }
+        query.finish();
+    }
+
+    Logger::instance().debug(QString("SQLite pragmas applied on %1").arg(db.connectionName()));
+}
+
+void DBConnection::startCheckpointScheduler()
+{
+    if (m_checkpointThread || m_sqliteOptions.checkpointIntervalMs <= 0
+        || m_sqliteOptions.journalMode.compare("WAL", Qt::CaseInsensitive) != 0) {
+        return;
+    }
+
+    m_checkpointStopping = false;
+    m_checkpointThread = QThread::create([this] { checkpointLoop(); });
+    m_checkpointThread->setObjectName("SqliteCheckpoint");
+    m_checkpointThread->start();
+
+    Logger::instance().info(QString("SQLite WAL checkpoint every %1 ms").arg(m_sqliteOptions.checkpointIntervalMs));
+}
+
+void DBConnection::stopCheckpointScheduler()
+{
+    if (!m_checkpointThread) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_checkpointMutex);
+        m_checkpointStopping = true;
+        m_checkpointWake.wakeAll();
+    }
+    m_checkpointThread->wait();
+    delete m_checkpointThread;
+    m_checkpointThread = nullptr;
+}
+
+void DBConnection::checkpointLoop()
+{
+    QMutexLocker locker(&m_checkpointMutex);
+    while (!m_checkpointStopping) {
+        m_checkpointWake.wait(&m_checkpointMutex, static_cast<unsigned long>(m_sqliteOptions.checkpointIntervalMs));
+        if (m_checkpointStopping) {
+            break;
+        }
+
+        locker.unlock();
+        runCheckpoint("PASSIVE");
+        locker.relock();
+    }
+}
+
+void DBConnection::runCheckpoint(const QString& mode)
+{
+    QSqlDatabase db = getConnection();
+    if (!db.isOpen()) {
+        return;
+    }
+
+    // PASSIVE never blocks readers or writers; it copies what it can
+    QSqlQuery query(db);
+    if (!query.exec(QString("PRAGMA wal_checkpoint(%1)").arg(mode)) || !query.next()) {
+        Logger::instance().warning(QString("WAL checkpoint failed: %1").arg(query.lastError().text()));
+        return;
+    }
+
+    const bool busy = query.value(0).toInt() != 0;
+    const int walPages = query.value(1).toInt();
+    const int checkpointed = query.value(2).toInt();
+    if (busy) {
+        Logger::instance().warning(QString("WAL checkpoint (%1) busy: %2/%3 pages copied")
+                                       .arg(mode).arg(checkpointed).arg(walPages));
+    } else if (walPages > 0) {
+        Logger::instance().debug(QString("WAL checkpoint (%1): %2/%3 pages copied")
+                                     .arg(mode).arg(checkpointed).arg(walPages));
+    }
+}
@@ -3,13 +3,41 @@
 
 #include <QString>
 #include <QSqlDatabase>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+
+class QThread;
 
 /**
  * @brief Database connection management
+ *
+ * Qt SQL connections may only be used by the thread that opened them. The
+ * connection opened by initialize() belongs to the initializing thread;
+ * any other thread calling getConnection() gets its own named clone,
+ * opened lazily on first use and closed when that QThread finishes. The
+ * total number of connections is capped by setMaxConnections().
+ *
+ * For SQLite, the pragmas from setSqliteOptions() are applied to every
+ * connection when it is opened, and in WAL mode a background thread
+ * checkpoints the WAL periodically.
  */
 class DBConnection
 {
 public:
+    /**
+     * @brief SQLite pragmas applied to each connection ([SQLITE] section)
+     */
+    struct SqliteOptions {
+        QString journalMode = "WAL";        // DELETE | TRUNCATE | PERSIST | MEMORY | WAL | OFF
+        QString synchronous = "NORMAL";     // OFF | NORMAL | FULL | EXTRA
+        int cacheSizeKb = 8192;             // page cache per connection
+        qint64 mmapSize = 268435456;        // bytes, 0 disables mmap
+        QString tempStore = "MEMORY";       // DEFAULT | FILE | MEMORY
+        int busyTimeoutMs = 5000;
+        int checkpointIntervalMs = 30000;   // WAL only, 0 disables the scheduler
+    };
+
     static DBConnection& instance();
 
     /**
@@ -19,15 +47,33 @@ public:
                     const QString& user = "", const QString& password = "",
                     const QString& database = "");
 
+    /**
+     * @brief Upper bound on open connections, including the initial one
+     */
+    void setMaxConnections(int maxConnections);
+
+    /**
+     * @brief Pragmas for SQLite connections, set before initialize()
+     */
+    void setSqliteOptions(const SqliteOptions& options);
+
     /**
      * @brief Check if connected
      */
     bool isConnected() const;
 
     /**
-     * @brief Get database connection object
+     * @brief Get the calling thread's database connection
+     *
+     * Returns an invalid (closed) connection if the pool is exhausted or
+     * the clone could not be opened.
+     */
+    QSqlDatabase getConnection();
+
+    /**
+     * @brief Number of open per-thread connections, including the initial one
      */
-    QSqlDatabase getConnection() const;
+    int connectionCount() const;
 
     /**
      * @brief Close connection
@@ -41,8 +87,29 @@ private:
     DBConnection(const DBConnection&) = delete;
     DBConnection& operator=(const DBConnection&) = delete;
 
+    void releaseThreadConnection(QThread* thread);
+
+    bool isSqlite() const;
+    void applySqlitePragmas(QSqlDatabase& db);
+    void startCheckpointScheduler();
+    void stopCheckpointScheduler();
+    void checkpointLoop();
+    void runCheckpoint(const QString& mode);
+
     QSqlDatabase m_database;
+    QThread* m_ownerThread = nullptr;
     bool m_connected = false;
+
+    mutable QMutex m_mutex;
+    QHash<QThread*, QString> m_threadConnections;
+    int m_maxConnections = 8;
+    int m_nextConnectionId = 0;
+
+    SqliteOptions m_sqliteOptions;
+    QThread* m_checkpointThread = nullptr;
+    QMutex m_checkpointMutex;
+    QWaitCondition m_checkpointWake;
+    bool m_checkpointStopping = false;
 };
 
 #endif // DB_CONNECTION_H
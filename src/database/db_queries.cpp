@@ -1,13 +1,425 @@
 #include "db_queries.h"
 #include "db_connection.h"
+#include "statement_cache.h"
 #include "../logging/logger.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QSqlDriver>
 #include <QSqlRecord>
 #include <QVariant>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QSet>
+#include <atomic>
+
+namespace {
+
+std::atomic<quint64> s_metadataWrites{0};
+
+/**
+ * @brief Column positions of one loader's SELECT, resolved once per load
+ *
+ * Only columns that exist in the table are selected; a missing column
+ * resolves to -1 and the struct field keeps its default.
+ */
+class ColumnMap
+{
+public:
+    ColumnMap(const QSqlDatabase& db, const QString& table, const QStringList& wanted,
+              const QString& where = QString())
+    {
+        const QSqlRecord record = db.record(table);
+        for (const QString& name : wanted) {
+            if (record.indexOf(name) >= 0) {
+                m_index.insert(name, m_columns.size());
+                m_columns << name;
+            }
+        }
+        m_sql = QString("SELECT %1 FROM %2").arg(m_columns.join(", "), table);
+        if (!where.isEmpty()) {
+            m_sql += " WHERE " + where;
+        }
+    }
+
+    bool isEmpty() const { return m_columns.isEmpty(); }
+    const QString& sql() const { return m_sql; }
+    int operator[](const QString& name) const { return m_index.value(name, -1); }
+
+private:
+    QStringList m_columns;
+    QHash<QString, int> m_index;
+    QString m_sql;
+};
+
+inline int intAt(const QSqlQuery& query, int column, int fallback = 0)
+{
+    return column >= 0 ? query.value(column).toInt() : fallback;
+}
+
+inline QString stringAt(const QSqlQuery& query, int column)
+{
+    return column >= 0 ? query.value(column).toString() : QString();
+}
+
+// loaders restricted to an id range select with this clause
+const char* const kIdRangeWhere = "pk_id BETWEEN ? AND ?";
+
+/**
+ * @brief Open a forward-only cursor over the mapped columns
+ * @param rowHint receives COUNT(*) so the caller can reserve (full loads only)
+ * @param fromId, toId bind values for kIdRangeWhere, fromId < 0 for a full load
+ */
+QSqlQuery* openCursor(const QSqlDatabase& db, const QString& table, const ColumnMap& columns, int& rowHint,
+                      int fromId = -1, int toId = -1)
+{
+    rowHint = 0;
+    if (columns.isEmpty()) {
+        Logger::instance().error(QString("Table %1 not found or has none of the expected columns").arg(table));
+        return nullptr;
+    }
+
+    if (fromId >= 0) {
+        QSqlQuery* query = StatementCache::instance().prepared(db, columns.sql(), true);
+        if (!query) {
+            return nullptr;
+        }
+        query->bindValue(0, fromId);
+        query->bindValue(1, toId);
+        if (!query->exec()) {
+            Logger::instance().error(QString("Query failed: %1").arg(query->lastError().text()));
+            query->finish();
+            return nullptr;
+        }
+        return query;
+    }
+
+    QSqlQuery* count = StatementCache::instance().prepared(db, QString("SELECT COUNT(*) FROM %1").arg(table), true);
+    if (count && count->exec() && count->next()) {
+        rowHint = count->value(0).toInt();
+    }
+    if (count) {
+        count->finish();
+    }
+
+    QSqlQuery* query = StatementCache::instance().prepared(db, columns.sql(), true);
+    if (!query) {
+        return nullptr;
+    }
+    if (!query->exec()) {
+        Logger::instance().error(QString("Query failed: %1").arg(query->lastError().text()));
+        query->finish();
+        return nullptr;
+    }
+    return query;
+}
+
+/**
+ * @brief Configuration columns covered by fingerprints and change checksums
+ *
+ * current_value is left out: NENet writes it continuously.
+ */
+void checksumColumns(const QString& table, QStringList& numericColumns, QStringList& stringColumns)
+{
+    if (table == "ne_plate_type") {
+        numericColumns = {"plate_type_id", "plate_parent_id", "ip_port", "hard_addr", "port", "timeout", "retry"};
+        stringColumns = {"sn", "plate_type", "station_name", "ip_addr", "ip", "login_name", "login_password"};
+    } else if (table == "ne_md_info") {
+        numericColumns = {"plate_id", "plate_type_id", "plate_control_id", "plate_hard_addr", "tport",
+                          "init_value", "kind_id", "min_value", "max_value", "status"};
+        stringColumns = {"md_name", "md_type", "md_unit"};
+    } else {
+        numericColumns = {"plate_id"};
+        stringColumns = {"flow_name", "flow_type"};
+    }
+}
+
+/**
+ * @brief COUNT, MAX(pk_id) and pk_id-weighted sums of the table's checksum columns
+ *
+ * String columns are summed as CRC32 on MySQL only; SQLite has no built-in
+ * hash, so there they come from stringColumnSums() instead.
+ * @return empty if the table does not exist
+ */
+QStringList checksumTerms(const QSqlDatabase& db, const QString& table)
+{
+    QStringList terms;
+    const QSqlRecord record = db.record(table);
+    if (record.isEmpty()) {
+        return terms;
+    }
+
+    QStringList numericColumns;
+    QStringList stringColumns;
+    checksumColumns(table, numericColumns, stringColumns);
+
+    // weighting by row keeps values swapped between rows from cancelling out
+    const QString weight = "(pk_id % 1009 + 1)";
+    const bool hasCrc = db.driverName() == "QMYSQL";
+
+    terms << "COUNT(*)" << "COALESCE(MAX(pk_id), 0)";
+    for (const QString& column : numericColumns) {
+        if (record.indexOf(column) >= 0) {
+            terms << QString("COALESCE(SUM(%1 * %2), 0)").arg(column, weight);
+        }
+    }
+    for (const QString& column : stringColumns) {
+        if (hasCrc && record.indexOf(column) >= 0) {
+            terms << QString("COALESCE(SUM(CRC32(%1) * %2), 0)").arg(column, weight);
+        }
+    }
+    return terms;
+}
+
+/**
+ * @brief FNV-1a of a column value, standing in for MySQL's CRC32()
+ */
+quint32 contentHash(const QVariant& value)
+{
+    if (value.isNull()) {
+        return 0;
+    }
+    quint32 hash = 2166136261u;
+    for (const char c : value.toString().toUtf8()) {
+        hash ^= static_cast<uchar>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief pk_id-weighted content hashes of the string columns, per bucket, joined with ':'
+ *
+ * Used where the database cannot hash in SQL (SQLite): the string columns
+ * are fetched and hashed here, one scan like the aggregate query itself.
+ * bucketSize <= 0 puts every row in bucket 0.
+ */
+bool stringColumnSums(const QSqlDatabase& db, const QString& table, int bucketSize, QHash<int, QString>& sums)
+{
+    QStringList numericColumns;
+    QStringList stringColumns;
+    checksumColumns(table, numericColumns, stringColumns);
+
+    const QSqlRecord record = db.record(table);
+    QStringList present;
+    for (const QString& column : stringColumns) {
+        if (record.indexOf(column) >= 0) {
+            present << column;
+        }
+    }
+    sums.clear();
+    if (present.isEmpty()) {
+        return true;
+    }
+
+    QSqlQuery* query = StatementCache::instance().prepared(
+        db, QString("SELECT pk_id, %1 FROM %2").arg(present.join(", "), table), true);
+    if (!query) {
+        return false;
+    }
+    if (!query->exec()) {
+        Logger::instance().error(QString("Content hash of %1 failed: %2").arg(table, query->lastError().text()));
+        query->finish();
+        return false;
+    }
+
+    QHash<int, QVector<quint64>> totals;
+    while (query->next()) {
+        const qint64 pkId = query->value(0).toLongLong();
+        const int bucket = bucketSize > 0 ? static_cast<int>(pkId / bucketSize) : 0;
+        const quint64 weight = static_cast<quint64>(pkId % 1009 + 1);   // same weighting as checksumTerms()
+
+        QVector<quint64>& bucketTotals = totals[bucket];
+        if (bucketTotals.isEmpty()) {
+            bucketTotals.fill(0, present.size());
+        }
+        for (int i = 0; i < present.size(); ++i) {
+            bucketTotals[i] += contentHash(query->value(i + 1)) * weight;
+        }
+    }
+    query->finish();
+
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        QStringList values;
+        for (const quint64 total : it.value()) {
+            values << QString::number(total);
+        }
+        sums.insert(it.key(), values.join(':'));
+    }
+    return true;
+}
+
+/**
+ * @brief Read columns [first, first + count) of the current row joined with ':'
+ */
+QString joinedValues(const QSqlQuery& query, int first, int count)
+{
+    QStringList values;
+    for (int i = first; i < first + count; ++i) {
+        values << query.value(i).toString();
+    }
+    return values.join(':');
+}
+
+bool fingerprintTable(const QSqlDatabase& db, const QString& table, QString& fingerprint)
+{
+    const QStringList terms = checksumTerms(db, table);
+    if (terms.isEmpty()) {
+        Logger::instance().error(QString("Fingerprint: table %1 not found").arg(table));
+        return false;
+    }
+
+    QSqlQuery* query = StatementCache::instance().prepared(
+        db, QString("SELECT %1 FROM %2").arg(terms.join(", "), table), true);
+    if (!query) {
+        return false;
+    }
+    if (!query->exec() || !query->next()) {
+        Logger::instance().error(QString("Fingerprint of %1 failed: %2").arg(table, query->lastError().text()));
+        query->finish();
+        return false;
+    }
+
+    fingerprint = joinedValues(*query, 0, terms.size());
+    query->finish();
+
+    if (db.driverName() != "QMYSQL") {
+        QHash<int, QString> sums;
+        if (!stringColumnSums(db, table, 0, sums)) {
+            return false;
+        }
+        fingerprint += ':' + sums.value(0);
+    }
+    return true;
+}
+
+} // namespace
+
+bool DBQueries::selectTableFingerprint(TableFingerprint& fingerprint)
+{
+    QSqlDatabase db = DBConnection::instance().getConnection();
+    if (!db.isOpen()) {
+        Logger::instance().error("Database not connected");
+        return false;
+    }
+
+    TableFingerprint result;
+    const bool ok = fingerprintTable(db, "ne_plate_type", result.plates)
+        && fingerprintTable(db, "ne_md_info", result.mds)
+        && fingerprintTable(db, "ne_flow_info", result.flows);
+
+    if (ok) {
+        fingerprint = result;
+    }
+    return ok;
+}
+
+bool DBQueries::selectBucketChecksums(const QString& table, int bucketSize, QHash<int, QString>& checksums)
+{
+    QSqlDatabase db = DBConnection::instance().getConnection();
+    if (!db.isOpen()) {
+        Logger::instance().error("Database not connected");
+        return false;
+    }
+
+    const QStringList terms = checksumTerms(db, table);
+    if (terms.isEmpty() || bucketSize <= 0) {
+        Logger::instance().error(QString("Checksum: table %1 not found").arg(table));
+        return false;
+    }
+
+    // integer division: '/' on integers in SQLite, DIV in MySQL
+    const QString bucket = db.driverName() == "QMYSQL" ? QString("pk_id DIV %1").arg(bucketSize)
+                                                       : QString("pk_id / %1").arg(bucketSize);
+    QSqlQuery* query = StatementCache::instance().prepared(
+        db, QString("SELECT %1 AS bucket, %2 FROM %3 GROUP BY bucket").arg(bucket, terms.join(", "), table), true);
+    if (!query) {
+        return false;
+    }
+    if (!query->exec()) {
+        Logger::instance().error(QString("Checksum of %1 failed: %2").arg(table, query->lastError().text()));
+        query->finish();
+        return false;
+    }
+
+    QHash<int, QString> result;
+    while (query->next()) {
+        result.insert(query->value(0).toInt(), joinedValues(*query, 1, terms.size()));
+    }
+    query->finish();
+
+    if (db.driverName() != "QMYSQL") {
+        QHash<int, QString> sums;
+        if (!stringColumnSums(db, table, bucketSize, sums)) {
+            return false;
+        }
+        for (auto it = result.begin(); it != result.end(); ++it) {
+            it.value() += ':' + sums.value(it.key());
+        }
+    }
+
+    checksums.swap(result);
+    return true;
+}
+
+bool DBQueries::selectDataVersion(qint64& version, bool& settled)
+{
+    QSqlDatabase db = DBConnection::instance().getConnection();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    // SQLite: bumped whenever another connection commits. MySQL: update
+    // time of the two tables (InnoDB keeps it in memory since 5.7).
+    const bool sqlite = db.driverName() == "QSQLITE";
+    if (!sqlite) {
+        // MySQL 8 serves information_schema.TABLES from a statistics cache
+        // refreshed every information_schema_stats_expiry seconds (a day by
+        // default); read it live on this connection. 5.7 has no such cache
+        // and rejects the variable, which is fine.
+        thread_local QSet<QString> s_liveStats;
+        if (!s_liveStats.contains(db.connectionName())) {
+            QSqlQuery set(db);
+            set.exec("SET SESSION information_schema_stats_expiry = 0");
+            s_liveStats.insert(db.connectionName());
+        }
+    }
+
+    // UPDATE_TIME has 1 s resolution: a value from the current second may
+    // still take another edit without changing, so it is reported unsettled.
+    const QString sql = sqlite
+        ? QString("PRAGMA data_version")
+        : QString("SELECT COALESCE(SUM(UNIX_TIMESTAMP(UPDATE_TIME)), -1), "
+                  "COALESCE(MAX(UNIX_TIMESTAMP(UPDATE_TIME)), 0) >= UNIX_TIMESTAMP() - 1 "
+                  "FROM information_schema.TABLES "
+                  "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME IN ('ne_plate_type', 'ne_md_info')");
+
+    QSqlQuery* query = StatementCache::instance().prepared(db, sql, true);
+    if (!query || !query->exec() || !query->next()) {
+        if (query) {
+            query->finish();
+        }
+        return false;
+    }
+
+    version = query->value(0).toLongLong();
+    settled = sqlite || query->value(1).toInt() == 0;
+    query->finish();
+    return version >= 0;
+}
 
 bool DBQueries::selectAllPlates(QList<ne_plate>& plates)
+{
+    return selectPlates(plates, -1, -1);
+}
+
+bool DBQueries::selectPlatesInRange(int fromId, int toId, QList<ne_plate>& plates)
+{
+    return selectPlates(plates, fromId, toId);
+}
+
+bool DBQueries::selectPlates(QList<ne_plate>& plates, int fromId, int toId)
 {
     QSqlDatabase db = DBConnection::instance().getConnection();
     if (!db.isOpen()) {
@@ -15,30 +427,75 @@ bool DBQueries::selectAllPlates(QList<ne_plate>& plates)
         return false;
     }
 
-    QSqlQuery query(db);
-    if (!query.exec("SELECT * FROM ne_plate_type")) {
-        Logger::instance().error(QString("Query failed: %1").arg(query.lastError().text()));
+    const ColumnMap columns(db, "ne_plate_type", {
+        "pk_id", "sn", "plate_type", "ip", "port", "timeout", "retry",
+        "plate_type_id", "plate_parent_id", "station_name", "ip_addr", "ip_port",
+        "login_name", "login_password", "hard_addr"},
+        fromId >= 0 ? kIdRangeWhere : QString());
+
+    int rowHint = 0;
+    QSqlQuery* cursor = openCursor(db, "ne_plate_type", columns, rowHint, fromId, toId);
+    if (!cursor) {
         return false;
     }
+    QSqlQuery& query = *cursor;
+
+    const int cPkId = columns["pk_id"];
+    const int cSn = columns["sn"];
+    const int cPlateType = columns["plate_type"];
+    const int cIp = columns["ip"];
+    const int cPort = columns["port"];
+    const int cTimeout = columns["timeout"];
+    const int cRetry = columns["retry"];
+    const int cPlateTypeId = columns["plate_type_id"];
+    const int cParentId = columns["plate_parent_id"];
+    const int cStation = columns["station_name"];
+    const int cIpAddr = columns["ip_addr"];
+    const int cIpPort = columns["ip_port"];
+    const int cLoginName = columns["login_name"];
+    const int cLoginPassword = columns["login_password"];
+    const int cHardAddr = columns["hard_addr"];
 
     plates.clear();
+    plates.reserve(rowHint);
     while (query.next()) {
         ne_plate plate;
-        plate.pk_id = query.value("pk_id").toInt();
-        plate.sn = query.value("sn").toString();
-        plate.plate_type = query.value("plate_type").toString();
-        plate.ip = query.value("ip").toString();
-        plate.port = query.value("port").toInt();
-        plate.timeout = query.value("timeout").toInt();
-        plate.retry = query.value("retry").toInt();
+        plate.pk_id = intAt(query, cPkId);
+        plate.sn = stringAt(query, cSn);
+        plate.plate_type = stringAt(query, cPlateType);
+        plate.ip = stringAt(query, cIp);
+        plate.port = intAt(query, cPort);
+        plate.timeout = intAt(query, cTimeout, plate.timeout);
+        plate.retry = intAt(query, cRetry, plate.retry);
+        plate.plate_type_id = intAt(query, cPlateTypeId);
+        plate.plate_parent_id = intAt(query, cParentId);
+        plate.station_name = stringAt(query, cStation);
+        plate.ip_addr = stringAt(query, cIpAddr);
+        plate.ip_port = intAt(query, cIpPort);
+        plate.login_name = stringAt(query, cLoginName);
+        plate.login_password = stringAt(query, cLoginPassword);
+        plate.hard_addr = intAt(query, cHardAddr);
         plates.append(plate);
     }
+    query.finish();
 
-    Logger::instance().info(QString("Loaded %1 plates from database").arg(plates.size()));
+    if (fromId < 0) {
+        Logger::instance().info(QString("Loaded %1 plates from database").arg(plates.size()));
+    }
     return true;
 }
 
 bool DBQueries::selectAllMetaInfo(QList<ne_md_info>& metaInfo)
+{
+    return selectMetaInfo(metaInfo, -1, -1);
+}
+
+bool DBQueries::selectMetaInfoInRange(int fromId, int toId, QList<ne_md_info>& metaInfo)
+{
+    return selectMetaInfo(metaInfo, fromId, toId);
+}
+
+bool DBQueries::selectMetaInfo(QList<ne_md_info>& metaInfo, int fromId, int toId)
 {
     QSqlDatabase db = DBConnection::instance().getConnection();
     if (!db.isOpen()) {
@@ -46,34 +503,110 @@ bool DBQueries::selectAllMetaInfo(QList<ne_md_info>& metaInfo)
         return false;
     }
 
-    QSqlQuery query(db);
-    if (!query.exec("SELECT * FROM ne_md_info")) {
-        Logger::instance().error(QString("Query failed: %1").arg(query.lastError().text()));
+    const ColumnMap columns(db, "ne_md_info", {
+        "pk_id", "plate_id", "md_name", "md_type", "md_unit",
+        "min_value", "max_value", "current_value", "status",
+        "plate_type_id", "plate_control_id", "plate_hard_addr", "tport",
+        "init_value", "kind_id", "curValue_str", "current_value_str"},
+        fromId >= 0 ? kIdRangeWhere : QString());
+
+    int rowHint = 0;
+    QSqlQuery* cursor = openCursor(db, "ne_md_info", columns, rowHint, fromId, toId);
+    if (!cursor) {
         return false;
     }
+    QSqlQuery& query = *cursor;
+
+    const int cPkId = columns["pk_id"];
+    const int cPlateId = columns["plate_id"];
+    const int cName = columns["md_name"];
+    const int cType = columns["md_type"];
+    const int cUnit = columns["md_unit"];
+    const int cMin = columns["min_value"];
+    const int cMax = columns["max_value"];
+    const int cCurrent = columns["current_value"];
+    const int cStatus = columns["status"];
+    const int cPlateTypeId = columns["plate_type_id"];
+    const int cControlId = columns["plate_control_id"];
+    const int cHardAddr = columns["plate_hard_addr"];
+    const int cTport = columns["tport"];
+    const int cInitValue = columns["init_value"];
+    const int cKindId = columns["kind_id"];
+    // older schemas name the string value column curValue_str
+    const int cValueStr = columns["curValue_str"] >= 0 ? columns["curValue_str"] : columns["current_value_str"];
 
     metaInfo.clear();
+    metaInfo.reserve(rowHint);
     while (query.next()) {
         ne_md_info md;
-        md.pk_id = query.value("pk_id").toInt();
-        md.plate_id = query.value("plate_id").toInt();
-        md.md_name = query.value("md_name").toString();
-        md.md_type = query.value("md_type").toString();
-        md.md_unit = query.value("md_unit").toString();
-        md.min_value = query.value("min_value").toInt();
-        md.max_value = query.value("max_value").toInt();
-        md.current_value = query.value("current_value").toInt();
+        md.pk_id = intAt(query, cPkId);
+        md.plate_id = intAt(query, cPlateId);
+        md.md_name = stringAt(query, cName);
+        md.md_type = stringAt(query, cType);
+        md.md_unit = stringAt(query, cUnit);
+        md.min_value = intAt(query, cMin);
+        md.max_value = intAt(query, cMax);
+        md.current_value = intAt(query, cCurrent);
+        md.status = intAt(query, cStatus);
+        md.plate_type_id = intAt(query, cPlateTypeId);
+        md.plate_control_id = intAt(query, cControlId);
+        md.plate_hard_addr = intAt(query, cHardAddr);
+        md.tport = intAt(query, cTport);
+        md.init_value = intAt(query, cInitValue);
+        md.kind_id = intAt(query, cKindId);
+        md.current_value_str = stringAt(query, cValueStr);
+        metaInfo.append(md);
+    }
+    query.finish();
 
-        if (query.record().indexOf("curValue_str") >= 0) {
-            md.current_value_str = query.value("curValue_str").toString();
-        } else if (query.record().indexOf("current_value_str") >= 0) {
-            md.current_value_str = query.value("current_value_str").toString();
-        }
+    if (fromId < 0) {
+        Logger::instance().info(QString("Loaded %1 metadata from database").arg(metaInfo.size()));
+    }
+    return true;
+}
 
-        metaInfo.append(md);
+bool DBQueries::refreshMetadataValues(QList<ne_md_info>& metaInfo, int& changed)
+{
+    changed = 0;
+    QSqlDatabase db = DBConnection::instance().getConnection();
+    if (!db.isOpen()) {
+        Logger::instance().error("Database not connected");
+        return false;
+    }
+
+    const ColumnMap columns(db, "ne_md_info", {"pk_id", "current_value", "curValue_str", "current_value_str"});
+    int rowHint = 0;
+    QSqlQuery* cursor = openCursor(db, "ne_md_info", columns, rowHint);
+    if (!cursor) {
+        return false;
+    }
+    QSqlQuery& query = *cursor;
+
+    const int cPkId = columns["pk_id"];
+    const int cCurrent = columns["current_value"];
+    const int cValueStr = columns["curValue_str"] >= 0 ? columns["curValue_str"] : columns["current_value_str"];
+
+    QHash<int, int> indexById;
+    indexById.reserve(metaInfo.size());
+    for (int i = 0; i < metaInfo.size(); ++i) {
+        indexById.insert(metaInfo[i].pk_id, i);
     }
 
-    Logger::instance().info(QString("Loaded %1 metadata from database").arg(metaInfo.size()));
+    while (query.next()) {
+        const auto it = indexById.constFind(intAt(query, cPkId));
+        if (it == indexById.constEnd()) {
+            continue;   // the configuration columns are fingerprinted, so rows match
+        }
+        ne_md_info& md = metaInfo[it.value()];
+        const int value = intAt(query, cCurrent);
+        const QString valueStr = stringAt(query, cValueStr);
+        if (md.current_value != value || md.current_value_str != valueStr) {
+            md.current_value = value;
+            md.current_value_str = valueStr;
+            ++changed;
+        }
+    }
+    query.finish();
     return true;
 }
 
@@ -85,21 +618,31 @@ bool DBQueries::selectAllFlowInfo(QList<ne_flow_info>& flowInfo)
         return false;
     }
 
-    QSqlQuery query(db);
-    if (!query.exec("SELECT * FROM ne_flow_info")) {
-        Logger::instance().error(QString("Query failed: %1").arg(query.lastError().text()));
+    const ColumnMap columns(db, "ne_flow_info", {"pk_id", "flow_name", "flow_type", "plate_id"});
+
+    int rowHint = 0;
+    QSqlQuery* cursor = openCursor(db, "ne_flow_info", columns, rowHint);
+    if (!cursor) {
         return false;
     }
+    QSqlQuery& query = *cursor;
+
+    const int cPkId = columns["pk_id"];
+    const int cName = columns["flow_name"];
+    const int cType = columns["flow_type"];
+    const int cPlateId = columns["plate_id"];
 
     flowInfo.clear();
+    flowInfo.reserve(rowHint);
     while (query.next()) {
         ne_flow_info flow;
-        flow.pk_id = query.value("pk_id").toInt();
-        flow.flow_name = query.value("flow_name").toString();
-        flow.flow_type = query.value("flow_type").toString();
-        flow.plate_id = query.value("plate_id").toInt();
+        flow.pk_id = intAt(query, cPkId);
+        flow.flow_name = stringAt(query, cName);
+        flow.flow_type = stringAt(query, cType);
+        flow.plate_id = intAt(query, cPlateId);
         flowInfo.append(flow);
     }
+    query.finish();
 
     Logger::instance().info(QString("Loaded %1 flow info from database").arg(flowInfo.size()));
     return true;
@@ -122,30 +665,146 @@ bool DBQueries::updateMetadataValues(const QList<QPair<int, int>>& updates)
         return false;
     }
 
+    const bool ok = updateValues(db, "ne_md_info", updates);
+    if (ok) {
+        s_metadataWrites.fetch_add(1, std::memory_order_release);
+    }
+    return ok;
+}
+
+quint64 DBQueries::metadataWriteCount()
+{
+    return s_metadataWrites.load(std::memory_order_acquire);
+}
+
+QStringList DBQueries::benchmarkUpdates()
+{
+    QStringList report;
+    QSqlDatabase db = DBConnection::instance().getConnection();
+    if (!db.isOpen()) {
+        report << "Database not connected";
+        return report;
+    }
+
+    const QString table = "nenet_bench_md";
+    QSqlQuery ddl(db);
+    ddl.exec(QString("DROP TABLE IF EXISTS %1").arg(table));
+    if (!ddl.exec(QString("CREATE TEMPORARY TABLE %1 (pk_id INTEGER PRIMARY KEY, current_value INTEGER)").arg(table))) {
+        report << QString("Cannot create bench table: %1").arg(ddl.lastError().text());
+        return report;
+    }
+
+    const int rows = 10000;
+    QList<QPair<int, int>> seed;
+    seed.reserve(rows);
+    for (int id = 1; id <= rows; ++id) {
+        seed.append(qMakePair(id, 0));
+    }
+
     const bool hasTx = db.driver() && db.driver()->hasFeature(QSqlDriver::Transactions);
     if (hasTx) {
         db.transaction();
     }
+    QSqlQuery insert(db);
+    insert.prepare(QString("INSERT INTO %1 (pk_id, current_value) VALUES (?, ?)").arg(table));
+    for (const auto& row : seed) {
+        insert.bindValue(0, row.first);
+        insert.bindValue(1, row.second);
+        insert.exec();
+    }
+    if (hasTx) {
+        db.commit();
+    }
 
-    bool allOk = true;
-    for (const auto& item : updates) {
-        const int metadataId = item.first;
-        const int value = item.second;
+    report << QString("update benchmark on %1 (%2 rows)").arg(db.driverName()).arg(rows);
+    if (db.driverName() == "QSQLITE") {
+        // the profile in effect, so runs with different [SQLITE] settings can be compared
+        QStringList settings;
+        QSqlQuery pragma(db);
+        for (const char* name : {"journal_mode", "synchronous", "cache_size", "mmap_size", "temp_store"}) {
+            if (pragma.exec(QString("PRAGMA %1").arg(name)) && pragma.next()) {
+                settings << QString("%1=%2").arg(name, pragma.value(0).toString());
+            }
+        }
+        report << QString("  sqlite: %1").arg(settings.join(' '));
+    }
 
-        QSqlQuery query(db);
-        query.prepare("UPDATE ne_md_info SET current_value = ? WHERE pk_id = ?");
-        query.addBindValue(value);
-        query.addBindValue(metadataId);
+    // one transaction per run, commit included, as updateValues() does it
+    auto timedRun = [&](bool setBased, const QList<QPair<int, int>>& updates, qint64& elapsedUs) {
+        QElapsedTimer timer;
+        timer.start();
+        if (hasTx) {
+            db.transaction();
+        }
+        bool ok = setBased ? updateSetBased(db, table, updates) : updateRowByRow(db, table, updates);
+        if (hasTx) {
+            if (ok) {
+                ok = db.commit();
+            } else {
+                db.rollback();
+            }
+        }
+        elapsedUs = timer.nsecsElapsed() / 1000;
+        return ok;
+    };
 
-        if (!query.exec()) {
-            Logger::instance().error(QString("Update failed for md=%1: %2")
-                                         .arg(metadataId)
-                                         .arg(query.lastError().text()));
-            allOk = false;
-            break;
+    int round = 1;
+    for (int batch : {10, 100, 10000}) {
+        QList<QPair<int, int>> updates;
+        updates.reserve(batch);
+        for (int i = 0; i < batch; ++i) {
+            updates.append(qMakePair(1 + (i * 7919) % rows, round * 100000 + i));
+        }
+        ++round;
+
+        qint64 rowUs = 0;
+        const bool rowOk = timedRun(false, updates, rowUs);
+
+        for (auto& update : updates) {
+            update.second += 1;
         }
+
+        qint64 setUs = 0;
+        const bool setOk = timedRun(true, updates, setUs);
+
+        report << QString("  batch=%1 row-by-row=%2us%3 set-based=%4us%5 (%6 statements)")
+                      .arg(batch, 5)
+                      .arg(rowUs)
+                      .arg(rowOk ? "" : " FAILED")
+                      .arg(setUs)
+                      .arg(setOk ? "" : " FAILED")
+                      .arg(setBasedStatementCount(batch, setBasedMaxChunk(db)));
+    }
+
+    report << QString("  default path for %1: %2")
+                  .arg(db.driverName(), prefersSetBased(db) ? "set-based" : "row-by-row");
+
+    // cached statements on the bench table are re-prepared by the server
+    // if the table is created again by a later run
+    ddl.exec(QString("DROP TABLE %1").arg(table));
+    return report;
+}
+
+bool DBQueries::prefersSetBased(const QSqlDatabase& db)
+{
+    // SQLite runs in-process: a prepared row update costs no round-trip,
+    // and one long CASE statement is slower to plan than N index lookups.
+    // MySQL has not been measured yet, so it keeps the per-row update too;
+    // switch it over only once dbbench shows the CASE update winning there.
+    Q_UNUSED(db);
+    return false;
+}
+
+bool DBQueries::updateValues(QSqlDatabase& db, const QString& table, const QList<QPair<int, int>>& updates)
+{
+    const bool hasTx = db.driver() && db.driver()->hasFeature(QSqlDriver::Transactions);
+    if (hasTx) {
+        db.transaction();
     }
 
+    const bool allOk = prefersSetBased(db) ? updateSetBased(db, table, updates)
+                                           : updateRowByRow(db, table, updates);
+
     if (hasTx) {
         if (allOk) {
             db.commit();
@@ -156,3 +815,121 @@ bool DBQueries::updateMetadataValues(const QList<QPair<int, int>>& updates)
 
     return allOk;
 }
+
+bool DBQueries::updateRowByRow(QSqlDatabase& db, const QString& table, const QList<QPair<int, int>>& updates)
+{
+    QSqlQuery* query = StatementCache::instance().prepared(
+        db, QString("UPDATE %1 SET current_value = ? WHERE pk_id = ?").arg(table));
+    bool allOk = query != nullptr;
+    for (int i = 0; allOk && i < updates.size(); ++i) {
+        const int metadataId = updates[i].first;
+        const int value = updates[i].second;
+
+        query->bindValue(0, value);
+        query->bindValue(1, metadataId);
+
+        if (!query->exec()) {
+            Logger::instance().error(QString("Update failed for md=%1: %2")
+                                         .arg(metadataId)
+                                         .arg(query->lastError().text()));
+            allOk = false;
+        }
+    }
+    if (query) {
+        query->finish();
+    }
+    return allOk;
+}
+
+int DBQueries::setBasedMaxChunk(const QSqlDatabase& db)
+{
+    // 3 parameters per row. SQLite before 3.32 allows 999 per statement
+    // (333 rows); MySQL allows 65535, where 512 rows is already well past
+    // the point of diminishing returns.
+    return db.driverName() == "QSQLITE" ? 256 : 512;
+}
+
+int DBQueries::setBasedChunkSize(int remaining, int maxChunk)
+{
+    // Power-of-two statement shapes keep the statement cache small: take
+    // the largest shape that fits, so only a tail under 8 rows is padded.
+    if (remaining <= 8) {
+        return 8;
+    }
+    int size = 8;
+    while (size * 2 <= remaining && size * 2 <= maxChunk) {
+        size *= 2;
+    }
+    return size;
+}
+
+int DBQueries::setBasedStatementCount(int updates, int maxChunk)
+{
+    int statements = 0;
+    while (updates > 0) {
+        updates -= setBasedChunkSize(updates, maxChunk);
+        ++statements;
+    }
+    return statements;
+}
+
+bool DBQueries::updateSetBased(QSqlDatabase& db, const QString& table, const QList<QPair<int, int>>& updates)
+{
+    // CASE takes the first matching WHEN: collapse repeated ids, last value wins.
+    QVector<QPair<int, int>> rows;
+    rows.reserve(updates.size());
+    QHash<int, int> indexById;
+    indexById.reserve(updates.size());
+    for (const auto& update : updates) {
+        auto it = indexById.constFind(update.first);
+        if (it != indexById.constEnd()) {
+            rows[it.value()].second = update.second;
+        } else {
+            indexById.insert(update.first, rows.size());
+            rows.append(update);
+        }
+    }
+
+    const int maxChunk = setBasedMaxChunk(db);
+    int offset = 0;
+    while (offset < rows.size()) {
+        const int chunk = setBasedChunkSize(rows.size() - offset, maxChunk);
+
+        QString sql = QString("UPDATE %1 SET current_value = CASE pk_id").arg(table);
+        sql.reserve(sql.size() + chunk * 20);
+        for (int i = 0; i < chunk; ++i) {
+            sql += " WHEN ? THEN ?";
+        }
+        sql += " ELSE current_value END WHERE pk_id IN (?";
+        for (int i = 1; i < chunk; ++i) {
+            sql += ",?";
+        }
+        sql += ")";
+
+        QSqlQuery* query = StatementCache::instance().prepared(db, sql);
+        if (!query) {
+            return false;
+        }
+
+        // padding repeats the last real row, which is a no-op
+        const int last = rows.size() - 1;
+        for (int i = 0; i < chunk; ++i) {
+            const auto& row = rows[qMin(offset + i, last)];
+            query->bindValue(2 * i, row.first);
+            query->bindValue(2 * i + 1, row.second);
+            query->bindValue(2 * chunk + i, row.first);
+        }
+
+        if (!query->exec()) {
+            Logger::instance().error(QString("Bulk update of %1 rows failed: %2")
+                                         .arg(qMin(chunk, rows.size() - offset))
+                                         .arg(query->lastError().text()));
+            query->finish();
+            return false;
+        }
+        query->finish();
+        offset += chunk;
+    }
+
+    return true;
+}
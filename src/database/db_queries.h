@@ -3,8 +3,33 @@
 
 #include <QString>
 #include <QList>
+#include <QStringList>
+#include <QHash>
+#include <QSqlDatabase>
 #include "data_structures.h"
 
+/**
+ * @brief Cheap content fingerprint of the configuration tables, one part per table
+ *
+ * Each part holds the row count, max pk_id and pk_id-weighted sums of the
+ * configuration columns; current_value is excluded since NENet writes it.
+ * String columns contribute CRC32 on MySQL; SQLite has no built-in hash,
+ * so there they are fetched and hashed (FNV-1a) on the client.
+ */
+struct TableFingerprint
+{
+    QString plates;
+    QString mds;
+    QString flows;
+
+    bool isValid() const { return !plates.isEmpty() && !mds.isEmpty() && !flows.isEmpty(); }
+    bool operator==(const TableFingerprint& other) const
+    {
+        return plates == other.plates && mds == other.mds && flows == other.flows;
+    }
+    bool operator!=(const TableFingerprint& other) const { return !(*this == other); }
+};
+
 /**
  * @brief Database query operations
  */
@@ -16,16 +41,64 @@ public:
      */
     static bool selectAllPlates(QList<ne_plate>& plates);
 
+    /**
+     * @brief Load plates with fromId <= pk_id <= toId
+     */
+    static bool selectPlatesInRange(int fromId, int toId, QList<ne_plate>& plates);
+
     /**
      * @brief Load all metadata info from database
      */
     static bool selectAllMetaInfo(QList<ne_md_info>& metaInfo);
 
+    /**
+     * @brief Load md rows with fromId <= pk_id <= toId
+     */
+    static bool selectMetaInfoInRange(int fromId, int toId, QList<ne_md_info>& metaInfo);
+
+    /**
+     * @brief Overwrite current_value / current_value_str of loaded md rows with the database's
+     *
+     * For warm starts: the table cache holds the values of the last shutdown,
+     * and the fingerprint does not cover these columns.
+     * @param changed receives the number of rows whose value differed
+     */
+    static bool refreshMetadataValues(QList<ne_md_info>& metaInfo, int& changed);
+
     /**
      * @brief Load all flow info from database
      */
     static bool selectAllFlowInfo(QList<ne_flow_info>& flowInfo);
 
+    /**
+     * @brief Fingerprint ne_plate_type / ne_md_info / ne_flow_info
+     */
+    static bool selectTableFingerprint(TableFingerprint& fingerprint);
+
+    /**
+     * @brief Per-bucket checksum of a configuration table
+     *
+     * Bucket b holds pk_id in [b * bucketSize, (b + 1) * bucketSize); the
+     * checksum uses the same columns as selectTableFingerprint().
+     */
+    static bool selectBucketChecksums(const QString& table, int bucketSize, QHash<int, QString>& checksums);
+
+    /**
+     * @brief Cheap "something was committed" counter for change polling
+     *
+     * SQLite data_version or the MySQL table update time. Also moves on
+     * NENet's own md value writes; compare metadataWriteCount() to tell them apart.
+     * @param settled false if (MySQL) the update time is from the current
+     *        second and a further edit may leave it unchanged
+     * @return false if the database offers no such counter
+     */
+    static bool selectDataVersion(qint64& version, bool& settled);
+
+    /**
+     * @brief Number of md value batches this process has committed (any thread)
+     */
+    static quint64 metadataWriteCount();
+
     /**
      * @brief Update metadata value in database
      */
@@ -33,11 +106,34 @@ public:
 
     /**
      * @brief Batch update metadata values in database
+     *
+     * Runs in one transaction with the prepared per-row update on every
+     * driver. The multi-row CASE update is only timed by dbbench until it has
+     * been measured against MySQL.
      */
     static bool updateMetadataValues(const QList<QPair<int, int>>& updates);
 
+    /**
+     * @brief Time row-by-row vs set-based updates of 10/100/10000 rows
+     *
+     * Works on a temporary table, ne_md_info is not touched.
+     * @return one report line per batch size
+     */
+    static QStringList benchmarkUpdates();
+
 private:
     DBQueries() = delete;
+
+    static bool selectPlates(QList<ne_plate>& plates, int fromId, int toId);
+    static bool selectMetaInfo(QList<ne_md_info>& metaInfo, int fromId, int toId);
+
+    static bool prefersSetBased(const QSqlDatabase& db);
+    static bool updateValues(QSqlDatabase& db, const QString& table, const QList<QPair<int, int>>& updates);
+    static bool updateRowByRow(QSqlDatabase& db, const QString& table, const QList<QPair<int, int>>& updates);
+    static bool updateSetBased(QSqlDatabase& db, const QString& table, const QList<QPair<int, int>>& updates);
+    static int setBasedMaxChunk(const QSqlDatabase& db);
+    static int setBasedChunkSize(int remaining, int maxChunk);
+    static int setBasedStatementCount(int updates, int maxChunk);
 };
 
 #endif // DB_QUERIES_H
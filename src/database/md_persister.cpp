@@ -0,0 +1,389 @@
+#include "md_persister.h"
+#include "db_queries.h"
+#include "../logging/logger.h"
+#include <QThread>
+#include <QElapsedTimer>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+MdPersister& MdPersister::instance()
+{
+    static MdPersister s_instance;
+    return s_instance;
+}
+
+MdPersister::~MdPersister()
+{
+    cleanup();
+}
+
+MdPersister::Durability MdPersister::durabilityFromString(const QString& mode)
+{
+    const QString m = mode.trimmed().toLower();
+    if (m == "memory" || m == "0") {
+        return Durability::Memory;
+    }
+    if (m == "db" || m == "database" || m == "2") {
+        return Durability::Database;
+    }
+    return Durability::Journal;
+}
+
+QString MdPersister::durabilityToString(Durability mode)
+{
+    switch (mode) {
+    case Durability::Memory:
+        return "memory";
+    case Durability::Database:
+        return "db";
+    case Durability::Journal:
+    default:
+        return "journal";
+    }
+}
+
+bool MdPersister::replayJournal(const QString& journalPath)
+{
+    m_journalPath = journalPath;
+    const QString rotated = rotatedJournalPath();
+
+    // Older (rotated) file first so newer entries win.
+    QHash<int, int> values;
+    const bool readOk = readJournalFile(rotated, values) && readJournalFile(journalPath, values);
+    if (!readOk) {
+        Logger::instance().error("Failed to read md journal, keeping files for manual recovery");
+        return false;
+    }
+
+    if (values.isEmpty()) {
+        QFile::remove(rotated);
+        QFile::remove(journalPath);
+        return true;
+    }
+
+    QList<QPair<int, int>> updates;
+    updates.reserve(values.size());
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        updates.append(qMakePair(it.key(), it.value()));
+    }
+
+    if (!DBQueries::updateMetadataValues(updates)) {
+        Logger::instance().error(QString("Md journal replay failed (%1 values), journal kept").arg(updates.size()));
+        return false;
+    }
+
+    QFile::remove(rotated);
+    QFile::remove(journalPath);
+    Logger::instance().info(QString("Md journal replayed: %1 values recovered").arg(updates.size()));
+    return true;
+}
+
+bool MdPersister::initialize(Durability mode, const QString& journalPath, int flushIntervalMs, int maxBatch)
+{
+    if (m_thread) {
+        return true;
+    }
+
+    m_mode = mode;
+    m_journalPath = journalPath;
+    m_flushIntervalMs = flushIntervalMs > 0 ? flushIntervalMs : 200;
+    m_maxBatch = maxBatch > 0 ? maxBatch : 1000;
+    m_stopping = false;
+
+    if (m_mode == Durability::Journal) {
+        m_journal.setFileName(m_journalPath);
+        if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            Logger::instance().error(QString("Cannot open md journal %1: %2")
+                                         .arg(m_journalPath, m_journal.errorString()));
+            return false;
+        }
+    }
+
+    m_thread = QThread::create([this] { flushLoop(); });
+    m_thread->setObjectName("MdPersister");
+    m_thread->start();
+
+    Logger::instance().info(QString("Md persister started: durability=%1 flushInterval=%2ms maxBatch=%3")
+                                .arg(durabilityToString(m_mode))
+                                .arg(m_flushIntervalMs)
+                                .arg(m_maxBatch));
+    return true;
+}
+
+void MdPersister::cleanup()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_flushRequested.wakeAll();
+    }
+
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_journal.isOpen()) {
+            const bool empty = m_journal.size() == 0;
+            m_journal.close();
+            if (empty && m_pending.isEmpty() && !QFile::exists(rotatedJournalPath())) {
+                QFile::remove(m_journalPath);
+            }
+        }
+    }
+
+    Logger::instance().info("Md persister stopped: " + statsSummary());
+}
+
+bool MdPersister::submit(const QList<QPair<int, int>>& updates)
+{
+    if (updates.isEmpty()) {
+        return true;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_thread || m_stopping) {
+        // Not running (startup/shutdown): behave like the old synchronous path.
+        locker.unlock();
+        return DBQueries::updateMetadataValues(updates);
+    }
+
+    if (m_mode == Durability::Journal && !appendJournalLocked(updates)) {
+        return false;
+    }
+
+    for (const auto& item : updates) {
+        if (m_pending.contains(item.first)) {
+            ++m_collapsed;
+        }
+        m_pending.insert(item.first, item.second);
+    }
+
+    const quint64 seq = ++m_submitSeq;
+
+    if (m_mode != Durability::Database) {
+        if (m_pending.size() >= m_maxBatch) {
+            m_flushRequested.wakeOne();
+        }
+        return true;
+    }
+
+    m_flushRequested.wakeOne();
+    while (m_committedSeq < seq && m_failedSeq < seq) {
+        m_flushFinished.wait(&m_mutex);
+    }
+    return m_committedSeq >= seq;
+}
+
+QString MdPersister::statsSummary() const
+{
+    QMutexLocker locker(&m_mutex);
+    return QString("persist(%1): pending=%2 batches=%3 rows=%4 collapsed=%5 failed=%6 lastFlush=%7ms")
+        .arg(durabilityToString(m_mode))
+        .arg(m_pending.size())
+        .arg(m_batches)
+        .arg(m_rowsWritten)
+        .arg(m_collapsed)
+        .arg(m_failedBatches)
+        .arg(m_lastFlushMs);
+}
+
+void MdPersister::flushLoop()
+{
+    bool retrying = false;
+    for (;;) {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (retrying) {
+                // A failed batch went back into m_pending, so it is still "due":
+                // sit out a full interval (submits wake us, only stop ends it early).
+                QElapsedTimer backoff;
+                backoff.start();
+                for (;;) {
+                    const qint64 remainingMs = m_flushIntervalMs - backoff.elapsed();
+                    if (m_stopping || remainingMs <= 0) {
+                        break;
+                    }
+                    m_flushRequested.wait(&m_mutex, static_cast<unsigned long>(remainingMs));
+                }
+            } else {
+                const bool due = m_pending.size() >= m_maxBatch ||
+                                 (m_mode == Durability::Database && !m_pending.isEmpty());
+                if (!m_stopping && !due) {
+                    m_flushRequested.wait(&m_mutex, static_cast<unsigned long>(m_flushIntervalMs));
+                }
+            }
+            if (m_stopping && m_pending.isEmpty()) {
+                break;
+            }
+        }
+
+        const bool ok = flushOnce();
+        retrying = !ok;
+
+        QMutexLocker locker(&m_mutex);
+        if (!ok && m_stopping) {
+            // Leave the rest to the journal; replayJournal() picks it up.
+            Logger::instance().error(QString("Md persister stopping with %1 unflushed values").arg(m_pending.size()));
+            break;
+        }
+    }
+}
+
+bool MdPersister::flushOnce()
+{
+    QHash<int, int> batch;
+    quint64 batchSeq = 0;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_pending.isEmpty()) {
+            return true;
+        }
+        batch.swap(m_pending);
+        batchSeq = m_submitSeq;
+        if (m_mode == Durability::Journal) {
+            rotateJournalLocked();
+        }
+    }
+
+    QList<QPair<int, int>> updates;
+    updates.reserve(batch.size());
+    for (auto it = batch.constBegin(); it != batch.constEnd(); ++it) {
+        updates.append(qMakePair(it.key(), it.value()));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool ok = DBQueries::updateMetadataValues(updates);
+
+    QMutexLocker locker(&m_mutex);
+    m_lastFlushMs = timer.elapsed();
+
+    if (ok) {
+        ++m_batches;
+        m_rowsWritten += static_cast<quint64>(updates.size());
+        m_committedSeq = batchSeq;
+        if (m_mode == Durability::Journal) {
+            QFile::remove(rotatedJournalPath());
+        }
+    } else {
+        ++m_failedBatches;
+        m_failedSeq = batchSeq;
+        if (m_mode != Durability::Database) {
+            // Already acked: keep for retry unless a newer value arrived meanwhile.
+            for (auto it = batch.constBegin(); it != batch.constEnd(); ++it) {
+                if (!m_pending.contains(it.key())) {
+                    m_pending.insert(it.key(), it.value());
+                }
+            }
+        }
+        Logger::instance().error(QString("Md persister batch of %1 values failed").arg(updates.size()));
+    }
+
+    m_flushFinished.wakeAll();
+    return ok;
+}
+
+bool MdPersister::appendJournalLocked(const QList<QPair<int, int>>& updates)
+{
+    QByteArray record;
+    record.reserve(updates.size() * 16);
+    for (const auto& item : updates) {
+        record.append(QByteArray::number(item.first));
+        record.append(' ');
+        record.append(QByteArray::number(item.second));
+        record.append('\n');
+    }
+
+    if (m_journal.write(record) != record.size() || !syncFile(m_journal)) {
+        Logger::instance().error(QString("Md journal write failed: %1").arg(m_journal.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool MdPersister::rotateJournalLocked()
+{
+    const QString rotated = rotatedJournalPath();
+    m_journal.close();
+
+    if (QFile::exists(rotated)) {
+        // The previous batch has not been committed: fold the current
+        // journal into the rotated one so both stay covered.
+        QFile oldFile(rotated);
+        QFile current(m_journalPath);
+        if (oldFile.open(QIODevice::WriteOnly | QIODevice::Append) && current.open(QIODevice::ReadOnly)) {
+            const QByteArray tail = current.readAll();
+            if (oldFile.write(tail) == tail.size() && syncFile(oldFile)) {
+                current.close();
+                QFile::remove(m_journalPath);
+            }
+        }
+    } else {
+        QFile::rename(m_journalPath, rotated);
+    }
+
+    m_journal.setFileName(m_journalPath);
+    if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        Logger::instance().error(QString("Cannot reopen md journal %1: %2")
+                                     .arg(m_journalPath, m_journal.errorString()));
+        return false;
+    }
+    return true;
+}
+
+QString MdPersister::rotatedJournalPath() const
+{
+    return m_journalPath + ".old";
+}
+
+bool MdPersister::readJournalFile(const QString& path, QHash<int, int>& values)
+{
+    QFile file(path);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        const int space = line.indexOf(' ');
+        if (space <= 0) {
+            continue;  // torn last line after a crash
+        }
+
+        bool idOk = false;
+        bool valueOk = false;
+        const int mdId = line.left(space).toInt(&idOk);
+        const int value = line.mid(space + 1).toInt(&valueOk);
+        if (idOk && valueOk) {
+            values.insert(mdId, value);
+        }
+    }
+    return true;
+}
+
+bool MdPersister::syncFile(QFile& file)
+{
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
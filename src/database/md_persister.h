@@ -0,0 +1,118 @@
+#ifndef MD_PERSISTER_H
+#define MD_PERSISTER_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QHash>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+
+class QThread;
+
+/**
+ * @brief Write-behind persistence of md current values
+ *
+ * submit() records updates in memory (later writes to the same md id
+ * replace earlier ones) and a background thread commits them to
+ * ne_md_info in periodic batched transactions. When submit() returns
+ * depends on the durability mode:
+ *  - Memory:   immediately, values live only in memory until the next flush
+ *  - Journal:  after the updates are appended and fsync'ed to a local journal
+ *  - Database: after the batch containing them has been committed
+ *
+ * The journal is rotated on every flush and removed once the batch is
+ * committed; replayJournal() applies whatever is left after a crash.
+ */
+class MdPersister
+{
+public:
+    enum class Durability {
+        Memory,
+        Journal,
+        Database
+    };
+
+    static MdPersister& instance();
+
+    /**
+     * @brief Parse "memory" / "journal" / "db" (case-insensitive), default Journal
+     */
+    static Durability durabilityFromString(const QString& mode);
+    static QString durabilityToString(Durability mode);
+
+    /**
+     * @brief Replay journal files left by a previous run into the database
+     *
+     * Must run after the DB connection is open and before md values are loaded.
+     */
+    bool replayJournal(const QString& journalPath);
+
+    /**
+     * @brief Start the flush thread
+     */
+    bool initialize(Durability mode, const QString& journalPath, int flushIntervalMs, int maxBatch);
+
+    /**
+     * @brief Flush everything still pending and stop the flush thread
+     */
+    void cleanup();
+
+    /**
+     * @brief Record (md id, value) updates
+     * @return true once the configured durability level is reached
+     */
+    bool submit(const QList<QPair<int, int>>& updates);
+
+    Durability durability() const { return m_mode; }
+
+    /**
+     * @brief One-line counters: pending, batches, rows, collapsed, last flush time
+     */
+    QString statsSummary() const;
+
+private:
+    MdPersister() = default;
+    ~MdPersister();
+
+    MdPersister(const MdPersister&) = delete;
+    MdPersister& operator=(const MdPersister&) = delete;
+
+    void flushLoop();
+    bool flushOnce();
+    bool appendJournalLocked(const QList<QPair<int, int>>& updates);
+    bool rotateJournalLocked();
+    QString rotatedJournalPath() const;
+
+    static bool readJournalFile(const QString& path, QHash<int, int>& values);
+    static bool syncFile(QFile& file);
+
+    Durability m_mode = Durability::Journal;
+    QString m_journalPath;
+    int m_flushIntervalMs = 200;
+    int m_maxBatch = 1000;
+
+    QThread* m_thread = nullptr;
+    bool m_stopping = false;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_flushRequested;
+    QWaitCondition m_flushFinished;
+    QHash<int, int> m_pending;
+    QFile m_journal;
+
+    // sequence numbers let Database-mode callers wait for "their" batch
+    quint64 m_submitSeq = 0;
+    quint64 m_committedSeq = 0;
+    quint64 m_failedSeq = 0;
+
+    // counters
+    quint64 m_batches = 0;
+    quint64 m_rowsWritten = 0;
+    quint64 m_collapsed = 0;
+    quint64 m_failedBatches = 0;
+    qint64 m_lastFlushMs = 0;
+};
+
+#endif // MD_PERSISTER_H
@@ -0,0 +1,94 @@
+#include "statement_cache.h"
+#include "../logging/logger.h"
+#include <QSqlError>
+
+StatementCache& StatementCache::instance()
+{
+    static StatementCache s_instance;
+    return s_instance;
+}
+
+StatementCache::~StatementCache()
+{
+    clear();
+}
+
+QSqlQuery* StatementCache::prepared(const QSqlDatabase& db, const QString& sql, bool forwardOnly)
+{
+    QMutexLocker locker(&m_mutex);
+    Statements*& statements = m_connections[db.connectionName()];
+    if (!statements) {
+        statements = new Statements();
+    }
+
+    const auto it = statements->constFind(sql);
+    if (it != statements->constEnd()) {
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+        return it.value();
+    }
+
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+
+    auto* query = new QSqlQuery(db);
+    query->setForwardOnly(forwardOnly);
+    if (!query->prepare(sql)) {
+        m_failures.fetch_add(1, std::memory_order_relaxed);
+        Logger::instance().error(QString("Prepare failed: %1 [%2]").arg(query->lastError().text(), sql));
+        delete query;
+        return nullptr;
+    }
+
+    statements->insert(sql, query);
+    m_statementCount.fetch_add(1, std::memory_order_relaxed);
+    return query;
+}
+
+void StatementCache::release(const QString& connectionName)
+{
+    Statements* statements = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        statements = m_connections.take(connectionName);
+    }
+
+    if (statements) {
+        m_statementCount.fetch_sub(statements->size(), std::memory_order_relaxed);
+        qDeleteAll(*statements);
+        delete statements;
+    }
+}
+
+void StatementCache::clear()
+{
+    QHash<QString, Statements*> connections;
+    {
+        QMutexLocker locker(&m_mutex);
+        connections.swap(m_connections);
+    }
+
+    for (Statements* statements : connections) {
+        m_statementCount.fetch_sub(statements->size(), std::memory_order_relaxed);
+        qDeleteAll(*statements);
+        delete statements;
+    }
+}
+
+QString StatementCache::statsSummary() const
+{
+    int connections = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        connections = m_connections.size();
+    }
+
+    const quint64 h = hits();
+    const quint64 m = misses();
+    const quint64 total = h + m;
+    return QString("statements: connections=%1 cached=%2 hits=%3 misses=%4 failures=%5 hitRate=%6%")
+        .arg(connections)
+        .arg(m_statementCount.load(std::memory_order_relaxed))
+        .arg(h)
+        .arg(m)
+        .arg(m_failures.load(std::memory_order_relaxed))
+        .arg(total ? (100.0 * static_cast<double>(h) / static_cast<double>(total)) : 0.0, 0, 'f', 1);
+}
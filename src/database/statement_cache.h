@@ -0,0 +1,69 @@
+#ifndef STATEMENT_CACHE_H
+#define STATEMENT_CACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <atomic>
+
+/**
+ * @brief Per-connection cache of prepared statements
+ *
+ * Each SQL text is prepared once per connection and the same QSqlQuery is
+ * rebound on every later use. The registry is thread-safe, but a returned
+ * statement belongs to its connection and must only be used by the thread
+ * that uses the connection. Call release() before a connection is closed
+ * or removed.
+ */
+class StatementCache
+{
+public:
+    static StatementCache& instance();
+
+    /**
+     * @brief Get the prepared statement for sql on db, preparing it on first use
+     * @param forwardOnly set on statements that are only iterated once (selects)
+     * @return nullptr if the statement could not be prepared
+     */
+    QSqlQuery* prepared(const QSqlDatabase& db, const QString& sql, bool forwardOnly = false);
+
+    /**
+     * @brief Drop all statements belonging to a connection
+     */
+    void release(const QString& connectionName);
+
+    /**
+     * @brief Drop every cached statement
+     */
+    void clear();
+
+    quint64 hits() const { return m_hits.load(std::memory_order_relaxed); }
+    quint64 misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief One-line counters: connections, statements, hits, misses, failures
+     */
+    QString statsSummary() const;
+
+private:
+    StatementCache() = default;
+    ~StatementCache();
+
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+
+    // heap-allocated queries: returned pointers survive rehashing
+    using Statements = QHash<QString, QSqlQuery*>;
+
+    mutable QMutex m_mutex;
+    QHash<QString, Statements*> m_connections;
+
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_failures{0};
+    std::atomic<int> m_statementCount{0};
+};
+
+#endif // STATEMENT_CACHE_H
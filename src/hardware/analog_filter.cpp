@@ -0,0 +1,212 @@
+#include "analog_filter.h"
+#include <QtEndian>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NENET_ANALOG_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+#ifdef NENET_ANALOG_SSE2
+inline __m128i loadSwapped(const uchar* raw)
+{
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+}
+
+AnalogFilter::AnalogFilter()
+    : AnalogFilter(Options())
+{
+}
+
+AnalogFilter::AnalogFilter(const Options& options)
+    : m_options(options)
+{
+    m_options.window = qBound(1, options.window, kMaxWindow);
+    m_options.deadband = qMax(0, options.deadband);
+    m_ring.resize(m_options.window * kChannels);
+}
+
+AnalogFilter::Mode AnalogFilter::modeFromString(const QString& name)
+{
+    const QString mode = name.trimmed().toLower();
+    if (mode == "median") {
+        return Mode::Median;
+    }
+    if (mode == "off" || mode == "none") {
+        return Mode::Off;
+    }
+    return Mode::Average;
+}
+
+bool AnalogFilter::vectorized()
+{
+#ifdef NENET_ANALOG_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AnalogFilter::reset()
+{
+    std::fill(m_sums, m_sums + kChannels, 0);
+    m_head = 0;
+    m_count = 0;
+    m_hasPublished = false;
+}
+
+quint16 AnalogFilter::push(const uchar* raw, int* filtered)
+{
+    quint16* row = m_ring.data() + m_head * kChannels;
+    const bool full = m_count == m_options.window;
+
+    // the row being overwritten drops out of the running sums
+#ifdef NENET_ANALOG_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (int half = 0; half < 2; ++half) {
+        const __m128i fresh = loadSwapped(raw + half * 16);
+        __m128i* slot = reinterpret_cast<__m128i*>(row + half * 8);
+        const __m128i old = full ? _mm_loadu_si128(slot) : zero;
+        _mm_storeu_si128(slot, fresh);
+
+        __m128i* sums = reinterpret_cast<__m128i*>(m_sums + half * 8);
+        const __m128i deltaLo = _mm_sub_epi32(_mm_unpacklo_epi16(fresh, zero), _mm_unpacklo_epi16(old, zero));
+        const __m128i deltaHi = _mm_sub_epi32(_mm_unpackhi_epi16(fresh, zero), _mm_unpackhi_epi16(old, zero));
+        _mm_store_si128(sums, _mm_add_epi32(_mm_load_si128(sums), deltaLo));
+        _mm_store_si128(sums + 1, _mm_add_epi32(_mm_load_si128(sums + 1), deltaHi));
+    }
+#else
+    for (int channel = 0; channel < kChannels; ++channel) {
+        const quint16 fresh = qFromBigEndian<quint16>(raw + channel * 2);
+        if (full) {
+            m_sums[channel] -= row[channel];
+        }
+        m_sums[channel] += fresh;
+        row[channel] = fresh;
+    }
+#endif
+
+    m_head = (m_head + 1) % m_options.window;
+    if (!full) {
+        ++m_count;
+    }
+
+    switch (m_options.mode) {
+    case Mode::Average:
+        average(filtered);
+        break;
+    case Mode::Median:
+        median(filtered);
+        break;
+    case Mode::Off:
+        std::copy(row, row + kChannels, filtered);
+        break;
+    }
+    return applyDeadband(filtered);
+}
+
+void AnalogFilter::average(int* filtered) const
+{
+    // rounded (sum + n/2) / n; sums stay below 2^22, so the float quotient is exact enough to truncate
+#ifdef NENET_ANALOG_SSE2
+    const __m128i half = _mm_set1_epi32(m_count / 2);
+    const __m128 count = _mm_set1_ps(static_cast<float>(m_count));
+    for (int group = 0; group < kChannels / 4; ++group) {
+        const __m128i sum = _mm_add_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(m_sums + group * 4)), half);
+        const __m128i mean = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sum), count));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(filtered + group * 4), mean);
+    }
+#else
+    for (int channel = 0; channel < kChannels; ++channel) {
+        filtered[channel] = (m_sums[channel] + m_count / 2) / m_count;
+    }
+#endif
+}
+
+void AnalogFilter::median(int* filtered) const
+{
+    const quint16* rows = m_ring.constData();
+    const int n = m_count;
+
+#ifdef NENET_ANALOG_SSE2
+    // odd-even transposition sort of the window, 8 channels per register;
+    // SSE2 only has signed 16-bit min/max, so values are biased by 0x8000
+    const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+    __m128i lo[kMaxWindow];
+    __m128i hi[kMaxWindow];
+    for (int i = 0; i < n; ++i) {
+        const __m128i* row = reinterpret_cast<const __m128i*>(rows + i * kChannels);
+        lo[i] = _mm_xor_si128(_mm_loadu_si128(row), bias);
+        hi[i] = _mm_xor_si128(_mm_loadu_si128(row + 1), bias);
+    }
+    for (int pass = 0; pass < n; ++pass) {
+        for (int i = pass & 1; i + 1 < n; i += 2) {
+            const __m128i lowerLo = _mm_min_epi16(lo[i], lo[i + 1]);
+            lo[i + 1] = _mm_max_epi16(lo[i], lo[i + 1]);
+            lo[i] = lowerLo;
+            const __m128i lowerHi = _mm_min_epi16(hi[i], hi[i + 1]);
+            hi[i + 1] = _mm_max_epi16(hi[i], hi[i + 1]);
+            hi[i] = lowerHi;
+        }
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i medianLo = _mm_xor_si128(lo[n / 2], bias);
+    const __m128i medianHi = _mm_xor_si128(hi[n / 2], bias);
+    __m128i* out = reinterpret_cast<__m128i*>(filtered);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(medianLo, zero));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(medianLo, zero));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(medianHi, zero));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(medianHi, zero));
+#else
+    quint16 window[kMaxWindow];
+    for (int channel = 0; channel < kChannels; ++channel) {
+        for (int i = 0; i < n; ++i) {
+            window[i] = rows[i * kChannels + channel];
+        }
+        std::nth_element(window, window + n / 2, window + n);
+        filtered[channel] = window[n / 2];
+    }
+#endif
+}
+
+quint16 AnalogFilter::applyDeadband(const int* filtered)
+{
+    if (!m_hasPublished) {
+        std::copy(filtered, filtered + kChannels, m_published);
+        m_hasPublished = true;
+        return 0xFFFF;
+    }
+
+    // a deadband of 0 still requires the value to change
+    const int threshold = qMax(1, m_options.deadband);
+    quint16 publish = 0;
+
+#ifdef NENET_ANALOG_SSE2
+    const __m128i below = _mm_set1_epi32(threshold - 1);
+    for (int group = 0; group < kChannels / 4; ++group) {
+        __m128i* published = reinterpret_cast<__m128i*>(m_published + group * 4);
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(filtered + group * 4));
+        const __m128i last = _mm_load_si128(published);
+        const __m128i diff = _mm_sub_epi32(value, last);
+        const __m128i sign = _mm_srai_epi32(diff, 31);
+        const __m128i distance = _mm_sub_epi32(_mm_xor_si128(diff, sign), sign);
+        const __m128i moved = _mm_cmpgt_epi32(distance, below);
+
+        _mm_store_si128(published, _mm_or_si128(_mm_and_si128(moved, value), _mm_andnot_si128(moved, last)));
+        publish |= static_cast<quint16>(_mm_movemask_ps(_mm_castsi128_ps(moved)) << (group * 4));
+    }
+#else
+    for (int channel = 0; channel < kChannels; ++channel) {
+        if (qAbs(filtered[channel] - m_published[channel]) >= threshold) {
+            m_published[channel] = filtered[channel];
+            publish |= static_cast<quint16>(1u << channel);
+        }
+    }
+#endif
+    return publish;
+}
@@ -0,0 +1,70 @@
+#ifndef ANALOG_FILTER_H
+#define ANALOG_FILTER_H
+
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Smoothing and deadband for the 16 analog channels of one MoNi module
+ *
+ * Keeps the last window samples of every channel and filters all 16
+ * channels in one pass (SSE2 where available, scalar otherwise). A
+ * channel is reported only when its filtered value moved by at least the
+ * deadband since it was last reported.
+ */
+class AnalogFilter
+{
+public:
+    static constexpr int kChannels = 16;
+    static constexpr int kMaxWindow = 64;
+
+    enum class Mode {
+        Off,        // raw values, deadband only
+        Average,    // moving average over the window
+        Median      // moving median over the window
+    };
+
+    struct Options {
+        Mode mode = Mode::Average;
+        int window = 10;        // [HardIO] AIFilter
+        int deadband = 0;       // raw units, 0 = report any change
+    };
+
+    AnalogFilter();
+    explicit AnalogFilter(const Options& options);
+
+    /**
+     * @brief Add one sample per channel
+     * @param raw 16 big-endian 16-bit values as they arrive in the report
+     * @param filtered receives the filtered value of every channel
+     * @return bit i set if channel i has to be published
+     */
+    quint16 push(const uchar* raw, int* filtered);
+
+    /**
+     * @brief Forget all samples; the next push publishes every channel
+     */
+    void reset();
+
+    static Mode modeFromString(const QString& name);
+
+    /**
+     * @brief True if this build filters with SSE2
+     */
+    static bool vectorized();
+
+private:
+    void average(int* filtered) const;
+    void median(int* filtered) const;
+    quint16 applyDeadband(const int* filtered);
+
+    Options m_options;
+    QVector<quint16> m_ring;        // window rows of kChannels samples
+    alignas(16) qint32 m_sums[kChannels] = {};
+    alignas(16) qint32 m_published[kChannels] = {};
+    int m_head = 0;
+    int m_count = 0;
+    bool m_hasPublished = false;
+};
+
+#endif // ANALOG_FILTER_H
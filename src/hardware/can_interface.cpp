@@ -1,4 +1,36 @@
 #include "can_interface.h"
+#include "logging/logger.h"
+#include "core/global_data.h"
+#include <QThread>
+#include <QVector>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
+
+#ifdef Q_OS_LINUX
+namespace {
+// frames taken per recvmmsg call
+constexpr int kReceiveBatch = 64;
+
+qint64 toNs(const struct timespec& ts)
+{
+    return static_cast<qint64>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+}
+#endif
 
 CANInterface& CANInterface::instance()
 {
@@ -15,25 +47,296 @@ CANInterface::~CANInterface()
     cleanup();
 }
 
-bool CANInterface::initialize()
+bool CANInterface::initialize(const QString& type, int channel, int bitrate)
 {
-    // TODO: Initialize CAN device
-    m_initialized = true;
-    return true;
+    if (m_initialized) {
+        return true;
+    }
+
+    const QString canType = type.trimmed().toLower();
+#ifdef Q_OS_LINUX
+    if (canType == "socketcan" || canType == "vcan") {
+        const QString interfaceName = QString("%1%2").arg(canType == "vcan" ? "vcan" : "can").arg(channel);
+        if (!openSocketCan(interfaceName, bitrate)) {
+            return false;
+        }
+        m_initialized = true;
+        return true;
+    }
+#else
+    Q_UNUSED(channel);
+    Q_UNUSED(bitrate);
+#endif
+
+    Logger::instance().info(QString("CAN type %1 has no driver in this build, CAN disabled").arg(type));
+    return false;
 }
 
 void CANInterface::cleanup()
 {
     stopReceiving();
+#ifdef Q_OS_LINUX
+    closeSocketCan();
+#endif
     m_initialized = false;
 }
 
 void CANInterface::startReceiving()
 {
-    // TODO: Start receiving loop
+#ifdef Q_OS_LINUX
+    if (!m_initialized || m_receiveThread) {
+        return;
+    }
+
+    m_receiveThread = QThread::create([this] { receiveLoop(); });
+    m_receiveThread->setObjectName("CANReceive");
+    m_receiveThread->start();
+    Logger::instance().info(QString("CAN receiving on %1").arg(m_interfaceName));
+#endif
 }
 
 void CANInterface::stopReceiving()
 {
-    // TODO: Stop receiving loop
+    if (!m_receiveThread) {
+        return;
+    }
+
+#ifdef Q_OS_LINUX
+    const quint64 one = 1;
+    if (::write(m_wakeFd, &one, sizeof(one)) != sizeof(one)) {
+        Logger::instance().warning("CAN receive thread wake-up failed");
+    }
+#endif
+    m_receiveThread->wait();
+    delete m_receiveThread;
+    m_receiveThread = nullptr;
+    Logger::instance().info("CAN receiving stopped: " + statsSummary());
+}
+
+QString CANInterface::statsSummary() const
+{
+    if (!m_initialized) {
+        return "can: disabled";
+    }
+    const quint64 batches = m_batches.load(std::memory_order_relaxed);
+    const quint64 received = m_frames.load(std::memory_order_relaxed) + m_errorFrames.load(std::memory_order_relaxed);
+    return QString("can: %1 frames=%2 errorFrames=%3 readErrors=%4 batches=%5 (avg %6 frames, max %7) "
+                   "timestamps kernel/none=%8/%9 queueDropped=%10")
+        .arg(m_interfaceName)
+        .arg(m_frames.load(std::memory_order_relaxed))
+        .arg(m_errorFrames.load(std::memory_order_relaxed))
+        .arg(m_readErrors.load(std::memory_order_relaxed))
+        .arg(batches)
+        .arg(batches > 0 ? QString::number(static_cast<double>(received) / batches, 'f', 1) : QString("0"))
+        .arg(m_maxBatch.load(std::memory_order_relaxed))
+        .arg(m_kernelStamps.load(std::memory_order_relaxed))
+        .arg(m_unstamped.load(std::memory_order_relaxed))
+        .arg(m_queueDropped.load(std::memory_order_relaxed));
+}
+
+#ifdef Q_OS_LINUX
+bool CANInterface::openSocketCan(const QString& interfaceName, int bitrate)
+{
+    const QByteArray name = interfaceName.toLatin1();
+    if (name.size() >= IFNAMSIZ) {
+        Logger::instance().error(QString("CAN interface name too long: %1").arg(interfaceName));
+        return false;
+    }
+
+    m_socket = ::socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+    if (m_socket < 0) {
+        Logger::instance().error(QString("CAN socket failed: %1").arg(std::strerror(errno)));
+        return false;
+    }
+
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::memcpy(ifr.ifr_name, name.constData(), static_cast<size_t>(name.size()));
+    if (::ioctl(m_socket, SIOCGIFINDEX, &ifr) < 0) {
+        Logger::instance().error(QString("CAN interface %1 not found: %2").arg(interfaceName, std::strerror(errno)));
+        closeSocketCan();
+        return false;
+    }
+    const int ifIndex = ifr.ifr_ifindex;
+
+    // the bitrate belongs to the link, which needs CAP_NET_ADMIN to change;
+    // a down link is reported with the command that brings it up
+    if (::ioctl(m_socket, SIOCGIFFLAGS, &ifr) == 0 && !(ifr.ifr_flags & IFF_UP)) {
+        Logger::instance().warning(QString("CAN interface %1 is down; bring it up with "
+                                           "'ip link set %1 up type can bitrate %2'")
+                                       .arg(interfaceName)
+                                       .arg(bitrate));
+    }
+
+    // error frames are counted, not dropped silently by the kernel
+    const can_err_mask_t errorMask = CAN_ERR_MASK;
+    ::setsockopt(m_socket, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &errorMask, sizeof(errorMask));
+
+    // kernel software receive timestamps (CLOCK_REALTIME); raw hardware stamps
+    // run on the CAN controller's own clock and are not requested
+    const int stampFlags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (::setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPING, &stampFlags, sizeof(stampFlags)) < 0) {
+        Logger::instance().warning(QString("CAN SO_TIMESTAMPING unavailable (%1), frames stamped on receive")
+                                       .arg(std::strerror(errno)));
+    }
+
+    struct sockaddr_can addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifIndex;
+    if (::bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        Logger::instance().error(QString("CAN bind to %1 failed: %2").arg(interfaceName, std::strerror(errno)));
+        closeSocketCan();
+        return false;
+    }
+
+    m_wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_wakeFd < 0 || m_epoll < 0) {
+        Logger::instance().error(QString("CAN epoll setup failed: %1").arg(std::strerror(errno)));
+        closeSocketCan();
+        return false;
+    }
+
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_socket;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_socket, &event);
+    event.data.fd = m_wakeFd;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &event);
+
+    m_interfaceName = interfaceName;
+    Logger::instance().info(QString("CAN interface %1 opened (SocketCAN, expected bitrate %2)")
+                                .arg(interfaceName)
+                                .arg(bitrate));
+    return true;
+}
+
+void CANInterface::closeSocketCan()
+{
+    for (int* fd : {&m_epoll, &m_wakeFd, &m_socket}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void CANInterface::receiveLoop()
+{
+    // one frame, iovec and control buffer per batch slot, reused across calls
+    struct can_frame frames[kReceiveBatch];
+    struct iovec iovs[kReceiveBatch];
+    struct mmsghdr messages[kReceiveBatch];
+    // the union gives each slot cmsghdr alignment, which CMSG_FIRSTHDR() assumes (see cmsg(3))
+    union ControlBuffer {
+        char buf[CMSG_SPACE(sizeof(struct scm_timestamping))];
+        struct cmsghdr align;
+    };
+    ControlBuffer control[kReceiveBatch];
+    std::memset(messages, 0, sizeof(messages));
+    for (int i = 0; i < kReceiveBatch; ++i) {
+        iovs[i].iov_base = &frames[i];
+        iovs[i].iov_len = sizeof(frames[i]);
+        messages[i].msg_hdr.msg_iov = &iovs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    QVector<HardwareEvent> batch;
+    batch.reserve(kReceiveBatch);
+    struct epoll_event events[2];
+    while (true) {
+        const int ready = ::epoll_wait(m_epoll, events, 2, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::instance().error(QString("CAN epoll_wait failed: %1").arg(std::strerror(errno)));
+            return;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.fd == m_wakeFd) {
+                return;
+            }
+        }
+
+        // drain the socket, up to kReceiveBatch frames per syscall and one queue push per batch
+        while (true) {
+            for (int i = 0; i < kReceiveBatch; ++i) {
+                messages[i].msg_hdr.msg_control = control[i].buf;
+                messages[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+                messages[i].msg_hdr.msg_flags = 0;
+            }
+
+            const int count = ::recvmmsg(m_socket, messages, kReceiveBatch, MSG_DONTWAIT, nullptr);
+            if (count < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    m_readErrors.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            }
+
+            struct timespec now;
+            ::clock_gettime(CLOCK_REALTIME, &now);
+            const qint64 receivedNs = toNs(now);
+
+            for (int i = 0; i < count; ++i) {
+                const struct can_frame& frame = frames[i];
+                if (messages[i].msg_len != sizeof(frame)) {
+                    m_readErrors.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                HardwareEvent event;
+                if (frame.can_id & CAN_ERR_FLAG) {
+                    m_errorFrames.fetch_add(1, std::memory_order_relaxed);
+                    event.type = HardwareEvent::ERROR_OCCURRED;
+                    event.source_id = static_cast<int>(frame.can_id & CAN_ERR_MASK);
+                } else {
+                    m_frames.fetch_add(1, std::memory_order_relaxed);
+                    event.type = HardwareEvent::DATA_RECEIVED;
+                    event.source_id = static_cast<int>(frame.can_id & CAN_EFF_MASK);
+                }
+                event.payload = QByteArray(reinterpret_cast<const char*>(frame.data), qMin<int>(frame.can_dlc, CAN_MAX_DLEN));
+                event.timestamp = frameTimestamp(messages[i].msg_hdr, receivedNs);
+                batch.append(std::move(event));
+            }
+
+            m_batches.fetch_add(1, std::memory_order_relaxed);
+            if (static_cast<quint64>(count) > m_maxBatch.load(std::memory_order_relaxed)) {
+                m_maxBatch.store(static_cast<quint64>(count), std::memory_order_relaxed);
+            }
+            const int built = batch.size();
+            const int queued = GlobalData::instance().pushHardwareEvents(batch);
+            if (queued < built) {
+                m_queueDropped.fetch_add(static_cast<quint64>(built - queued), std::memory_order_relaxed);
+            }
+
+            if (count < kReceiveBatch) {
+                break;      // socket drained
+            }
+        }
+    }
+}
+
+qint64 CANInterface::frameTimestamp(const struct msghdr& header, qint64 fallbackNs)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&header), cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING) {
+            continue;
+        }
+        struct scm_timestamping stamps;
+        std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+        // ts[0] is the kernel software stamp; ts[2] (raw hardware) is in the
+        // controller's clock domain, not the Unix epoch, and is never used
+        if (stamps.ts[0].tv_sec != 0 || stamps.ts[0].tv_nsec != 0) {
+            m_kernelStamps.fetch_add(1, std::memory_order_relaxed);
+            return toNs(stamps.ts[0]);
+        }
+    }
+    m_unstamped.fetch_add(1, std::memory_order_relaxed);
+    return fallbackNs;
 }
+#endif
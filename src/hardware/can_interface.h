@@ -2,12 +2,23 @@
 #define CAN_INTERFACE_H
 
 #include <QString>
-#include <QTimer>
+#include <QtGlobal>
+#include <atomic>
+
+class QThread;
+#ifdef Q_OS_LINUX
+struct msghdr;
+#endif
 
 /**
  * @brief CAN hardware interface
  *
- * Manages CAN communication using USBCAN2 driver
+ * On Linux, CAN_Type=SocketCAN (or vcan for testing) opens a raw CAN
+ * socket on can<CAN_Channel> / vcan<CAN_Channel>. A dedicated thread
+ * waits on it with epoll, drains it with recvmmsg (many frames per
+ * syscall) and pushes each batch into the hardware event queue at once,
+ * every event stamped with the kernel's receive time (SO_TIMESTAMPING).
+ * Other CAN types (USBCAN2) have no driver in this build.
  */
 class CANInterface
 {
@@ -16,8 +27,11 @@ public:
 
     /**
      * @brief Initialize CAN device
+     * @param type [HardIO] CAN_Type
+     * @param channel [HardIO] CAN_Channel, interface index
+     * @param bitrate [HardIO] CAN_Baudrate, expected bus bitrate
      */
-    bool initialize();
+    bool initialize(const QString& type, int channel, int bitrate);
 
     /**
      * @brief Cleanup CAN device
@@ -34,6 +48,11 @@ public:
      */
     void stopReceiving();
 
+    /**
+     * @brief Interface, frames received, error frames and read failures
+     */
+    QString statsSummary() const;
+
 private:
     CANInterface();
     ~CANInterface();
@@ -41,8 +60,33 @@ private:
     CANInterface(const CANInterface&) = delete;
     CANInterface& operator=(const CANInterface&) = delete;
 
-    QTimer m_receiveTimer;
+#ifdef Q_OS_LINUX
+    bool openSocketCan(const QString& interfaceName, int bitrate);
+    void closeSocketCan();
+    void receiveLoop();
+
+    /**
+     * @brief Kernel software receive time of one frame from its SCM_TIMESTAMPING data, ns since the epoch
+     */
+    qint64 frameTimestamp(const struct msghdr& header, qint64 fallbackNs);
+
+    int m_socket = -1;
+    int m_epoll = -1;
+    int m_wakeFd = -1;      // eventfd, wakes the receive thread for shutdown
+#endif
+
+    QThread* m_receiveThread = nullptr;
+    QString m_interfaceName;
     bool m_initialized = false;
+
+    std::atomic<quint64> m_frames{0};
+    std::atomic<quint64> m_errorFrames{0};
+    std::atomic<quint64> m_readErrors{0};
+    std::atomic<quint64> m_batches{0};          // recvmmsg calls that returned frames
+    std::atomic<quint64> m_maxBatch{0};
+    std::atomic<quint64> m_kernelStamps{0};
+    std::atomic<quint64> m_unstamped{0};        // stamped with the time recvmmsg returned
+    std::atomic<quint64> m_queueDropped{0};     // hardware event queue full
 };
 
 #endif // CAN_INTERFACE_H
@@ -0,0 +1,237 @@
+#include "jf_frame.h"
+#include <cstring>
+
+namespace {
+
+constexpr uchar kSync0 = 0xEA;
+constexpr uchar kSync1 = 0xAE;
+constexpr uchar kSlaveAddr = 0xBF;
+
+// command bytes of JFPlate::JFPlateFlag
+constexpr quint8 kKnownCommands[] = {
+    0x00, 0x01, 0x02, 0x03, 0x10, 0x11, 0x12, 0x13, 0x21, 0x28,
+    0x30, 0x31, 0x38, 0x80, 0x81, 0x83, 0x91, 0x92, 0x98
+};
+
+struct CommandTable
+{
+    bool known[256] = {};
+    CommandTable()
+    {
+        for (quint8 command : kKnownCommands) {
+            known[command] = true;
+        }
+    }
+};
+
+const CommandTable& commandTable()
+{
+    static const CommandTable s_table;
+    return s_table;
+}
+
+int roundUpPow2(int value)
+{
+    int capacity = 1;
+    while (capacity < value) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+} // namespace
+
+JFFrameDecoder::JFFrameDecoder(int capacity)
+{
+    const int size = roundUpPow2(qMax(capacity, 4 * kMaxFrameSize));
+    m_ring = new uchar[size];
+    m_mask = static_cast<quint64>(size - 1);
+}
+
+JFFrameDecoder::~JFFrameDecoder()
+{
+    delete[] m_ring;
+}
+
+char* JFFrameDecoder::writeSpan(int& length)
+{
+    const quint64 capacity = m_mask + 1;
+    const quint64 free = capacity - (m_head - m_tail);
+    const quint64 offset = m_head & m_mask;
+    length = static_cast<int>(qMin(free, capacity - offset));
+    return reinterpret_cast<char*>(m_ring + offset);
+}
+
+void JFFrameDecoder::commit(int length)
+{
+    if (length <= 0) {
+        return;
+    }
+    m_head += static_cast<quint64>(length);
+    m_bytesIn.fetch_add(static_cast<quint64>(length), std::memory_order_relaxed);
+}
+
+void JFFrameDecoder::reset()
+{
+    m_tail = m_head;
+    m_inSync = true;
+}
+
+void JFFrameDecoder::discard(quint64 count)
+{
+    m_tail += count;
+    m_garbageBytes.fetch_add(count, std::memory_order_relaxed);
+}
+
+bool JFFrameDecoder::findSync()
+{
+    // Scan the contiguous runs of the ring for 0xEA; stop on EA AE or on a
+    // trailing 0xEA whose second byte has not arrived yet.
+    while (m_head - m_tail >= 2) {
+        if (at(m_tail) == kSync0 && at(m_tail + 1) == kSync1) {
+            return true;
+        }
+        if (m_inSync) {
+            m_inSync = false;
+            m_resyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const quint64 from = m_tail + 1;
+        const quint64 offset = from & m_mask;
+        const quint64 run = qMin(m_head - from, m_mask + 1 - offset);
+        const void* hit = std::memchr(m_ring + offset, kSync0, static_cast<size_t>(run));
+        if (!hit) {
+            discard(1 + run);
+            continue;
+        }
+        discard(1 + static_cast<quint64>(static_cast<const uchar*>(hit) - (m_ring + offset)));
+    }
+
+    // a lone byte can only be kept if it may start the next sync
+    if (m_head - m_tail == 1 && at(m_tail) != kSync0) {
+        if (m_inSync) {
+            m_inSync = false;
+            m_resyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+        discard(1);
+    }
+    return false;
+}
+
+bool JFFrameDecoder::next(JFFrameView& frame)
+{
+    for (;;) {
+        if (!findSync()) {
+            return false;
+        }
+
+        const quint64 available = m_head - m_tail;
+        if (available < static_cast<quint64>(kHeaderSize)) {
+            return false;
+        }
+        const bool slave = at(m_tail + 2) == kSlaveAddr;
+        if (!commandTable().known[at(m_tail + (slave ? 4 : 3))]) {
+            // EA AE inside garbage or a corrupted header: look for the next sync
+            m_badCommands.fetch_add(1, std::memory_order_relaxed);
+            m_inSync = false;
+            discard(1);
+            continue;
+        }
+
+        // both layouts are 7 bytes plus payload (slave: 6 header + checksum)
+        const int frameSize = kHeaderSize + at(m_tail + (slave ? 5 : 6));
+        if (available < static_cast<quint64>(frameSize)) {
+            return false;
+        }
+        if (slave) {
+            uint sum = 0;
+            for (int i = 0; i < frameSize - 1; ++i) {
+                sum += at(m_tail + static_cast<quint64>(i));
+            }
+            if ((sum & 0xFF) != at(m_tail + static_cast<quint64>(frameSize - 1))) {
+                m_badChecksums.fetch_add(1, std::memory_order_relaxed);
+                m_inSync = false;
+                discard(1);
+                continue;
+            }
+        }
+
+        const quint64 offset = m_tail & m_mask;
+        if (offset + static_cast<quint64>(frameSize) <= m_mask + 1) {
+            frame.data = m_ring + offset;
+        } else {
+            // wraps around the end of the ring: the only copy a frame ever takes
+            const int first = static_cast<int>(m_mask + 1 - offset);
+            std::memcpy(m_scratch, m_ring + offset, static_cast<size_t>(first));
+            std::memcpy(m_scratch + first, m_ring, static_cast<size_t>(frameSize - first));
+            frame.data = m_scratch;
+        }
+        frame.size = frameSize;
+
+        m_tail += static_cast<quint64>(frameSize);
+        m_inSync = true;
+        m_frames.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+QString JFFrameDecoder::statsSummary() const
+{
+    return QString("frames=%1 bytesIn=%2 garbage=%3B resyncs=%4 badCmd=%5 badSum=%6")
+        .arg(frames())
+        .arg(bytesIn())
+        .arg(garbageBytes())
+        .arg(resyncs())
+        .arg(badCommands())
+        .arg(badChecksums());
+}
+
+QByteArray JFFrameDecoder::encode(quint8 command, quint16 serial, const QByteArray& payload)
+{
+    const int length = payload.size();
+    if (length > kMaxPayload) {
+        return QByteArray();
+    }
+    QByteArray frame(kHeaderSize + length, Qt::Uninitialized);
+    frame[0] = static_cast<char>(kSync0);
+    frame[1] = static_cast<char>(kSync1);
+    frame[2] = static_cast<char>(0x01);
+    frame[3] = static_cast<char>(command);
+    frame[4] = static_cast<char>(serial & 0xFF);
+    frame[5] = static_cast<char>((serial >> 8) & 0xFF);
+    frame[6] = static_cast<char>(length);
+    if (length > 0) {
+        std::memcpy(frame.data() + kHeaderSize, payload.constData(), static_cast<size_t>(length));
+    }
+    return frame;
+}
+
+QByteArray JFFrameDecoder::encodeSlave(quint8 command, const QByteArray& payload)
+{
+    const int length = payload.size();
+    if (length > kMaxPayload) {
+        return QByteArray();
+    }
+    QByteArray frame(kHeaderSize + length, Qt::Uninitialized);
+    frame[0] = static_cast<char>(kSync0);
+    frame[1] = static_cast<char>(kSync1);
+    frame[2] = static_cast<char>(kSlaveAddr);
+    frame[3] = static_cast<char>(0x01);
+    frame[4] = static_cast<char>(command);
+    frame[5] = static_cast<char>(length);
+    if (length > 0) {
+        std::memcpy(frame.data() + 6, payload.constData(), static_cast<size_t>(length));
+    }
+
+    uint sum = 0;
+    for (int i = 0; i < frame.size() - 1; ++i) {
+        sum += static_cast<uchar>(frame[i]);
+    }
+    frame[frame.size() - 1] = static_cast<char>(sum & 0xFF);
+    return frame;
+}
+
+bool JFFrameDecoder::isKnownCommand(quint8 command)
+{
+    return commandTable().known[command];
+}
@@ -0,0 +1,135 @@
+#ifndef JF_FRAME_H
+#define JF_FRAME_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+/**
+ * @brief One JF frame, a view into JFFrameDecoder's buffer valid until the next writeSpan()
+ *
+ * Master frame: EA AE | 01 | cmd | serial lo | serial hi | len | payload[len]
+ * Slave frame:  EA AE | BF | 01 | cmd | len | payload[len] | sum
+ * where sum is the low byte of the sum of all bytes before it.
+ */
+struct JFFrameView
+{
+    const uchar* data = nullptr;
+    int size = 0;
+
+    bool isSlave() const { return data[2] == 0xBF; }
+    quint8 command() const { return isSlave() ? data[4] : data[3]; }
+    quint16 serial() const { return isSlave() ? 0 : static_cast<quint16>(data[4] | (data[5] << 8)); }
+    int payloadSize() const { return isSlave() ? data[5] : data[6]; }
+    const uchar* payloadData() const { return data + (isSlave() ? 6 : 7); }
+
+    /**
+     * @brief The payload as a QByteArray sharing the frame bytes (no copy)
+     */
+    QByteArray payload() const
+    {
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(payloadData()), payloadSize());
+    }
+};
+
+/**
+ * @brief Incremental JF frame decoder over a fixed-capacity ring buffer
+ *
+ * The socket reads straight into the ring (writeSpan() / commit()) and
+ * next() hands out complete frames as views, so a good frame is never
+ * copied unless it wraps around the end of the ring. On lost sync the
+ * decoder skips to the next 0xEA 0xAE with memchr instead of dropping one
+ * byte per pass, which keeps the cost linear in the input however much of
+ * it is garbage. Frames with an unknown command byte or, for slave
+ * frames, a wrong checksum are treated as a false sync and skipped the
+ * same way.
+ *
+ * Not thread-safe except for the counters.
+ */
+class JFFrameDecoder
+{
+public:
+    static constexpr int kHeaderSize = 7;
+    static constexpr int kMaxPayload = 255;    // one length byte
+    static constexpr int kMaxFrameSize = kHeaderSize + kMaxPayload;
+
+    /**
+     * @param capacity rounded up to a power of two, at least 4 frames
+     */
+    explicit JFFrameDecoder(int capacity = 64 * 1024);
+    ~JFFrameDecoder();
+
+    JFFrameDecoder(const JFFrameDecoder&) = delete;
+    JFFrameDecoder& operator=(const JFFrameDecoder&) = delete;
+
+    /**
+     * @brief Contiguous free space to read into; length 0 when full
+     */
+    char* writeSpan(int& length);
+
+    /**
+     * @brief Mark length bytes written into the last writeSpan()
+     */
+    void commit(int length);
+
+    /**
+     * @brief Next complete frame, or false until more bytes arrive
+     */
+    bool next(JFFrameView& frame);
+
+    /**
+     * @brief Drop buffered bytes (reconnect); counters are kept
+     */
+    void reset();
+
+    int buffered() const { return static_cast<int>(m_head - m_tail); }
+
+    quint64 frames() const { return m_frames.load(std::memory_order_relaxed); }
+    quint64 bytesIn() const { return m_bytesIn.load(std::memory_order_relaxed); }
+    quint64 garbageBytes() const { return m_garbageBytes.load(std::memory_order_relaxed); }
+    quint64 resyncs() const { return m_resyncs.load(std::memory_order_relaxed); }
+    quint64 badCommands() const { return m_badCommands.load(std::memory_order_relaxed); }
+    quint64 badChecksums() const { return m_badChecksums.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Sync losses plus frames rejected after a valid-looking sync
+     */
+    quint64 malformed() const { return resyncs() + badCommands() + badChecksums(); }
+
+    QString statsSummary() const;
+
+    /**
+     * @brief Build a master frame (EA AE 01 cmd serial len payload)
+     * @return empty if the payload exceeds kMaxPayload; callers split larger writes
+     */
+    static QByteArray encode(quint8 command, quint16 serial, const QByteArray& payload);
+
+    /**
+     * @brief Build a slave frame (EA AE BF 01 cmd len payload sum)
+     * @return empty if the payload exceeds kMaxPayload
+     */
+    static QByteArray encodeSlave(quint8 command, const QByteArray& payload);
+
+    static bool isKnownCommand(quint8 command);
+
+private:
+    uchar at(quint64 pos) const { return m_ring[pos & m_mask]; }
+    void discard(quint64 count);
+    bool findSync();
+
+    uchar* m_ring = nullptr;
+    quint64 m_mask = 0;
+    quint64 m_head = 0;     // total bytes committed
+    quint64 m_tail = 0;     // total bytes consumed
+    bool m_inSync = true;
+    uchar m_scratch[kMaxFrameSize];
+
+    std::atomic<quint64> m_frames{0};
+    std::atomic<quint64> m_bytesIn{0};
+    std::atomic<quint64> m_garbageBytes{0};
+    std::atomic<quint64> m_resyncs{0};
+    std::atomic<quint64> m_badCommands{0};
+    std::atomic<quint64> m_badChecksums{0};
+};
+
+#endif // JF_FRAME_H
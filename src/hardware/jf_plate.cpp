@@ -1,14 +1,32 @@
 #include "jf_plate.h"
 #include "database/data_structures.h"
 #include "logging/logger.h"
+#include "core/pipeline_stats.h"
+#include "jf_plate_pool.h"
+#include "core/global_data.h"
 #include <QCryptographicHash>
+#include <QTimer>
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QtAlgorithms>
+
+namespace {
+// retry interval while all fleet connect slots are taken
+constexpr int kSlotRetryMs = 50;
+
+constexpr int kBitRecordSize = 3;
+constexpr int kAnalogRecordSize = 1 + 16 * 2;
+
+// (hard addr, bits 15..8, bits 7..0) records that fit one setDO payload after its 0x02 prefix
+constexpr int kMaxDORecords = (JFFrameDecoder::kMaxPayload - 1) / kBitRecordSize;
+}
 
 JFPlate::JFPlate(const JFHardControl& control, QObject* parent)
     : QObject(parent)
 {
-    m_waitSendList.append(0x02);
     m_waitSendList1.append(0x02);
 
+    m_controlId = control.pk_id;
     m_ip = QHostAddress(control.ip_addr);
     m_port = static_cast<quint16>(control.ip_port);
     if (!control.login_password.isEmpty()) {
@@ -19,7 +37,6 @@ JFPlate::JFPlate(const JFHardControl& control, QObject* parent)
 JFPlate::JFPlate(QObject* parent)
     : QObject(parent)
 {
-    m_waitSendList.append(0x02);
     m_waitSendList1.append(0x02);
 }
 
@@ -41,13 +58,32 @@ bool JFPlate::initialize()
         connect(m_socket, &QTcpSocket::readyRead, this, &JFPlate::onReadyRead);
         connect(m_socket, &QTcpSocket::errorOccurred, this, &JFPlate::onSocketError);
     }
+    if (!m_commandTimer) {
+        m_commandTimer = new QTimer(this);
+        m_commandTimer->setInterval(qMax(10, m_linkOptions.commandTimeoutMs / 4));
+        connect(m_commandTimer, &QTimer::timeout, this, &JFPlate::checkCommandTimeouts);
+    }
+    if (!m_reconnectTimer) {
+        m_reconnectTimer = new QTimer(this);
+        m_reconnectTimer->setSingleShot(true);
+        connect(m_reconnectTimer, &QTimer::timeout, this, &JFPlate::startConnect);
+        m_connectTimer = new QTimer(this);
+        m_connectTimer->setSingleShot(true);
+        connect(m_connectTimer, &QTimer::timeout, this, &JFPlate::onConnectTimeout);
+    }
+    if (!m_doFlushTimer) {
+        m_doFlushTimer = new QTimer(this);
+        m_doFlushTimer->setSingleShot(true);
+        m_doFlushTimer->setInterval(m_linkOptions.doCoalesceMs);
+        connect(m_doFlushTimer, &QTimer::timeout, this, &JFPlate::flushDO);
+    }
 
     m_initialized = true;
-    m_canSend = true;
-    m_scanSend = true;
+    m_failedAttempts = 0;
+    m_downSinceNs = PipelineClock::nowNs();
 
     if (!m_ip.isNull() && m_port > 0) {
-        m_socket->connectToHost(m_ip, m_port);
+        startConnect();
     }
 
     return true;
@@ -56,83 +92,217 @@ bool JFPlate::initialize()
 void JFPlate::cleanup()
 {
     m_initialized = false;
+    m_ready.store(false, std::memory_order_release);
+    abortCommands();
+
+    if (m_reconnectTimer) {
+        m_reconnectTimer->stop();
+        m_connectTimer->stop();
+    }
+    discardStagedDO();
+    releaseConnectSlot();
+    setLinkState(LinkState::Idle);
 
     if (m_socket) {
         m_socket->disconnectFromHost();
     }
 }
 
-QByteArray JFPlate::createSendMsg(JFPlateFlag cmd, int msgSerial, const QByteArray& data)
+QString JFPlate::linkStateName(LinkState state)
 {
-    QByteArray sendMsg;
-    sendMsg.resize(data.size() + 7);
-    sendMsg[0] = static_cast<char>(0xEA);
-    sendMsg[1] = static_cast<char>(0xAE);
-    sendMsg[2] = static_cast<char>(0x01);
-    sendMsg[3] = static_cast<char>(cmd);
-    sendMsg[4] = static_cast<char>(msgSerial & 0xFF);
-    sendMsg[5] = static_cast<char>((msgSerial >> 8) & 0xFF);
-    sendMsg[6] = static_cast<char>(data.size() & 0xFF);
-    for (int i = 0; i < data.size(); ++i) {
-        sendMsg[7 + i] = data[i];
+    switch (state) {
+    case LinkState::Idle: return "idle";
+    case LinkState::WaitingSlot: return "waiting";
+    case LinkState::Connecting: return "connecting";
+    case LinkState::Authenticating: return "authenticating";
+    case LinkState::Ready: return "ready";
+    case LinkState::Backoff: return "backoff";
     }
-    return sendMsg;
+    return "unknown";
 }
 
-QByteArray JFPlate::createSlaveSendMsg(JFPlateFlag cmd, const QByteArray& data)
+void JFPlate::setLinkState(LinkState state)
 {
-    QByteArray sendMsg;
-    sendMsg.resize(data.size() + 7);
-    sendMsg[0] = static_cast<char>(0xEA);
-    sendMsg[1] = static_cast<char>(0xAE);
-    sendMsg[2] = static_cast<char>(0xBF);
-    sendMsg[3] = static_cast<char>(0x01);
-    sendMsg[4] = static_cast<char>(cmd);
-    sendMsg[5] = static_cast<char>(data.size() & 0xFF);
+    m_linkState.store(static_cast<int>(state), std::memory_order_relaxed);
+}
 
-    for (int i = 0; i < data.size(); ++i) {
-        sendMsg[6 + i] = data[i];
+void JFPlate::startConnect()
+{
+    if (!m_initialized || !m_socket) {
+        return;
     }
 
-    int sum = 0;
-    for (int i = 0; i < sendMsg.size(); ++i) {
-        sum += static_cast<unsigned char>(sendMsg[i]);
+    // a restart of hundreds of boards must not connect and hash all at once
+    if (!JFPlatePool::instance().tryAcquireConnectSlot()) {
+        setLinkState(LinkState::WaitingSlot);
+        m_reconnectTimer->start(kSlotRetryMs + QRandomGenerator::global()->bounded(kSlotRetryMs));
+        return;
     }
-    sendMsg[sendMsg.size() - 1] = static_cast<char>(sum & 0xFF);
-    return sendMsg;
+
+    m_holdingSlot = true;
+    setLinkState(LinkState::Connecting);
+    m_decoder.reset();
+    m_connectTimer->start(m_linkOptions.connectTimeoutMs);
+    m_socket->abort();
+    m_socket->connectToHost(m_ip, m_port);
 }
 
-bool JFPlate::setEachDO(bool isSend, int high, int low)
+void JFPlate::onConnectTimeout()
 {
-    if (!m_initialized) {
+    const LinkState state = linkState();
+    if (state == LinkState::Connecting || state == LinkState::Authenticating) {
+        linkDown(QString("%1 timed out after %2 ms").arg(linkStateName(state)).arg(m_linkOptions.connectTimeoutMs));
+    }
+}
+
+void JFPlate::releaseConnectSlot()
+{
+    if (m_holdingSlot) {
+        m_holdingSlot = false;
+        JFPlatePool::instance().releaseConnectSlot();
+    }
+}
+
+void JFPlate::linkReady()
+{
+    if (linkState() == LinkState::Ready) {
+        return;
+    }
+    m_connectTimer->stop();
+    releaseConnectSlot();
+    setLinkState(LinkState::Ready);
+    m_ready.store(true, std::memory_order_release);
+
+    const qint64 timeToReadyMs = (PipelineClock::nowNs() - m_downSinceNs) / 1000000;
+    JFPlatePool::instance().recordTimeToReady(m_controlId, timeToReadyMs, m_failedAttempts);
+    m_failedAttempts = 0;
+    m_downSinceNs = 0;
+}
+
+void JFPlate::linkDown(const QString& reason)
+{
+    const LinkState state = linkState();
+    if (!m_initialized || state == LinkState::Idle || state == LinkState::Backoff
+        || state == LinkState::WaitingSlot) {
+        return;     // already handled (error and disconnected both report one failure)
+    }
+
+    // leave the state first: abort() below re-enters through disconnected
+    setLinkState(LinkState::Backoff);
+    m_ready.store(false, std::memory_order_release);
+    m_connectTimer->stop();
+    releaseConnectSlot();
+    abortCommands();
+    clearChannelState();
+    discardStagedDO();
+
+    if (state == LinkState::Ready) {
+        m_reconnects.fetch_add(1, std::memory_order_relaxed);
+        m_downSinceNs = PipelineClock::nowNs();
+    } else {
+        ++m_failedAttempts;
+    }
+    if (m_socket) {
+        m_socket->abort();
+    }
+
+    // exponential backoff with equal jitter: half fixed, half random
+    const int shift = qMin(m_failedAttempts, 16);
+    const qint64 ceiling = qMin<qint64>(m_linkOptions.reconnectMaxMs,
+                                        static_cast<qint64>(m_linkOptions.reconnectBaseMs) << shift);
+    const int half = static_cast<int>(qMax<qint64>(1, ceiling / 2));
+    const int delay = half + QRandomGenerator::global()->bounded(half + 1);
+    m_reconnectTimer->start(delay);
+
+    if (m_decoder.malformed() > 0) {
+        Logger::instance().warning(QString("JFPlate %1 receive stats: %2")
+                                       .arg(m_controlId)
+                                       .arg(m_decoder.statsSummary()));
+    }
+    Logger::instance().warning(QString("JFPlate %1 %2:%3 down (%4), reconnect in %5 ms")
+                                   .arg(m_controlId)
+                                   .arg(m_ip.toString())
+                                   .arg(m_port)
+                                   .arg(reason)
+                                   .arg(delay));
+}
+
+QByteArray JFPlate::createSendMsg(JFPlateFlag cmd, int msgSerial, const QByteArray& data)
+{
+    return JFFrameDecoder::encode(static_cast<quint8>(cmd), static_cast<quint16>(msgSerial), data);
+}
+
+QByteArray JFPlate::createSlaveSendMsg(JFPlateFlag cmd, const QByteArray& data)
+{
+    return JFFrameDecoder::encodeSlave(static_cast<quint8>(cmd), data);
+}
+
+bool JFPlate::setEachDO(int hardAddr, quint16 bits)
+{
+    if (!m_initialized || hardAddr < 0 || hardAddr >= static_cast<int>(m_doValues.size())) {
+        return false;
+    }
+    if (!isReady()) {
+        // never replayed on reconnect: after an outage it would be stale
+        m_doDropped.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
 
-    if (!isSend) {
-        m_waitSendList.append(static_cast<quint8>(high & 0xFF));
-        m_waitSendList.append(static_cast<quint8>(low & 0xFF));
-        return true;
+    if (!m_doPending.test(hardAddr)) {
+        m_doPending.set(hardAddr);
+        m_doOrder[m_doPendingCount++] = static_cast<quint8>(hardAddr);
     }
+    m_doValues[hardAddr] = bits;
+    m_doWrites.fetch_add(1, std::memory_order_relaxed);
 
-    QByteArray payload;
-    for (quint8 b : m_waitSendList) {
-        payload.append(static_cast<char>(b));
+    if (m_doFlushTimer && !m_doFlushTimer->isActive()) {
+        m_doFlushTimer->start();
+    }
+    return true;
+}
+
+void JFPlate::flushDO()
+{
+    if (m_doPendingCount == 0 || !isReady()) {
+        return;
     }
 
-    bool ok = true;
-    if (payload.size() > 2 && m_canSend) {
-        ++m_msgSerial;
-        if (m_msgSerial >= 9999) {
-            m_msgSerial = 1;
+    // 0x02, then one getDO-style record per staged module; the length byte
+    // limits one frame to kMaxDORecords modules, more go out as further frames
+    for (int first = 0; first < m_doPendingCount; first += kMaxDORecords) {
+        const int records = qMin(kMaxDORecords, m_doPendingCount - first);
+        QByteArray payload(1 + kBitRecordSize * records, Qt::Uninitialized);
+        char* out = payload.data();
+        *out++ = 0x02;
+        for (int i = first; i < first + records; ++i) {
+            const quint8 hardAddr = m_doOrder[i];
+            *out++ = static_cast<char>(hardAddr);
+            *out++ = static_cast<char>(m_doValues[hardAddr] >> 8);
+            *out++ = static_cast<char>(m_doValues[hardAddr] & 0xFF);
         }
-        const QByteArray packet = createSendMsg(JFPlateFlag::setDO, m_msgSerial, payload);
-        ok = sendPacketToHardware(packet);
-        m_canSend = false;
+
+        const int serial = nextSerial();
+        submitCommand(JFPlateFlag::setDO, static_cast<quint16>(serial),
+                      createSendMsg(JFPlateFlag::setDO, serial, payload));
+        m_doFrames.fetch_add(1, std::memory_order_relaxed);
     }
+    m_doPending.reset();
+    m_doPendingCount = 0;
+}
 
-    m_waitSendList.clear();
-    m_waitSendList.append(0x02);
-    return ok;
+void JFPlate::discardStagedDO()
+{
+    if (m_doFlushTimer) {
+        m_doFlushTimer->stop();
+    }
+    if (m_doPendingCount > 0) {
+        m_doDropped.fetch_add(static_cast<quint64>(m_doPendingCount), std::memory_order_relaxed);
+        Logger::instance().warning(QString("JFPlate %1: %2 staged DO module writes discarded, link down")
+                                       .arg(m_controlId)
+                                       .arg(m_doPendingCount));
+    }
+    m_doPending.reset();
+    m_doPendingCount = 0;
 }
 
 bool JFPlate::setSlaveEachDO(bool isSend, int high, int low)
@@ -152,30 +322,24 @@ bool JFPlate::setSlaveEachDO(bool isSend, int high, int low)
         payload.append(static_cast<char>(b));
     }
 
-    bool ok = true;
-    if (payload.size() > 2 && m_scanSend) {
-        ++m_msgSerial;
-        if (m_msgSerial >= 9999) {
-            m_msgSerial = 1;
-        }
-        const QByteArray packet = createSlaveSendMsg(JFPlateFlag::setCom, payload);
-        ok = sendPacketToHardware(packet);
-        m_scanSend = false;
+    if (payload.size() > 2) {
+        submitCommand(JFPlateFlag::setCom, 0, createSlaveSendMsg(JFPlateFlag::setCom, payload));
     }
 
     m_waitSendList1.clear();
     m_waitSendList1.append(0x02);
-    return ok;
+    return true;
 }
 
 void JFPlate::onConnected()
 {
-    Logger::instance().info(QString("JFPlate connected: %1:%2").arg(m_ip.toString()).arg(m_port));
+    setLinkState(LinkState::Authenticating);
+    Logger::instance().debug(QString("JFPlate connected: %1:%2").arg(m_ip.toString()).arg(m_port));
 }
 
 void JFPlate::onDisconnected()
 {
-    Logger::instance().warning("JFPlate disconnected, waiting reconnect by upper logic");
+    linkDown("disconnected");
 }
 
 void JFPlate::onReadyRead()
@@ -184,24 +348,21 @@ void JFPlate::onReadyRead()
         return;
     }
 
-    m_recvBuffer.append(m_socket->readAll());
-
-    while (m_recvBuffer.size() >= 7) {
-        if (static_cast<unsigned char>(m_recvBuffer[0]) != 0xEA ||
-            static_cast<unsigned char>(m_recvBuffer[1]) != 0xAE) {
-            m_recvBuffer.remove(0, 1);
-            continue;
+    // Read straight into the decoder's ring; frames are drained after every
+    // read so the ring never has to hold more than one socket chunk.
+    for (;;) {
+        int space = 0;
+        char* span = m_decoder.writeSpan(space);
+        const qint64 got = space > 0 ? m_socket->read(span, space) : 0;
+        if (got <= 0) {
+            break;
         }
+        m_decoder.commit(static_cast<int>(got));
 
-        const int len = static_cast<unsigned char>(m_recvBuffer[6]);
-        const int frameLen = 7 + len;
-        if (m_recvBuffer.size() < frameLen) {
-            return;
+        JFFrameView frame;
+        while (m_decoder.next(frame)) {
+            handlePlatePacket(frame);
         }
-
-        const QByteArray frame = m_recvBuffer.left(frameLen);
-        m_recvBuffer.remove(0, frameLen);
-        handlePlatePacket(frame);
     }
 }
 
@@ -209,49 +370,163 @@ void JFPlate::onSocketError(QAbstractSocket::SocketError error)
 {
     Q_UNUSED(error)
     if (m_socket) {
-        Logger::instance().error(QString("JFPlate socket error: %1").arg(m_socket->errorString()));
+        linkDown(m_socket->errorString());
     }
 }
 
-void JFPlate::handlePlatePacket(const QByteArray& msg)
+void JFPlate::handlePlatePacket(const JFFrameView& frame)
 {
-    if (msg.size() < 7) {
-        return;
-    }
-
-    const auto cmd = static_cast<JFPlateFlag>(static_cast<unsigned char>(msg[3]));
-    const int len = static_cast<unsigned char>(msg[6]);
-    QByteArray data;
-    if (len > 0 && msg.size() >= 7 + len) {
-        data = msg.mid(7, len);
-    }
-
-    handleCommand(cmd, data);
+    // payload() shares the decoder's buffer; handlers copy what they keep
+    handleCommand(static_cast<JFPlateFlag>(frame.command()), frame.serial(), frame.payload());
 }
 
-void JFPlate::handleCommand(JFPlateFlag cmd, const QByteArray& data)
+void JFPlate::handleCommand(JFPlateFlag cmd, quint16 serial, const QByteArray& data)
 {
     switch (cmd) {
     case JFPlateFlag::getSetDO:
-        m_canSend = true;
+        completeCommand(JFPlateFlag::setDO, serial);
         break;
     case JFPlateFlag::getSetCom:
-        m_scanSend = true;
+        completeCommand(JFPlateFlag::setCom, serial);
         break;
     case JFPlateFlag::getRandomCode:
         plateLogin(data);
         break;
     case JFPlateFlag::getVerifyReply: {
+        linkReady();
+        Logger::instance().info(QString("JFPlate %1 authenticated: %2:%3")
+                                    .arg(m_controlId)
+                                    .arg(m_ip.toString())
+                                    .arg(m_port));
         const QByteArray q1(1, static_cast<char>(0x00));
         sendPacketToHardware(createSendMsg(JFPlateFlag::setGetDI, 1123, q1));
         sendPacketToHardware(createSendMsg(JFPlateFlag::setGetDO, 1124, q1));
         break;
     }
+    case JFPlateFlag::getDI:
+    case JFPlateFlag::getEventUp:
+        decodeBitReport(ChannelChange::DI, data);
+        break;
+    case JFPlateFlag::getDO:
+        decodeBitReport(ChannelChange::DO, data);
+        break;
+    case JFPlateFlag::getMoNiDI:
+    case JFPlateFlag::getMoNiBH:
+    case JFPlateFlag::getMoNiDIHF:
+        decodeAnalogReport(data);
+        break;
     default:
         break;
     }
 }
 
+void JFPlate::decodeBitReport(ChannelChange::Kind kind, const QByteArray& data)
+{
+    QHash<int, quint16>& state = kind == ChannelChange::DO ? m_doBits : m_diBits;
+    if (kind == ChannelChange::DI) {
+        m_lastInputReportNs.store(PipelineClock::nowNs(), std::memory_order_relaxed);
+    }
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    QVector<ChannelChange> changes;
+
+    for (int offset = 0; offset + kBitRecordSize <= data.size(); offset += kBitRecordSize) {
+        const int hardAddr = bytes[offset];
+        const quint16 bits = static_cast<quint16>((bytes[offset + 1] << 8) | bytes[offset + 2]);
+
+        auto it = state.find(hardAddr);
+        quint16 changed = 0xFFFF;   // first report of a module: publish all
+        if (it != state.end()) {
+            changed = static_cast<quint16>(it.value() ^ bits);
+            it.value() = bits;
+        } else {
+            state.insert(hardAddr, bits);
+        }
+
+        while (changed) {
+            const int channel = qCountTrailingZeroBits(changed);
+            changed &= static_cast<quint16>(changed - 1);
+
+            ChannelChange change;
+            change.kind = kind;
+            change.channel = static_cast<quint8>(channel);
+            change.hardAddr = static_cast<quint16>(hardAddr);
+            change.value = (bits >> channel) & 1;
+            changes.append(change);
+        }
+    }
+
+    if (kind == ChannelChange::DI && !changes.isEmpty()) {
+        m_inputChangeReports.fetch_add(1, std::memory_order_relaxed);
+    }
+    publishChanges(changes);
+}
+
+void JFPlate::pollInputs()
+{
+    if (!isReady()) {
+        return;
+    }
+    const QByteArray q1(1, static_cast<char>(0x00));
+    sendPacketToHardware(createSendMsg(JFPlateFlag::setGetDI, nextSerial(), q1));
+}
+
+void JFPlate::decodeAnalogReport(const QByteArray& data)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    QVector<ChannelChange> changes;
+
+    for (int offset = 0; offset + kAnalogRecordSize <= data.size(); offset += kAnalogRecordSize) {
+        const int hardAddr = bytes[offset];
+        auto it = m_analogFilters.find(hardAddr);
+        if (it == m_analogFilters.end()) {
+            it = m_analogFilters.insert(hardAddr, AnalogFilter(m_analogOptions));
+        }
+
+        int filtered[AnalogFilter::kChannels];
+        quint16 publish = it.value().push(bytes + offset + 1, filtered);
+        while (publish != 0) {
+            const int channel = qCountTrailingZeroBits(publish);
+            publish &= static_cast<quint16>(publish - 1);
+
+            ChannelChange change;
+            change.kind = ChannelChange::MN;
+            change.channel = static_cast<quint8>(channel);
+            change.hardAddr = static_cast<quint16>(hardAddr);
+            change.value = filtered[channel];
+            changes.append(change);
+        }
+    }
+
+    publishChanges(changes);
+}
+
+void JFPlate::publishChanges(QVector<ChannelChange>& changes)
+{
+    if (changes.isEmpty()) {
+        return;
+    }
+
+    // one event per report, however many channels moved
+    m_channelChanges.fetch_add(static_cast<quint64>(changes.size()), std::memory_order_relaxed);
+    HardwareEvent event;
+    event.type = HardwareEvent::CHANNELS_CHANGED;
+    event.source_id = m_controlId;
+    event.timestamp = QDateTime::currentMSecsSinceEpoch() * 1000000;
+    event.changes.swap(changes);
+    if (!GlobalData::instance().pushHardwareEvent(std::move(event))) {
+        // Reports are change-only: forget what was published so the next
+        // report carries every channel again instead of losing this edge.
+        clearChannelState();
+    }
+}
+
+void JFPlate::clearChannelState()
+{
+    m_diBits.clear();
+    m_doBits.clear();
+    m_analogFilters.clear();
+}
+
 void JFPlate::plateLogin(const QByteArray& randomCode)
 {
     if (randomCode.size() != 16) {
@@ -292,5 +567,189 @@ bool JFPlate::sendPacketToHardware(const QByteArray& packet)
         return false;
     }
 
+    m_bytesOut.fetch_add(static_cast<quint64>(written), std::memory_order_relaxed);
     return true;
 }
+
+void JFPlate::setLinkOptions(const LinkOptions& options)
+{
+    m_linkOptions = options;
+    m_linkOptions.windowDepth = qMax(1, options.windowDepth);
+    m_linkOptions.commandTimeoutMs = qMax(10, options.commandTimeoutMs);
+    m_linkOptions.maxRetransmits = qMax(0, options.maxRetransmits);
+    m_linkOptions.maxQueued = qMax(1, options.maxQueued);
+    m_linkOptions.doCoalesceMs = qMax(0, options.doCoalesceMs);
+}
+
+void JFPlate::setAnalogFilter(const AnalogFilter::Options& options)
+{
+    m_analogOptions = options;
+    m_analogFilters.clear();
+}
+
+JFPlate::CommandStats JFPlate::commandStats() const
+{
+    CommandStats stats;
+    stats.sent = m_cmdSent.load(std::memory_order_relaxed);
+    stats.acked = m_cmdAcked.load(std::memory_order_relaxed);
+    stats.retransmits = m_cmdRetransmits.load(std::memory_order_relaxed);
+    stats.timeouts = m_cmdTimeouts.load(std::memory_order_relaxed);
+    stats.dropped = m_cmdDropped.load(std::memory_order_relaxed);
+    stats.stray = m_cmdStray.load(std::memory_order_relaxed);
+    stats.rttMinUs = m_rttMinUs.load(std::memory_order_relaxed);
+    stats.rttMaxUs = m_rttMaxUs.load(std::memory_order_relaxed);
+    const quint64 samples = m_rttSamples.load(std::memory_order_relaxed);
+    stats.rttAvgUs = samples > 0 ? m_rttTotalUs.load(std::memory_order_relaxed) / static_cast<qint64>(samples) : 0;
+    stats.inFlight = m_inFlightCount.load(std::memory_order_relaxed);
+    stats.queued = m_queuedCount.load(std::memory_order_relaxed);
+    stats.doWrites = m_doWrites.load(std::memory_order_relaxed);
+    stats.doFrames = m_doFrames.load(std::memory_order_relaxed);
+    stats.doDropped = m_doDropped.load(std::memory_order_relaxed);
+    stats.doRttP50Us = m_doRtt.percentileUs(50);
+    stats.doRttP99Us = m_doRtt.percentileUs(99);
+    stats.comRttP50Us = m_comRtt.percentileUs(50);
+    stats.comRttP99Us = m_comRtt.percentileUs(99);
+    stats.bytesOut = m_bytesOut.load(std::memory_order_relaxed);
+    return stats;
+}
+
+int JFPlate::nextSerial()
+{
+    ++m_msgSerial;
+    if (m_msgSerial >= 9999) {
+        m_msgSerial = 1;
+    }
+    return m_msgSerial;
+}
+
+void JFPlate::submitCommand(JFPlateFlag cmd, quint16 serial, const QByteArray& packet)
+{
+    if (packet.isEmpty()) {
+        // encode() refuses payloads longer than one length byte
+        m_cmdDropped.fetch_add(1, std::memory_order_relaxed);
+        Logger::instance().warning(QString("JFPlate %1 command 0x%2 not sent: payload too long")
+                                       .arg(m_controlId)
+                                       .arg(static_cast<int>(cmd), 2, 16, QChar('0')));
+        return;
+    }
+
+    if (m_outbox.size() >= m_linkOptions.maxQueued) {
+        m_outbox.dequeue();
+        m_cmdDropped.fetch_add(1, std::memory_order_relaxed);
+        Logger::instance().warning(QString("JFPlate %1 command queue full (%2), oldest command dropped")
+                                       .arg(m_controlId)
+                                       .arg(m_linkOptions.maxQueued));
+    }
+
+    PendingCommand command;
+    command.cmd = cmd;
+    command.serial = serial;
+    command.packet = packet;
+    m_outbox.enqueue(command);
+    pumpCommands();
+}
+
+void JFPlate::pumpCommands()
+{
+    while (m_inFlight.size() < m_linkOptions.windowDepth && !m_outbox.isEmpty()) {
+        PendingCommand command = m_outbox.dequeue();
+        if (!sendPacketToHardware(command.packet)) {
+            m_cmdDropped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        command.sentNs = PipelineClock::nowNs();
+        m_cmdSent.fetch_add(1, std::memory_order_relaxed);
+        m_inFlight.append(command);
+    }
+
+    m_inFlightCount.store(m_inFlight.size(), std::memory_order_relaxed);
+    m_queuedCount.store(m_outbox.size(), std::memory_order_relaxed);
+    if (m_commandTimer) {
+        if (m_inFlight.isEmpty()) {
+            m_commandTimer->stop();
+        } else if (!m_commandTimer->isActive()) {
+            m_commandTimer->start();
+        }
+    }
+}
+
+void JFPlate::completeCommand(JFPlateFlag request, quint16 serial)
+{
+    // master frames echo the serial; slave (setCom) replies are answered in order
+    int index = -1;
+    for (int i = 0; i < m_inFlight.size(); ++i) {
+        const PendingCommand& command = m_inFlight[i];
+        if (command.cmd == request && (request == JFPlateFlag::setCom || command.serial == serial)) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        m_cmdStray.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const PendingCommand command = m_inFlight.takeAt(index);
+    m_cmdAcked.fetch_add(1, std::memory_order_relaxed);
+
+    // a reply to a retransmitted command cannot be attributed to one send
+    if (command.retransmits == 0) {
+        const qint64 rttUs = (PipelineClock::nowNs() - command.sentNs) / 1000;
+        const quint64 samples = m_rttSamples.fetch_add(1, std::memory_order_relaxed);
+        m_rttTotalUs.fetch_add(rttUs, std::memory_order_relaxed);
+        if (samples == 0 || rttUs < m_rttMinUs.load(std::memory_order_relaxed)) {
+            m_rttMinUs.store(rttUs, std::memory_order_relaxed);
+        }
+        if (rttUs > m_rttMaxUs.load(std::memory_order_relaxed)) {
+            m_rttMaxUs.store(rttUs, std::memory_order_relaxed);
+        }
+        (request == JFPlateFlag::setCom ? m_comRtt : m_doRtt).record(rttUs);
+    }
+
+    pumpCommands();
+}
+
+void JFPlate::checkCommandTimeouts()
+{
+    const qint64 now = PipelineClock::nowNs();
+    const qint64 timeoutNs = static_cast<qint64>(m_linkOptions.commandTimeoutMs) * 1000000;
+
+    for (int i = m_inFlight.size() - 1; i >= 0; --i) {
+        PendingCommand& command = m_inFlight[i];
+        if (now - command.sentNs < timeoutNs) {
+            continue;
+        }
+
+        if (command.retransmits < m_linkOptions.maxRetransmits && sendPacketToHardware(command.packet)) {
+            ++command.retransmits;
+            command.sentNs = now;
+            m_cmdRetransmits.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        Logger::instance().warning(QString("JFPlate %1 command 0x%2 serial %3 unanswered after %4 retransmits")
+                                       .arg(m_controlId)
+                                       .arg(static_cast<int>(command.cmd), 2, 16, QChar('0'))
+                                       .arg(command.serial)
+                                       .arg(command.retransmits));
+        m_cmdTimeouts.fetch_add(1, std::memory_order_relaxed);
+        m_inFlight.removeAt(i);
+    }
+
+    pumpCommands();
+}
+
+void JFPlate::abortCommands()
+{
+    const int aborted = m_inFlight.size() + m_outbox.size();
+    if (aborted > 0) {
+        m_cmdDropped.fetch_add(static_cast<quint64>(aborted), std::memory_order_relaxed);
+    }
+    m_inFlight.clear();
+    m_outbox.clear();
+    m_inFlightCount.store(0, std::memory_order_relaxed);
+    m_queuedCount.store(0, std::memory_order_relaxed);
+    if (m_commandTimer) {
+        m_commandTimer->stop();
+    }
+}
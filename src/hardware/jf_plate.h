@@ -3,10 +3,20 @@
 #include <QObject>
 #include <QByteArray>
 #include <QList>
+#include <QQueue>
+#include <QHash>
+#include <QVector>
 #include <QTcpSocket>
 #include <QHostAddress>
+#include <array>
+#include <bitset>
+#include <atomic>
+#include "jf_frame.h"
+#include "analog_filter.h"
+#include "core/pipeline_stats.h"
+#include "database/data_structures.h"
 
-struct JFHardControl;
+class QTimer;
 
 class JFPlate : public QObject
 {
@@ -35,6 +45,60 @@ public:
         getSetCom          = 0x98
     };
 
+    /**
+     * @brief Command pipelining limits, see setLinkOptions()
+     */
+    struct LinkOptions {
+        int windowDepth = 4;            // commands awaiting their reply
+        int commandTimeoutMs = 500;     // per transmission
+        int maxRetransmits = 2;         // then the command is given up
+        int maxQueued = 256;            // waiting for window space
+        int reconnectBaseMs = 1000;     // first backoff, doubled per failed attempt
+        int reconnectMaxMs = 60000;
+        int connectTimeoutMs = 10000;   // connect + login must finish within this
+        int doCoalesceMs = 0;           // DO writes batched per frame, 0 = end of event-loop tick
+    };
+
+    /**
+     * @brief Connection life cycle, see linkState()
+     *
+     * Idle -> WaitingSlot -> Connecting -> Authenticating -> Ready; any
+     * failure goes to Backoff and from there back to WaitingSlot.
+     */
+    enum class LinkState : int {
+        Idle,
+        WaitingSlot,        // waiting for a fleet-wide connect slot
+        Connecting,
+        Authenticating,
+        Ready,
+        Backoff
+    };
+
+    /**
+     * @brief Snapshot of the command window counters
+     */
+    struct CommandStats {
+        quint64 sent = 0;
+        quint64 acked = 0;
+        quint64 retransmits = 0;
+        quint64 timeouts = 0;       // given up after maxRetransmits
+        quint64 dropped = 0;        // outbox overflow or link lost
+        quint64 stray = 0;          // replies matching nothing in flight
+        qint64 rttMinUs = 0;
+        qint64 rttMaxUs = 0;
+        qint64 rttAvgUs = 0;
+        int inFlight = 0;
+        int queued = 0;
+        quint64 doWrites = 0;       // setEachDO() module writes
+        quint64 doFrames = 0;       // setDO frames they were merged into
+        quint64 doDropped = 0;      // module writes discarded because the link was down
+        qint64 doRttP50Us = 0;      // setDO -> getSetDO, first transmissions only
+        qint64 doRttP99Us = 0;
+        qint64 comRttP50Us = 0;     // setCom -> getSetCom
+        qint64 comRttP99Us = 0;
+        quint64 bytesOut = 0;
+    };
+
     explicit JFPlate(const JFHardControl& control, QObject* parent = nullptr);
     explicit JFPlate(QObject* parent = nullptr);
     ~JFPlate() override;
@@ -42,7 +106,90 @@ public:
     bool initialize();
     void cleanup();
 
-    bool setEachDO(bool isSend, int high, int low);
+    /**
+     * @brief Board id (JFHardControl::pk_id) this session belongs to
+     */
+    int controlId() const { return m_controlId; }
+
+    /**
+     * @brief "ip:port" of the board
+     */
+    QString endpoint() const { return QString("%1:%2").arg(m_ip.toString()).arg(m_port); }
+
+    /**
+     * @brief True once the board accepted our password (thread-safe)
+     */
+    bool isReady() const { return m_ready.load(std::memory_order_acquire); }
+
+    LinkState linkState() const { return static_cast<LinkState>(m_linkState.load(std::memory_order_relaxed)); }
+
+    /**
+     * @brief Times an authenticated link was lost
+     */
+    quint64 reconnects() const { return m_reconnects.load(std::memory_order_relaxed); }
+
+    static QString linkStateName(LinkState state);
+
+    /**
+     * @brief Channel changes decoded from board reports (thread-safe)
+     */
+    quint64 channelChanges() const { return m_channelChanges.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief When the last DI report (polled or event) arrived, PipelineClock ns, 0 if none
+     */
+    qint64 lastInputReportNs() const { return m_lastInputReportNs.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief DI reports that changed at least one channel
+     */
+    quint64 inputChangeReports() const { return m_inputChangeReports.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Ask the board for its DI state (setGetDI); no-op unless ready
+     */
+    void pollInputs();
+
+    /**
+     * @brief Receive-side frame counters (thread-safe)
+     */
+    const JFFrameDecoder& decoder() const { return m_decoder; }
+
+    /**
+     * @brief Set before initialize()
+     */
+    void setLinkOptions(const LinkOptions& options);
+
+    /**
+     * @brief Smoothing and deadband for MoNi channels, set before initialize()
+     */
+    void setAnalogFilter(const AnalogFilter::Options& options);
+
+    /**
+     * @brief Command window counters (thread-safe)
+     */
+    CommandStats commandStats() const;
+
+    /**
+     * @brief Stage the output state of one DO module; staged modules go out as one setDO frame
+     *
+     * Modules are addressed as in the board's getDO reports: hard addr, then
+     * bits 15..8 and 7..0 (one bit per tport). This setDO layout is not yet
+     * confirmed against the board spec, so MetaManage only calls it with
+     * [HardIO] ForwardDO=1. A later write to the same
+     * module replaces the earlier one. The frame is sent when the event loop
+     * finishes the current batch of events (or after LinkOptions::doCoalesceMs).
+     * Writes are refused while the link is down and staged ones are discarded
+     * when it drops, so a reconnect never actuates outputs set before an outage.
+     * @return false if the write was not staged
+     */
+    bool setEachDO(int hardAddr, quint16 bits);
+
+    /**
+     * @brief Send staged DO writes now
+     */
+    void flushDO();
+
     bool setSlaveEachDO(bool isSend, int high, int low);
 
     static QByteArray createSendMsg(JFPlateFlag cmd, int msgSerial, const QByteArray& data);
@@ -53,25 +200,116 @@ private slots:
     void onDisconnected();
     void onReadyRead();
     void onSocketError(QAbstractSocket::SocketError error);
+    void startConnect();
+    void onConnectTimeout();
 
 private:
-    void handlePlatePacket(const QByteArray& msg);
-    void handleCommand(JFPlateFlag cmd, const QByteArray& data);
+    void handlePlatePacket(const JFFrameView& frame);
+    void handleCommand(JFPlateFlag cmd, quint16 serial, const QByteArray& data);
+
+    /**
+     * @brief getDI / getDO / getEventUp: (hard addr, bits 15..8, bits 7..0) per module
+     */
+    void decodeBitReport(ChannelChange::Kind kind, const QByteArray& data);
+
+    /**
+     * @brief getMoNiDI / getMoNiBH / getMoNiDIHF: hard addr then 16 big-endian 16-bit values per module
+     *
+     * Values go through the module's AnalogFilter; only channels that moved
+     * past the deadband are published.
+     */
+    void decodeAnalogReport(const QByteArray& data);
+
+    void publishChanges(QVector<ChannelChange>& changes);
+    void clearChannelState();
+    void discardStagedDO();
     void plateLogin(const QByteArray& randomCode);
     bool sendPacketToHardware(const QByteArray& packet);
 
+    /**
+     * @brief A command that is acknowledged by a reply frame
+     */
+    struct PendingCommand {
+        JFPlateFlag cmd = JFPlateFlag::setDO;
+        quint16 serial = 0;         // slave frames carry none, matched in order
+        QByteArray packet;
+        qint64 sentNs = 0;
+        int retransmits = 0;
+    };
+
+    int nextSerial();
+    void submitCommand(JFPlateFlag cmd, quint16 serial, const QByteArray& packet);
+    void pumpCommands();
+    void completeCommand(JFPlateFlag request, quint16 serial);
+    void checkCommandTimeouts();
+    void abortCommands();
+
+    void setLinkState(LinkState state);
+    void linkReady();
+    void linkDown(const QString& reason);
+    void releaseConnectSlot();
+
 private:
     QTcpSocket* m_socket = nullptr;
+    int m_controlId = 0;
     QHostAddress m_ip;
     quint16 m_port = 0;
     QString m_password = "1234567890abcdef";
 
     bool m_initialized = false;
-    bool m_canSend = true;
-    bool m_scanSend = true;
+    std::atomic<bool> m_ready{false};
     int m_msgSerial = 1125;
 
-    QList<quint8> m_waitSendList;
+    LinkOptions m_linkOptions;
+    QTimer* m_reconnectTimer = nullptr;
+    QTimer* m_connectTimer = nullptr;
+    bool m_holdingSlot = false;
+    int m_failedAttempts = 0;
+    qint64 m_downSinceNs = 0;       // start of the current outage, 0 while ready
+    std::atomic<int> m_linkState{static_cast<int>(LinkState::Idle)};
+    std::atomic<quint64> m_reconnects{0};
+
+    QTimer* m_commandTimer = nullptr;
+    QList<PendingCommand> m_inFlight;
+    QQueue<PendingCommand> m_outbox;
+
+    // command counters, written on the I/O thread only
+    std::atomic<quint64> m_cmdSent{0};
+    std::atomic<quint64> m_cmdAcked{0};
+    std::atomic<quint64> m_cmdRetransmits{0};
+    std::atomic<quint64> m_cmdTimeouts{0};
+    std::atomic<quint64> m_cmdDropped{0};
+    std::atomic<quint64> m_cmdStray{0};
+    std::atomic<quint64> m_rttSamples{0};
+    std::atomic<qint64> m_rttTotalUs{0};
+    std::atomic<qint64> m_rttMinUs{0};
+    std::atomic<qint64> m_rttMaxUs{0};
+    std::atomic<int> m_inFlightCount{0};
+    std::atomic<int> m_queuedCount{0};
+    std::atomic<quint64> m_bytesOut{0};
+    LatencyHistogram m_doRtt;
+    LatencyHistogram m_comRtt;
+
+    // staged DO module states: bits per hard addr, addrs in first-write order
+    std::array<quint16, 256> m_doValues{};
+    std::array<quint8, 256> m_doOrder{};
+    std::bitset<256> m_doPending;
+    int m_doPendingCount = 0;
+    QTimer* m_doFlushTimer = nullptr;
+    std::atomic<quint64> m_doWrites{0};
+    std::atomic<quint64> m_doFrames{0};
+    std::atomic<quint64> m_doDropped{0};
+
     QList<quint8> m_waitSendList1;
-    QByteArray m_recvBuffer;
+    JFFrameDecoder m_decoder;
+
+    // last reported state per hard addr; cleared on link loss so the first
+    // report after a reconnect publishes every channel
+    QHash<int, quint16> m_diBits;
+    QHash<int, quint16> m_doBits;
+    QHash<int, AnalogFilter> m_analogFilters;
+    AnalogFilter::Options m_analogOptions;
+    std::atomic<quint64> m_channelChanges{0};
+    std::atomic<qint64> m_lastInputReportNs{0};
+    std::atomic<quint64> m_inputChangeReports{0};
 };
@@ -0,0 +1,525 @@
+#include "jf_plate_pool.h"
+#include "jf_plate.h"
+#include "core/global_data.h"
+#include "logging/logger.h"
+#include "core/pipeline_stats.h"
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+// traffic mode: how often per-thread receive load is compared
+constexpr int kRebalanceIntervalMs = 10000;
+// a gap smaller than this per interval is not worth moving a session for
+constexpr quint64 kMinRebalanceGapBytes = 64 * 1024;
+}
+
+JFPlatePool& JFPlatePool::instance()
+{
+    static JFPlatePool s_instance;
+    return s_instance;
+}
+
+JFPlatePool::~JFPlatePool()
+{
+    cleanup();
+}
+
+bool JFPlatePool::initialize(const QMap<int, JFHardControl>& controls)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_ioThreads.isEmpty()) {
+        return true;
+    }
+
+    const int wanted = m_requestedThreads > 0 ? m_requestedThreads : QThread::idealThreadCount();
+    const int threadCount = qBound(1, wanted, qMax(1, controls.size()));
+    for (int i = 0; i < threadCount; ++i) {
+        QThread* thread = new QThread();
+        thread->setObjectName(QString("JFPlateIO-%1").arg(i));
+        thread->start();
+        m_ioThreads.append(thread);
+    }
+
+    QMap<int, JFPlate*>& plateDict = GlobalData::instance().getJFPlateDict();
+    plateDict.clear();
+    {
+        QMutexLocker readyLocker(&m_readyMutex);
+        m_startedNs = PipelineClock::nowNs();
+        m_fleetReadyMs = -1;
+        m_everReady.clear();
+    }
+
+    // count first, so early logins cannot declare the fleet ready
+    m_sessionCount.store(controls.size());
+    for (auto it = controls.constBegin(); it != controls.constEnd(); ++it) {
+        createSessionLocked(it.value());
+    }
+    m_sessionCount.store(plateDict.size());
+
+    if (m_balanceByTraffic && m_ioThreads.size() > 1) {
+        m_rebalanceTimer = new QTimer();
+        m_rebalanceTimer->setInterval(kRebalanceIntervalMs);
+        m_rebalanceTimer->moveToThread(m_ioThreads[0]);
+        QObject::connect(m_rebalanceTimer, &QTimer::timeout, m_rebalanceTimer, [this] { rebalance(); });
+        QTimer* timer = m_rebalanceTimer;
+        QMetaObject::invokeMethod(timer, [timer] { timer->start(); }, Qt::QueuedConnection);
+    }
+
+    Logger::instance().info(QString("JFPlate pool started: %1 sessions for %2 controllers on %3 I/O threads (%4)")
+                                .arg(plateDict.size())
+                                .arg(controls.size())
+                                .arg(m_ioThreads.size())
+                                .arg(m_balanceByTraffic ? "traffic" : "count"));
+    return true;
+}
+
+void JFPlatePool::setLinkOptions(const JFPlate::LinkOptions& options)
+{
+    QMutexLocker locker(&m_mutex);
+    m_linkOptions = options;
+}
+
+void JFPlatePool::setAnalogFilter(const AnalogFilter::Options& options)
+{
+    QMutexLocker locker(&m_mutex);
+    m_analogOptions = options;
+}
+
+void JFPlatePool::setIoThreads(int threads, const QString& balance)
+{
+    QMutexLocker locker(&m_mutex);
+    m_requestedThreads = qMax(0, threads);
+    m_balanceByTraffic = balance.compare("traffic", Qt::CaseInsensitive) == 0;
+}
+
+void JFPlatePool::setConnectLimit(int limit)
+{
+    // only before initialize(): resizing while slots are held would lose them
+    const int wanted = qMax(1, limit);
+    const int current = m_connectLimit.exchange(wanted);
+    if (wanted > current) {
+        m_connectSlots.release(wanted - current);
+    } else if (wanted < current) {
+        m_connectSlots.acquire(current - wanted);
+    }
+}
+
+bool JFPlatePool::tryAcquireConnectSlot()
+{
+    return m_connectSlots.tryAcquire();
+}
+
+void JFPlatePool::releaseConnectSlot()
+{
+    m_connectSlots.release();
+}
+
+void JFPlatePool::recordTimeToReady(int controlId, qint64 timeToReadyMs, int failedAttempts)
+{
+    bool fleetReady = false;
+    qint64 fleetMs = 0;
+    {
+        QMutexLocker locker(&m_readyMutex);
+        ++m_readyCount;
+        m_readyTotalMs += timeToReadyMs;
+        m_readyMaxMs = qMax(m_readyMaxMs, timeToReadyMs);
+        m_readyRetries += static_cast<quint64>(failedAttempts);
+        m_everReady.insert(controlId);
+        if (m_fleetReadyMs < 0 && m_everReady.size() >= m_sessionCount.load()) {
+            m_fleetReadyMs = (PipelineClock::nowNs() - m_startedNs) / 1000000;
+            fleetReady = true;
+            fleetMs = m_fleetReadyMs;
+        }
+    }
+
+    if (fleetReady) {
+        Logger::instance().info(QString("All %1 JFPlate sessions ready %2 ms after start")
+                                    .arg(m_sessionCount.load())
+                                    .arg(fleetMs));
+    }
+}
+
+QString JFPlatePool::linkSummary() const
+{
+    QVector<int> states(static_cast<int>(JFPlate::LinkState::Backoff) + 1, 0);
+    quint64 reconnects = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const JFPlate* plate : GlobalData::instance().getJFPlateDict()) {
+            ++states[static_cast<int>(plate->linkState())];
+            reconnects += plate->reconnects();
+        }
+    }
+
+    QStringList counts;
+    for (int i = 0; i < states.size(); ++i) {
+        if (states[i] > 0) {
+            counts << QString("%1=%2").arg(JFPlate::linkStateName(static_cast<JFPlate::LinkState>(i))).arg(states[i]);
+        }
+    }
+
+    QMutexLocker locker(&m_readyMutex);
+    return QString("jfplate links: %1 reconnects=%2 timeToReady n=%3 avg=%4ms max=%5ms retries=%6 fleetReady=%7")
+        .arg(counts.isEmpty() ? QString("none") : counts.join(' '))
+        .arg(reconnects)
+        .arg(m_readyCount)
+        .arg(m_readyCount > 0 ? m_readyTotalMs / static_cast<qint64>(m_readyCount) : 0)
+        .arg(m_readyMaxMs)
+        .arg(m_readyRetries)
+        .arg(m_fleetReadyMs >= 0 ? QString("%1ms").arg(m_fleetReadyMs) : QString("pending"));
+}
+
+void JFPlatePool::cleanup()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_ioThreads.isEmpty()) {
+        return;
+    }
+
+    QMap<int, JFPlate*>& plateDict = GlobalData::instance().getJFPlateDict();
+    const QList<JFPlate*> plates = plateDict.values();
+    plateDict.clear();
+    m_sessionThread.clear();
+    m_lastBytesIn.clear();
+    m_recentBytesIn.clear();
+    m_sessionCount.store(0);
+    const QVector<QThread*> threads = m_ioThreads;
+    m_ioThreads.clear();
+    QTimer* rebalanceTimer = m_rebalanceTimer;
+    m_rebalanceTimer = nullptr;
+    locker.unlock();
+
+    if (rebalanceTimer) {
+        QMetaObject::invokeMethod(rebalanceTimer, [rebalanceTimer] { delete rebalanceTimer; },
+                                  Qt::BlockingQueuedConnection);
+    }
+    for (JFPlate* plate : plates) {
+        destroySession(plate);
+    }
+    for (QThread* thread : threads) {
+        thread->quit();
+    }
+    for (QThread* thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+}
+
+bool JFPlatePool::addSession(const JFHardControl& control)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_ioThreads.isEmpty()) {
+        return false;
+    }
+
+    QMap<int, JFPlate*>& plateDict = GlobalData::instance().getJFPlateDict();
+    JFPlate* old = plateDict.take(control.pk_id);
+    if (old) {
+        m_sessionThread.remove(control.pk_id);
+    }
+    const bool created = createSessionLocked(control) != nullptr;
+    m_sessionCount.store(plateDict.size());
+    locker.unlock();
+
+    if (old) {
+        destroySession(old);
+    }
+    return created;
+}
+
+void JFPlatePool::removeSession(int controlId)
+{
+    QMutexLocker locker(&m_mutex);
+    JFPlate* plate = GlobalData::instance().getJFPlateDict().take(controlId);
+    if (!plate) {
+        return;
+    }
+    m_sessionThread.remove(controlId);
+    m_sessionCount.store(GlobalData::instance().getJFPlateDict().size());
+    locker.unlock();
+
+    destroySession(plate);
+    Logger::instance().info(QString("JFPlate session %1 removed").arg(controlId));
+}
+
+bool JFPlatePool::post(int controlId, std::function<void(JFPlate&)> fn, bool requireReady)
+{
+    QMutexLocker locker(&m_mutex);
+    JFPlate* plate = GlobalData::instance().getJFPlateDict().value(controlId, nullptr);
+    if (!plate || (requireReady && !plate->isReady())) {
+        return false;
+    }
+
+    return QMetaObject::invokeMethod(plate, [plate, fn = std::move(fn)] { fn(*plate); }, Qt::QueuedConnection);
+}
+
+int JFPlatePool::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return GlobalData::instance().getJFPlateDict().size();
+}
+
+int JFPlatePool::readyCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    int ready = 0;
+    for (const JFPlate* plate : GlobalData::instance().getJFPlateDict()) {
+        if (plate->isReady()) {
+            ++ready;
+        }
+    }
+    return ready;
+}
+
+QList<int> JFPlatePool::sessionIds() const
+{
+    QMutexLocker locker(&m_mutex);
+    return GlobalData::instance().getJFPlateDict().keys();
+}
+
+bool JFPlatePool::inputActivity(int controlId, qint64& lastReportNs, quint64& changeReports) const
+{
+    QMutexLocker locker(&m_mutex);
+    const JFPlate* plate = GlobalData::instance().getJFPlateDict().value(controlId, nullptr);
+    if (!plate) {
+        return false;
+    }
+    lastReportNs = plate->lastInputReportNs();
+    changeReports = plate->inputChangeReports();
+    return true;
+}
+
+JFPlate* JFPlatePool::createSessionLocked(const JFHardControl& control)
+{
+    if (control.ip_addr.isEmpty() || control.ip_port <= 0) {
+        Logger::instance().warning(QString("JFPlate %1 has no address, session not created").arg(control.pk_id));
+        return nullptr;
+    }
+
+    const int threadIndex = pickThreadLocked();
+    JFPlate* plate = new JFPlate(control);
+    plate->setLinkOptions(m_linkOptions);
+    plate->setAnalogFilter(m_analogOptions);
+    plate->moveToThread(m_ioThreads[threadIndex]);
+    QMetaObject::invokeMethod(plate, [plate] { plate->initialize(); }, Qt::QueuedConnection);
+    GlobalData::instance().getJFPlateDict()[control.pk_id] = plate;
+    m_sessionThread.insert(control.pk_id, threadIndex);
+    return plate;
+}
+
+int JFPlatePool::pickThreadLocked() const
+{
+    QVector<quint64> load(m_ioThreads.size(), 0);
+    const QMap<int, JFPlate*>& plateDict = GlobalData::instance().getJFPlateDict();
+    for (auto it = m_sessionThread.constBegin(); it != m_sessionThread.constEnd(); ++it) {
+        const JFPlate* plate = plateDict.value(it.key(), nullptr);
+        if (!plate) {
+            continue;
+        }
+        // traffic mode still counts each board once so idle boards spread too
+        load[it.value()] += m_balanceByTraffic ? m_recentBytesIn.value(it.key(), 0) + 1 : 1;
+    }
+
+    int best = 0;
+    for (int i = 1; i < load.size(); ++i) {
+        if (load[i] < load[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void JFPlatePool::rebalance()
+{
+    JFPlate* plate = nullptr;
+    int controlId = 0;
+    QString fromName;
+    QString toName;
+    quint64 moved = 0;
+    quint64 gap = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_ioThreads.size() < 2) {
+            return;
+        }
+
+        QVector<quint64> load(m_ioThreads.size(), 0);
+        QHash<int, quint64> lastBytesIn;
+        QHash<int, quint64> recentBytesIn;
+        const QMap<int, JFPlate*>& plateDict = GlobalData::instance().getJFPlateDict();
+        for (auto it = m_sessionThread.constBegin(); it != m_sessionThread.constEnd(); ++it) {
+            const JFPlate* session = plateDict.value(it.key(), nullptr);
+            if (!session) {
+                continue;
+            }
+            const quint64 bytesIn = session->decoder().bytesIn();
+            const quint64 last = m_lastBytesIn.value(it.key(), bytesIn);
+            // a replaced session starts counting from zero again
+            const quint64 recent = bytesIn >= last ? bytesIn - last : bytesIn;
+            lastBytesIn.insert(it.key(), bytesIn);
+            recentBytesIn.insert(it.key(), recent);
+            load[it.value()] += recent;
+        }
+        m_lastBytesIn = lastBytesIn;
+        m_recentBytesIn = recentBytesIn;
+
+        const int from = static_cast<int>(std::max_element(load.begin(), load.end()) - load.begin());
+        const int to = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+        gap = load[from] - load[to];
+        if (gap < kMinRebalanceGapBytes) {
+            return;
+        }
+
+        // the session closest to half the gap evens the two threads out best;
+        // anything carrying the whole gap or more would only swap them
+        quint64 bestDistance = 0;
+        for (auto it = m_sessionThread.constBegin(); it != m_sessionThread.constEnd(); ++it) {
+            const quint64 recent = recentBytesIn.value(it.key(), 0);
+            if (it.value() != from || recent == 0 || recent >= gap) {
+                continue;
+            }
+            JFPlate* session = plateDict.value(it.key(), nullptr);
+            const JFPlate::CommandStats stats = session->commandStats();
+            if (stats.inFlight > 0 || stats.queued > 0) {
+                continue;
+            }
+            const quint64 distance = recent > gap / 2 ? recent - gap / 2 : gap / 2 - recent;
+            if (!plate || distance < bestDistance) {
+                plate = session;
+                controlId = it.key();
+                moved = recent;
+                bestDistance = distance;
+            }
+        }
+        if (!plate) {
+            return;
+        }
+        fromName = m_ioThreads[from]->objectName();
+        toName = m_ioThreads[to]->objectName();
+        m_sessionThread.insert(controlId, to);
+
+        // only the owning thread may move the session; events already queued
+        // for it follow along. Queued under the lock, like post(), so the
+        // session cannot be destroyed in between.
+        QThread* target = m_ioThreads[to];
+        QMetaObject::invokeMethod(plate, [plate, target] { plate->moveToThread(target); }, Qt::QueuedConnection);
+    }
+
+    Logger::instance().info(QString("JFPlate %1 moved from %2 to %3 (%4 bytes of a %5 byte gap in %6 ms)")
+                                .arg(controlId)
+                                .arg(fromName)
+                                .arg(toName)
+                                .arg(moved)
+                                .arg(gap)
+                                .arg(kRebalanceIntervalMs));
+}
+
+QStringList JFPlatePool::ioReport() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<int> boards(m_ioThreads.size(), 0);
+    QVector<int> ready(m_ioThreads.size(), 0);
+    QVector<quint64> bytesIn(m_ioThreads.size(), 0);
+
+    const QMap<int, JFPlate*>& plateDict = GlobalData::instance().getJFPlateDict();
+    for (auto it = m_sessionThread.constBegin(); it != m_sessionThread.constEnd(); ++it) {
+        const JFPlate* plate = plateDict.value(it.key(), nullptr);
+        if (!plate) {
+            continue;
+        }
+        ++boards[it.value()];
+        ready[it.value()] += plate->isReady() ? 1 : 0;
+        bytesIn[it.value()] += plate->decoder().bytesIn();
+    }
+
+    QStringList lines;
+    for (int i = 0; i < m_ioThreads.size(); ++i) {
+        lines << QString("%1: boards=%2 ready=%3 bytesIn=%4")
+                     .arg(m_ioThreads[i]->objectName())
+                     .arg(boards[i])
+                     .arg(ready[i])
+                     .arg(bytesIn[i]);
+    }
+    return lines;
+}
+
+QStringList JFPlatePool::boardReport(int limit) const
+{
+    struct BoardRow {
+        int controlId = 0;
+        QString endpoint;
+        QString state;
+        JFPlate::CommandStats stats;
+        quint64 reconnects = 0;
+        quint64 bytesIn = 0;
+        quint64 malformed = 0;
+        qint64 worstP99Us = 0;
+    };
+
+    QVector<BoardRow> rows;
+    {
+        QMutexLocker locker(&m_mutex);
+        const QMap<int, JFPlate*>& plateDict = GlobalData::instance().getJFPlateDict();
+        rows.reserve(plateDict.size());
+        for (auto it = plateDict.constBegin(); it != plateDict.constEnd(); ++it) {
+            const JFPlate* plate = it.value();
+            BoardRow row;
+            row.controlId = it.key();
+            row.endpoint = plate->endpoint();
+            row.state = JFPlate::linkStateName(plate->linkState());
+            row.stats = plate->commandStats();
+            row.reconnects = plate->reconnects();
+            row.bytesIn = plate->decoder().bytesIn();
+            row.malformed = plate->decoder().malformed();
+            row.worstP99Us = qMax(row.stats.doRttP99Us, row.stats.comRttP99Us);
+            rows.append(row);
+        }
+    }
+
+    std::sort(rows.begin(), rows.end(), [](const BoardRow& a, const BoardRow& b) {
+        if (a.worstP99Us != b.worstP99Us) {
+            return a.worstP99Us > b.worstP99Us;
+        }
+        if (a.stats.timeouts != b.stats.timeouts) {
+            return a.stats.timeouts > b.stats.timeouts;
+        }
+        return a.reconnects > b.reconnects;
+    });
+
+    QStringList lines;
+    lines << QString("boards: %1 (slowest first, rtt percentiles are power-of-two upper bounds)").arg(rows.size());
+    const int shown = limit > 0 ? qMin(limit, rows.size()) : rows.size();
+    for (int i = 0; i < shown; ++i) {
+        const BoardRow& row = rows[i];
+        lines << QString("  %1 %2 %3: setDO p50/p99=%4/%5us setCom p50/p99=%6/%7us max=%8us "
+                         "acked=%9 retx=%10 timeouts=%11 reconnects=%12 in/out=%13/%14B malformed=%15 "
+                         "window=%16 queued=%17")
+                     .arg(row.controlId)
+                     .arg(row.endpoint)
+                     .arg(row.state)
+                     .arg(row.stats.doRttP50Us)
+                     .arg(row.stats.doRttP99Us)
+                     .arg(row.stats.comRttP50Us)
+                     .arg(row.stats.comRttP99Us)
+                     .arg(row.stats.rttMaxUs)
+                     .arg(row.stats.acked)
+                     .arg(row.stats.retransmits)
+                     .arg(row.stats.timeouts)
+                     .arg(row.reconnects)
+                     .arg(row.bytesIn)
+                     .arg(row.stats.bytesOut)
+                     .arg(row.malformed)
+                     .arg(row.stats.inFlight)
+                     .arg(row.stats.queued);
+    }
+    return lines;
+}
+
+void JFPlatePool::destroySession(JFPlate* plate)
+{
+    // Called without m_mutex: the delete waits for the session's thread, and
+    // whatever that thread is busy with must not be stuck behind the pool lock.
+    // Destroy on the owning thread so the socket is torn down there.
+    QMetaObject::invokeMethod(plate, [plate] { delete plate; }, Qt::BlockingQueuedConnection);
+}
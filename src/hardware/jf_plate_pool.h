@@ -0,0 +1,174 @@
+#ifndef JF_PLATE_POOL_H
+#define JF_PLATE_POOL_H
+
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QStringList>
+#include <QList>
+#include <QMutex>
+#include <QSemaphore>
+#include <atomic>
+#include <functional>
+#include "jf_plate.h"
+
+struct JFHardControl;
+class QThread;
+class QTimer;
+
+/**
+ * @brief Long-lived JFPlate sessions, one per JFHardControl
+ *
+ * Sessions are created once at startup and spread over a set of I/O
+ * threads, each with its own event loop (the main thread is blocked in the
+ * CLI loop and never dispatches socket events). New sessions go to the
+ * thread with the fewest boards or, in traffic mode, the least recent
+ * traffic. In count mode a session stays where it was placed; in traffic
+ * mode the pool compares bytes received per thread every few seconds and
+ * moves one quiet session from the busiest thread to the idlest. The
+ * sessions are published in GlobalData::getJFPlateDict() (guarded by the
+ * pool's mutex); callers on other threads must go through post() so every
+ * socket operation runs on the session's own thread.
+ */
+class JFPlatePool
+{
+public:
+    static JFPlatePool& instance();
+
+    /**
+     * @brief Create and connect one session per type 2/5 controller
+     */
+    bool initialize(const QMap<int, JFHardControl>& controls);
+
+    /**
+     * @brief Command window limits for sessions created from now on
+     */
+    void setLinkOptions(const JFPlate::LinkOptions& options);
+
+    /**
+     * @brief MoNi filtering for sessions created from now on
+     */
+    void setAnalogFilter(const AnalogFilter::Options& options);
+
+    /**
+     * @brief I/O thread count (0: one per core) and placement policy, before initialize()
+     * @param balance "count", or "traffic" to also move sessions between threads as load shifts
+     */
+    void setIoThreads(int threads, const QString& balance);
+
+    /**
+     * @brief Boards allowed to be connecting or logging in at the same time
+     */
+    void setConnectLimit(int limit);
+
+    /**
+     * @brief Non-blocking; every successful call must be matched by releaseConnectSlot()
+     */
+    bool tryAcquireConnectSlot();
+    void releaseConnectSlot();
+
+    /**
+     * @brief A session became ready, timeToReadyMs after it started (re)connecting
+     */
+    void recordTimeToReady(int controlId, qint64 timeToReadyMs, int failedAttempts);
+
+    /**
+     * @brief Sessions per link state and time-to-ready statistics
+     */
+    QString linkSummary() const;
+
+    /**
+     * @brief Disconnect and destroy all sessions, stop the I/O thread
+     */
+    void cleanup();
+
+    /**
+     * @brief Create a session for a controller added at runtime (hot reload)
+     */
+    bool addSession(const JFHardControl& control);
+
+    /**
+     * @brief Disconnect and destroy one session
+     */
+    void removeSession(int controlId);
+
+    /**
+     * @brief Queue a call on the session's I/O thread
+     * @param requireReady skip (and return false) if the board is not authenticated
+     * @return true if the call was queued
+     */
+    bool post(int controlId, std::function<void(JFPlate&)> fn, bool requireReady = true);
+
+    int size() const;
+    int readyCount() const;
+
+    QList<int> sessionIds() const;
+
+    /**
+     * @brief DI activity of one session, see JFPlate::lastInputReportNs()
+     * @return false if there is no such session
+     */
+    bool inputActivity(int controlId, qint64& lastReportNs, quint64& changeReports) const;
+
+    /**
+     * @brief One line per I/O thread: boards, ready, bytes received
+     */
+    QStringList ioReport() const;
+
+    /**
+     * @brief Per-board link quality, slowest boards first
+     *
+     * Ranked by command round-trip p99, then by commands given up and
+     * reconnects, so flaky units float to the top.
+     * @param limit boards listed, <= 0 for all
+     */
+    QStringList boardReport(int limit) const;
+
+private:
+    JFPlatePool() = default;
+    ~JFPlatePool();
+
+    JFPlatePool(const JFPlatePool&) = delete;
+    JFPlatePool& operator=(const JFPlatePool&) = delete;
+
+    JFPlate* createSessionLocked(const JFHardControl& control);
+    void destroySession(JFPlate* plate);
+    int pickThreadLocked() const;
+
+    /**
+     * @brief Traffic mode: move one session off the busiest I/O thread
+     *
+     * Runs on the first I/O thread. The move itself is queued on the
+     * session's own thread, since only the owning thread may call
+     * moveToThread(); sessions with commands in flight are left alone.
+     */
+    void rebalance();
+
+    QVector<QThread*> m_ioThreads;
+    QHash<int, int> m_sessionThread;    // controlId -> index into m_ioThreads
+    int m_requestedThreads = 0;
+    bool m_balanceByTraffic = false;
+    QTimer* m_rebalanceTimer = nullptr;     // lives on m_ioThreads[0]
+    QHash<int, quint64> m_lastBytesIn;      // controlId -> bytesIn at the last rebalance
+    QHash<int, quint64> m_recentBytesIn;    // controlId -> bytes received in the last interval
+    JFPlate::LinkOptions m_linkOptions;
+    AnalogFilter::Options m_analogOptions;
+    mutable QMutex m_mutex;
+
+    // connect throttle and time-to-ready, used by sessions on their own
+    // threads: never under m_mutex, sessions must not wait on the pool lock
+    QSemaphore m_connectSlots{16};
+    std::atomic<int> m_connectLimit{16};
+    qint64 m_startedNs = 0;
+    std::atomic<int> m_sessionCount{0};
+    mutable QMutex m_readyMutex;
+    QSet<int> m_everReady;
+    quint64 m_readyCount = 0;
+    qint64 m_readyTotalMs = 0;
+    qint64 m_readyMaxMs = 0;
+    quint64 m_readyRetries = 0;
+    qint64 m_fleetReadyMs = -1;     // initialize() until every session was ready once
+};
+
+#endif // JF_PLATE_POOL_H
@@ -0,0 +1,229 @@
+#include "jf_poll_scheduler.h"
+#include "jf_plate_pool.h"
+#include "jf_plate.h"
+#include "core/pipeline_stats.h"
+#include "logging/logger.h"
+#include <QThread>
+#include <QList>
+#include <QSet>
+
+namespace {
+// sessions added or removed by a reload are picked up this often
+constexpr qint64 kSyncIntervalNs = 1000LL * 1000 * 1000;
+// quiet polls in a row before a board is slowed down
+constexpr int kQuietPollsBeforeSlowdown = 4;
+}
+
+JFPollScheduler& JFPollScheduler::instance()
+{
+    static JFPollScheduler s_instance;
+    return s_instance;
+}
+
+JFPollScheduler::~JFPollScheduler()
+{
+    cleanup();
+}
+
+bool JFPollScheduler::initialize(int intervalMs, int minIntervalMs, int maxIntervalMs, bool adaptive)
+{
+    if (m_thread) {
+        return true;
+    }
+    if (intervalMs <= 0) {
+        Logger::instance().info("DI polling disabled (ReadInterval <= 0)");
+        return true;
+    }
+
+    m_intervalMs = intervalMs;
+    m_minIntervalMs = qBound(1, minIntervalMs, intervalMs);
+    m_maxIntervalMs = qMax(intervalMs, maxIntervalMs);
+    m_adaptive = adaptive;
+    m_stopping = false;
+
+    m_thread = QThread::create([this] { run(); });
+    m_thread->setObjectName("JFPollScheduler");
+    m_thread->start();
+
+    Logger::instance().info(QString("DI polling every %1 ms (%2..%3 ms, adaptive=%4)")
+                                .arg(m_intervalMs)
+                                .arg(m_minIntervalMs)
+                                .arg(m_maxIntervalMs)
+                                .arg(m_adaptive ? 1 : 0));
+    return true;
+}
+
+void JFPollScheduler::cleanup()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    Logger::instance().info("DI polling stopped: " + statsSummary());
+}
+
+QString JFPollScheduler::statsSummary() const
+{
+    int boards = 0;
+    int minInterval = 0;
+    int maxInterval = 0;
+    qint64 totalInterval = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        boards = m_boards.size();
+        for (const Board& board : m_boards) {
+            minInterval = minInterval == 0 ? board.intervalMs : qMin(minInterval, board.intervalMs);
+            maxInterval = qMax(maxInterval, board.intervalMs);
+            totalInterval += board.intervalMs;
+        }
+    }
+
+    const quint64 sent = m_sent.load(std::memory_order_relaxed);
+    return QString("polling: boards=%1 interval min/avg/max=%2/%3/%4ms sent=%5 skippedFresh=%6 notReady=%7 "
+                   "jitter avg=%8us max=%9us")
+        .arg(boards)
+        .arg(minInterval)
+        .arg(boards > 0 ? totalInterval / boards : 0)
+        .arg(maxInterval)
+        .arg(sent)
+        .arg(m_skippedFresh.load(std::memory_order_relaxed))
+        .arg(m_notQueued.load(std::memory_order_relaxed))
+        .arg(sent > 0 ? m_jitterTotalUs.load(std::memory_order_relaxed) / static_cast<qint64>(sent) : 0)
+        .arg(m_jitterMaxUs.load(std::memory_order_relaxed));
+}
+
+void JFPollScheduler::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopping) {
+        const qint64 now = PipelineClock::nowNs();
+        if (now - m_lastSyncNs >= kSyncIntervalNs) {
+            syncBoards(now);
+        }
+
+        // dispatch everything due, then sleep until the next due time
+        while (!m_heap.empty() && m_heap.top().dueNs <= PipelineClock::nowNs()) {
+            const Due due = m_heap.top();
+            m_heap.pop();
+            locker.unlock();
+            pollBoard(due.controlId, PipelineClock::nowNs());
+            locker.relock();
+            if (m_stopping) {
+                return;
+            }
+        }
+
+        qint64 waitNs = m_lastSyncNs + kSyncIntervalNs - PipelineClock::nowNs();
+        if (!m_heap.empty()) {
+            waitNs = qMin(waitNs, m_heap.top().dueNs - PipelineClock::nowNs());
+        }
+        if (waitNs > 0) {
+            // round up: waking early only to sleep again wastes a context switch
+            m_wake.wait(&m_mutex, static_cast<unsigned long>((waitNs + 999999) / 1000000));
+        }
+    }
+}
+
+void JFPollScheduler::syncBoards(qint64 nowNs)
+{
+    m_lastSyncNs = nowNs;
+    const QList<int> ids = JFPlatePool::instance().sessionIds();
+    QSet<int> live;
+    for (int id : ids) {
+        live.insert(id);
+    }
+
+    for (auto it = m_boards.begin(); it != m_boards.end();) {
+        it = live.contains(it.key()) ? std::next(it) : m_boards.erase(it);
+    }
+
+    // new boards: spread their first polls evenly over one base interval
+    QList<int> added;
+    for (int id : ids) {
+        if (!m_boards.contains(id)) {
+            added.append(id);
+        }
+    }
+    const qint64 intervalNs = static_cast<qint64>(m_intervalMs) * 1000000;
+    for (int i = 0; i < added.size(); ++i) {
+        Board board;
+        board.intervalMs = m_intervalMs;
+        board.dueNs = nowNs + intervalNs * i / added.size();
+        m_boards.insert(added[i], board);
+        m_heap.push(Due{board.dueNs, added[i]});
+    }
+}
+
+void JFPollScheduler::pollBoard(int controlId, qint64 nowNs)
+{
+    Board board;
+    {
+        QMutexLocker locker(&m_mutex);
+        const auto it = m_boards.constFind(controlId);
+        if (it == m_boards.constEnd() || it.value().dueNs > nowNs) {
+            return;     // removed, or a stale heap entry
+        }
+        board = it.value();
+    }
+
+    qint64 lastReportNs = 0;
+    quint64 changeReports = 0;
+    if (JFPlatePool::instance().inputActivity(controlId, lastReportNs, changeReports)) {
+        pollLive(controlId, nowNs, lastReportNs, changeReports, board);
+    }
+    // else: session gone, or being re-created by a hot reload under the same
+    // id. Keep the heap entry either way: the next sync drops the board if
+    // the session stays gone, and a re-created one is polled on time.
+
+    // relative to the previous due time, so the stagger does not drift;
+    // a board that fell far behind restarts from now instead of bursting
+    board.dueNs += static_cast<qint64>(board.intervalMs) * 1000000;
+    if (board.dueNs < nowNs) {
+        board.dueNs = nowNs + static_cast<qint64>(board.intervalMs) * 1000000;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_boards.find(controlId);
+    if (it != m_boards.end()) {
+        it.value() = board;
+        m_heap.push(Due{board.dueNs, controlId});
+    }
+}
+
+void JFPollScheduler::pollLive(int controlId, qint64 nowNs, qint64 lastReportNs, quint64 changeReports, Board& board)
+{
+    const qint64 jitterUs = (nowNs - board.dueNs) / 1000;
+    const qint64 intervalNs = static_cast<qint64>(board.intervalMs) * 1000000;
+    if (lastReportNs > 0 && nowNs - lastReportNs < intervalNs / 2) {
+        m_skippedFresh.fetch_add(1, std::memory_order_relaxed);
+    } else if (JFPlatePool::instance().post(controlId, [](JFPlate& plate) { plate.pollInputs(); })) {
+        m_sent.fetch_add(1, std::memory_order_relaxed);
+        m_jitterTotalUs.fetch_add(jitterUs, std::memory_order_relaxed);
+        if (jitterUs > m_jitterMaxUs.load(std::memory_order_relaxed)) {
+            m_jitterMaxUs.store(jitterUs, std::memory_order_relaxed);
+        }
+    } else {
+        m_notQueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // faster while inputs keep changing, slower once they have been quiet for a while
+    if (m_adaptive) {
+        if (changeReports != board.lastChangeReports) {
+            board.intervalMs = qMax(m_minIntervalMs, board.intervalMs / 2);
+            board.quietPolls = 0;
+        } else if (++board.quietPolls >= kQuietPollsBeforeSlowdown) {
+            board.intervalMs = qMin(m_maxIntervalMs, board.intervalMs + board.intervalMs / 4 + 1);
+            board.quietPolls = 0;
+        }
+    }
+    board.lastChangeReports = changeReports;
+}
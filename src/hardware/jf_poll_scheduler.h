@@ -0,0 +1,93 @@
+#ifndef JF_POLL_SCHEDULER_H
+#define JF_POLL_SCHEDULER_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <queue>
+#include <vector>
+
+class QThread;
+
+/**
+ * @brief Central DI poll scheduler for all JFPlate sessions
+ *
+ * One thread keeps every board's next due time in a min-heap and posts
+ * setGetDI to the board when it falls due. Initial due times are spread
+ * evenly over the base interval and each board is rescheduled relative to
+ * its own previous due time, so polls stay staggered instead of firing in
+ * the same tick. A board whose reports keep changing is polled faster (down
+ * to the minimum interval), a quiet one slower (up to the maximum). A poll
+ * is skipped while the last DI report, e.g. a getEventUp, is younger than
+ * half the board's interval.
+ */
+class JFPollScheduler
+{
+public:
+    static JFPollScheduler& instance();
+
+    /**
+     * @param intervalMs base poll interval ([HardIO] ReadInterval), <= 0 disables polling
+     */
+    bool initialize(int intervalMs, int minIntervalMs, int maxIntervalMs, bool adaptive);
+    void cleanup();
+
+    /**
+     * @brief Polls sent/skipped, interval spread and dispatch jitter
+     */
+    QString statsSummary() const;
+
+private:
+    struct Board {
+        qint64 dueNs = 0;
+        int intervalMs = 0;
+        quint64 lastChangeReports = 0;
+        int quietPolls = 0;
+    };
+
+    struct Due {
+        qint64 dueNs = 0;
+        int controlId = 0;
+        bool operator>(const Due& other) const { return dueNs > other.dueNs; }
+    };
+
+    JFPollScheduler() = default;
+    ~JFPollScheduler();
+
+    JFPollScheduler(const JFPollScheduler&) = delete;
+    JFPollScheduler& operator=(const JFPollScheduler&) = delete;
+
+    void run();
+    void syncBoards(qint64 nowNs);
+    void pollBoard(int controlId, qint64 nowNs);
+
+    /**
+     * @brief Poll a board whose session exists and adapt its interval to input activity
+     */
+    void pollLive(int controlId, qint64 nowNs, qint64 lastReportNs, quint64 changeReports, Board& board);
+
+    int m_intervalMs = 120;
+    int m_minIntervalMs = 60;
+    int m_maxIntervalMs = 1000;
+    bool m_adaptive = true;
+
+    QThread* m_thread = nullptr;
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    bool m_stopping = false;
+
+    // owned by the scheduler thread; m_mutex only for statsSummary()
+    QHash<int, Board> m_boards;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> m_heap;
+    qint64 m_lastSyncNs = 0;
+
+    std::atomic<quint64> m_sent{0};
+    std::atomic<quint64> m_skippedFresh{0};
+    std::atomic<quint64> m_notQueued{0};
+    std::atomic<qint64> m_jitterTotalUs{0};
+    std::atomic<qint64> m_jitterMaxUs{0};
+};
+
+#endif // JF_POLL_SCHEDULER_H
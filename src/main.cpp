@@ -7,6 +7,15 @@
 #include "logging/logger.h"
 #include "core/startup.h"
 #include "core/global_data.h"
+#include "core/meta_manage.h"
+#include "core/md_history.h"
+#include "core/change_detector.h"
+#include "hardware/jf_plate_pool.h"
+#include "hardware/jf_poll_scheduler.h"
+#include "hardware/can_interface.h"
+#include "database/md_persister.h"
+#include "database/statement_cache.h"
+#include "database/db_queries.h"
 
 // Constants
 const char* SEMAPHORE_NAME = "OnlyOneNENet_B93EAD1B0CFFE537FBC2779";
@@ -162,10 +171,50 @@ int main(int argc, char *argv[])
             break;
         } else if (command == "status") {
             GlobalData::instance().logState("CLI Status Check");
+        } else if (command == "pipeline") {
+            QStringList lines = MetaManage::instance().pipelineReport();
+            lines << MdPersister::instance().statsSummary();
+            lines << MdHistory::instance().statsSummary();
+            lines << ChangeDetector::instance().statsSummary();
+            lines << JFPlatePool::instance().linkSummary();
+            lines << JFPlatePool::instance().ioReport();
+            lines << JFPollScheduler::instance().statsSummary();
+            lines << CANInterface::instance().statsSummary();
+            for (const QString& line : lines) {
+                std::cout << line.toStdString() << "\n";
+                Logger::instance().info(line);
+            }
+        } else if (command == "boards" || command.startsWith("boards ")) {
+            // boards [N]: the N slowest boards, default 20
+            const int limit = command.size() > 7 ? command.mid(7).trimmed().toInt() : 20;
+            for (const QString& line : JFPlatePool::instance().boardReport(limit)) {
+                std::cout << line.toStdString() << "\n";
+                Logger::instance().info(line);
+            }
+        } else if (command == "dbstats") {
+            const QString line = StatementCache::instance().statsSummary();
+            std::cout << line.toStdString() << "\n";
+            Logger::instance().info(line);
+        } else if (command == "dbbench") {
+            for (const QString& line : DBQueries::benchmarkUpdates()) {
+                std::cout << line.toStdString() << "\n";
+                Logger::instance().info(line);
+            }
+        } else if (command == "reload") {
+            if (MetaManage::instance().requestReload()) {
+                std::cout << "Reload queued, see log for applied changes.\n";
+            } else {
+                std::cout << "Reload failed, see log.\n";
+            }
         } else if (command == "help") {
             std::cout << "Available commands:\n";
             std::cout << "  quit/exit - Exit application\n";
             std::cout << "  status    - Show application status\n";
+            std::cout << "  pipeline  - Show message pipeline queue depths and latency\n";
+            std::cout << "  boards [N]- Show the N slowest boards (RTT, reconnects, traffic), default 20\n";
+            std::cout << "  dbstats   - Show prepared statement cache counters\n";
+            std::cout << "  dbbench   - Time bulk md value updates on a temporary table\n";
+            std::cout << "  reload    - Apply plate/md table changes without restart\n";
             std::cout << "  help      - Show this help message\n";
         }
     }
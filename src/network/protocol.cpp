@@ -81,6 +81,26 @@ QJsonObject Protocol::messageToJson(const Message& msg)
     return obj;
 }
 
+Protocol::HistoryQuery Protocol::parseHistoryQuery(const QJsonObject& obj)
+{
+    HistoryQuery query;
+
+    const QJsonArray ids = obj.value("ids").toArray();
+    for (const QJsonValue& id : ids) {
+        if (id.isDouble()) {
+            query.ids.append(id.toInt());
+        }
+    }
+
+    // epoch milliseconds do not fit toInt()
+    query.from = static_cast<qint64>(obj.value("from").toDouble(0));
+    query.to = static_cast<qint64>(obj.value("to").toDouble(0));
+    query.step = static_cast<qint64>(obj.value("step").toDouble(0));
+    query.agg = obj.value("agg").toString("raw");
+    query.limit = obj.value("limit").toInt(query.limit);
+    return query;
+}
+
 QString Protocol::getMessageType(const QString& msgStr)
 {
     QJsonObject obj = parseJsonMessage(msgStr);
@@ -97,6 +117,7 @@ Protocol::MessageType Protocol::getMessageTypeEnum(const QString& typeStr)
     if (typeStr == "imitateDate") return MSG_IMITATE_DATE;
     if (typeStr == "buttonGrade") return MSG_BUTTON_GRADE;
     if (typeStr == "endGrade") return MSG_END_GRADE;
+    if (typeStr == "historyQuery") return MSG_HISTORY_QUERY;
 
     return MSG_UNKNOWN;
 }
@@ -112,6 +133,7 @@ QString Protocol::getMessageTypeString(MessageType type)
         case MSG_IMITATE_DATE: return "imitateDate";
         case MSG_BUTTON_GRADE: return "buttonGrade";
         case MSG_END_GRADE: return "endGrade";
+        case MSG_HISTORY_QUERY: return "historyQuery";
         default: return "unknown";
     }
 }
@@ -32,6 +32,8 @@ namespace Protocol
         MSG_BUTTON_GRADE = 16,  // Button grade (buttonGrade)
         MSG_END_GRADE = 17,     // End grade (endGrade)
 
+        MSG_HISTORY_QUERY = 18, // md value history (historyQuery)
+
         MSG_UNKNOWN = 99
     };
 
@@ -72,6 +74,22 @@ namespace Protocol
         double score = 0.0;            // Score
     };
 
+    /**
+     * @brief md value history request
+     *
+     * {"t":"historyQuery","ids":[..],"from":ms,"to":ms,"step":ms,"agg":"raw","limit":n}
+     * agg is raw | min | max | avg | last | count; step 0 means one window
+     * over [from, to] (raw: the samples themselves).
+     */
+    struct HistoryQuery {
+        QList<int> ids;
+        qint64 from = 0;                // epoch ms, 0: to - 10 minutes
+        qint64 to = 0;                  // epoch ms, 0: now
+        qint64 step = 0;                // downsampling window in ms
+        QString agg = "raw";
+        int limit = 2000;               // points per id, newest kept
+    };
+
     /**
      * @brief Parse JSON message string to QJsonObject
      */
@@ -107,6 +125,11 @@ namespace Protocol
      */
     QJsonObject messageToJson(const Message& msg);
 
+    /**
+     * @brief Parse a historyQuery message
+     */
+    HistoryQuery parseHistoryQuery(const QJsonObject& obj);
+
     /**
      * @brief Get message type string from message
      */
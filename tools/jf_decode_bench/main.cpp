@@ -0,0 +1,271 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QVector>
+#include <cstdio>
+#include <cstring>
+#include "jf_frame.h"
+
+namespace {
+
+constexpr uchar kSync0 = 0xEA;
+
+struct ExpectedFrame
+{
+    quint8 command = 0;
+    quint16 serial = 0;
+    bool slave = false;
+    QByteArray payload;
+};
+
+/**
+ * @brief Input stream plus the counters the decoder must report for it
+ */
+struct Stream
+{
+    QByteArray bytes;
+    QVector<ExpectedFrame> frames;
+    quint64 garbageBytes = 0;
+    quint64 resyncs = 0;
+    quint64 badCommands = 0;
+    quint64 badChecksums = 0;
+};
+
+/**
+ * @brief Random bytes that never contain 0xEA, so they cannot start a sync
+ */
+QByteArray cleanNoise(QRandomGenerator& random, int length)
+{
+    QByteArray bytes(length, Qt::Uninitialized);
+    for (int i = 0; i < length; ++i) {
+        uchar byte = static_cast<uchar>(random.bounded(255));
+        bytes[i] = static_cast<char>(byte >= kSync0 ? byte + 1 : byte);
+    }
+    return bytes;
+}
+
+quint8 knownCommand(QRandomGenerator& random)
+{
+    for (;;) {
+        const quint8 command = static_cast<quint8>(random.bounded(256));
+        if (JFFrameDecoder::isKnownCommand(command)) {
+            return command;
+        }
+    }
+}
+
+quint8 unknownCommand(QRandomGenerator& random)
+{
+    for (;;) {
+        const quint8 command = static_cast<quint8>(random.bounded(256));
+        if (!JFFrameDecoder::isKnownCommand(command) && command != kSync0) {
+            return command;
+        }
+    }
+}
+
+/**
+ * @brief Noise burst: clean bytes first, then maybe a false sync and a slave frame with a bad sum
+ *
+ * Every burst follows a good frame and opens with a clean byte, so it costs
+ * exactly one resync; apart from the planted sync no byte is 0xEA.
+ */
+void appendBurst(QRandomGenerator& random, int maxBytes, Stream& stream)
+{
+    QByteArray burst = cleanNoise(random, 1 + random.bounded(qMax(1, maxBytes)));
+    ++stream.resyncs;
+
+    if (random.bounded(4) == 0) {
+        // EA AE, master address, a command byte the decoder does not know
+        QByteArray falseSync;
+        falseSync.append(static_cast<char>(0xEA));
+        falseSync.append(static_cast<char>(0xAE));
+        falseSync.append(static_cast<char>(0x01));
+        falseSync.append(static_cast<char>(unknownCommand(random)));
+        falseSync.append(cleanNoise(random, 3));
+        burst.append(falseSync);
+        ++stream.badCommands;
+    }
+
+    if (random.bounded(4) == 0) {
+        QByteArray corrupt;
+        do {
+            corrupt = JFFrameDecoder::encodeSlave(knownCommand(random), cleanNoise(random, random.bounded(32)));
+            const int last = corrupt.size() - 1;
+            corrupt[last] = static_cast<char>(static_cast<uchar>(corrupt[last]) + 1 + random.bounded(255));
+        } while (corrupt.indexOf(static_cast<char>(kSync0), 1) >= 0);
+        burst.append(corrupt);
+        ++stream.badChecksums;
+    }
+
+    stream.garbageBytes += static_cast<quint64>(burst.size());
+    stream.bytes.append(burst);
+}
+
+Stream buildStream(QRandomGenerator& random, int frameCount, double noiseRate, int maxNoise)
+{
+    Stream stream;
+    stream.frames.reserve(frameCount);
+    quint16 serial = 0;
+    for (int i = 0; i < frameCount; ++i) {
+        // noise only between frames: the stream opens and closes with a good frame
+        if (i > 0 && random.generateDouble() < noiseRate) {
+            appendBurst(random, maxNoise, stream);
+        }
+
+        ExpectedFrame expected;
+        expected.command = knownCommand(random);
+        expected.slave = random.bounded(8) == 0;
+        // mostly small reports, now and then a full-size one
+        const int length = random.bounded(16) == 0 ? JFFrameDecoder::kMaxPayload : random.bounded(64);
+        expected.payload.resize(length);
+        for (int b = 0; b < length; ++b) {
+            expected.payload[b] = static_cast<char>(random.bounded(256));
+        }
+        if (expected.slave) {
+            stream.bytes.append(JFFrameDecoder::encodeSlave(expected.command, expected.payload));
+        } else {
+            expected.serial = ++serial;
+            stream.bytes.append(JFFrameDecoder::encode(expected.command, expected.serial, expected.payload));
+        }
+        stream.frames.append(expected);
+    }
+    return stream;
+}
+
+bool sameFrame(const JFFrameView& frame, const ExpectedFrame& expected)
+{
+    return frame.isSlave() == expected.slave
+        && frame.command() == expected.command
+        && frame.serial() == expected.serial
+        && frame.payloadSize() == expected.payload.size()
+        && std::memcmp(frame.payloadData(), expected.payload.constData(), static_cast<size_t>(frame.payloadSize())) == 0;
+}
+
+/**
+ * @brief Feed the stream in random chunks, the way socket reads arrive
+ * @return frames decoded; firstMismatch is -1 if every frame matched
+ */
+int decodeStream(const Stream& stream, JFFrameDecoder& decoder, QRandomGenerator& random, int maxChunk,
+                 int& firstMismatch)
+{
+    firstMismatch = -1;
+    int decoded = 0;
+    int offset = 0;
+    JFFrameView frame;
+    while (offset < stream.bytes.size()) {
+        int space = 0;
+        char* span = decoder.writeSpan(space);
+        const int chunk = qMin(qMin(space, 1 + random.bounded(maxChunk)), stream.bytes.size() - offset);
+        std::memcpy(span, stream.bytes.constData() + offset, static_cast<size_t>(chunk));
+        decoder.commit(chunk);
+        offset += chunk;
+
+        while (decoder.next(frame)) {
+            if (firstMismatch < 0 && (decoded >= stream.frames.size() || !sameFrame(frame, stream.frames[decoded]))) {
+                firstMismatch = decoded;
+            }
+            ++decoded;
+        }
+    }
+    return decoded;
+}
+
+bool check(const char* name, quint64 actual, quint64 expected)
+{
+    if (actual == expected) {
+        return true;
+    }
+    std::fprintf(stderr, "%s: decoder reported %llu, expected %llu\n", name,
+                 static_cast<unsigned long long>(actual), static_cast<unsigned long long>(expected));
+    return false;
+}
+
+} // namespace
+
+/**
+ * @brief NENET_JFDecodeBench - JFFrameDecoder throughput and resync check
+ *
+ * Builds a stream of valid master/slave frames with noise bursts between
+ * them (random bytes, false EA AE syncs, slave frames with a bad sum),
+ * feeds it in random chunks through a small ring so frames wrap, and
+ * checks every decoded frame and each decoder counter against what was
+ * planted. Exits non-zero on any mismatch.
+ */
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("NENET_JFDecodeBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("JF frame decoder benchmark over noisy input");
+    parser.addHelpOption();
+
+    const QCommandLineOption framesOpt("frames", "Valid frames in the stream.", "n", "200000");
+    const QCommandLineOption noiseOpt("noise", "Probability of a noise burst before a frame (0..1).", "p", "0.2");
+    const QCommandLineOption noiseBytesOpt("noise-bytes", "Maximum clean noise bytes per burst.", "n", "64");
+    const QCommandLineOption chunkOpt("chunk", "Maximum bytes per simulated socket read.", "n", "1460");
+    const QCommandLineOption ringOpt("ring", "Decoder ring capacity in bytes.", "n", "4096");
+    const QCommandLineOption roundsOpt("rounds", "Timed passes over the stream.", "n", "5");
+    const QCommandLineOption seedOpt("seed", "Random seed.", "n", "1");
+    parser.addOptions({framesOpt, noiseOpt, noiseBytesOpt, chunkOpt, ringOpt, roundsOpt, seedOpt});
+    parser.process(app);
+
+    const int frameCount = qMax(1, parser.value(framesOpt).toInt());
+    const double noiseRate = qBound(0.0, parser.value(noiseOpt).toDouble(), 1.0);
+    const int maxNoise = qMax(1, parser.value(noiseBytesOpt).toInt());
+    const int maxChunk = qMax(1, parser.value(chunkOpt).toInt());
+    const int ring = qMax(1, parser.value(ringOpt).toInt());
+    const int rounds = qMax(1, parser.value(roundsOpt).toInt());
+    const quint32 seed = parser.value(seedOpt).toUInt();
+
+    QRandomGenerator random(seed);
+    const Stream stream = buildStream(random, frameCount, noiseRate, maxNoise);
+    std::printf("stream: %d frames, %d bytes, %llu noise bytes (%llu bursts, %llu false syncs, %llu bad sums)\n",
+                stream.frames.size(), stream.bytes.size(),
+                static_cast<unsigned long long>(stream.garbageBytes),
+                static_cast<unsigned long long>(stream.resyncs),
+                static_cast<unsigned long long>(stream.badCommands),
+                static_cast<unsigned long long>(stream.badChecksums));
+
+    bool ok = true;
+    qint64 bestNs = 0;
+    for (int round = 0; round < rounds; ++round) {
+        JFFrameDecoder decoder(ring);
+        QRandomGenerator chunks(seed + static_cast<quint32>(round));
+        int firstMismatch = -1;
+
+        QElapsedTimer timer;
+        timer.start();
+        const int decoded = decodeStream(stream, decoder, chunks, maxChunk, firstMismatch);
+        const qint64 elapsedNs = timer.nsecsElapsed();
+        if (round == 0 || elapsedNs < bestNs) {
+            bestNs = elapsedNs;
+        }
+
+        if (round > 0) {
+            continue;   // counters are the same every pass
+        }
+        std::printf("decoder: %s\n", qPrintable(decoder.statsSummary()));
+        if (firstMismatch >= 0) {
+            std::fprintf(stderr, "frame %d decoded differently from what was encoded\n", firstMismatch);
+            ok = false;
+        }
+        ok = check("frames", static_cast<quint64>(decoded), static_cast<quint64>(stream.frames.size())) && ok;
+        ok = check("frame counter", decoder.frames(), static_cast<quint64>(stream.frames.size())) && ok;
+        ok = check("bytesIn", decoder.bytesIn(), static_cast<quint64>(stream.bytes.size())) && ok;
+        ok = check("garbage", decoder.garbageBytes(), stream.garbageBytes) && ok;
+        ok = check("resyncs", decoder.resyncs(), stream.resyncs) && ok;
+        ok = check("badCmd", decoder.badCommands(), stream.badCommands) && ok;
+        ok = check("badSum", decoder.badChecksums(), stream.badChecksums) && ok;
+        ok = check("buffered", static_cast<quint64>(decoder.buffered()), 0) && ok;
+    }
+
+    const double seconds = static_cast<double>(bestNs) / 1e9;
+    std::printf("best of %d: %.2f ms, %.1f MB/s, %.0f frames/s\n", rounds, seconds * 1e3,
+                seconds > 0 ? stream.bytes.size() / seconds / 1e6 : 0.0,
+                seconds > 0 ? stream.frames.size() / seconds : 0.0);
+    std::printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
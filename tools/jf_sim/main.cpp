@@ -0,0 +1,129 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include <cstdio>
+#include "sim_board.h"
+
+/**
+ * @brief NENET_JFSim - simulates N JF acquisition boards on local TCP ports
+ *
+ * Point the ne_plate_type controller rows (ip_addr/ip_port) at
+ * host:basePort..basePort+N-1 to run NENet against the simulator.
+ */
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("NENET_JFSim");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("JF acquisition board simulator for NENet load and latency tests");
+    parser.addHelpOption();
+
+    const QCommandLineOption boardsOpt("boards", "Number of simulated boards.", "n", "10");
+    const QCommandLineOption hostOpt("host", "Listen address.", "ip", "127.0.0.1");
+    const QCommandLineOption portOpt("port", "Port of the first board; board i uses port + i.", "port", "20000");
+    const QCommandLineOption threadsOpt("threads", "I/O threads the boards are spread over.", "n",
+                                        QString::number(qMax(1, QThread::idealThreadCount())));
+    const QCommandLineOption passwordOpt("password", "Login password expected from NENet.", "pwd", "1234567890abcdef");
+    const QCommandLineOption diOpt("di-modules", "16-channel DI modules per board.", "n", "2");
+    const QCommandLineOption doOpt("do-modules", "16-channel DO modules per board.", "n", "2");
+    const QCommandLineOption eventOpt("event-rate", "Spontaneous DI change events per board per second.", "rate", "0.2");
+    const QCommandLineOption latencyOpt("latency", "Reply latency in ms.", "ms", "0");
+    const QCommandLineOption jitterOpt("jitter", "Extra random reply latency, 0..ms.", "ms", "0");
+    const QCommandLineOption lossOpt("loss", "Probability that a reply is dropped (0..1).", "p", "0");
+    const QCommandLineOption garbageOpt("garbage", "Probability that a reply is preceded by noise bytes (0..1).", "p", "0");
+    const QCommandLineOption garbageBytesOpt("garbage-bytes", "Maximum noise burst length.", "n", "32");
+    const QCommandLineOption statsOpt("stats", "Statistics interval in seconds, 0 to disable.", "s", "5");
+    parser.addOptions({boardsOpt, hostOpt, portOpt, threadsOpt, passwordOpt, diOpt, doOpt, eventOpt,
+                       latencyOpt, jitterOpt, lossOpt, garbageOpt, garbageBytesOpt, statsOpt});
+    parser.process(app);
+
+    SimOptions options;
+    options.boards = qMax(1, parser.value(boardsOpt).toInt());
+    options.host = QHostAddress(parser.value(hostOpt));
+    options.basePort = static_cast<quint16>(parser.value(portOpt).toUInt());
+    options.threads = qBound(1, parser.value(threadsOpt).toInt(), options.boards);
+    options.password = parser.value(passwordOpt);
+    options.diModules = qBound(0, parser.value(diOpt).toInt(), 80);
+    options.doModules = qBound(0, parser.value(doOpt).toInt(), 16);
+    options.eventRate = parser.value(eventOpt).toDouble();
+    options.latencyMs = qMax(0, parser.value(latencyOpt).toInt());
+    options.jitterMs = qMax(0, parser.value(jitterOpt).toInt());
+    options.lossRate = qBound(0.0, parser.value(lossOpt).toDouble(), 1.0);
+    options.garbageRate = qBound(0.0, parser.value(garbageOpt).toDouble(), 1.0);
+    options.garbageBytes = qMax(1, parser.value(garbageBytesOpt).toInt());
+    const int statsSeconds = qMax(0, parser.value(statsOpt).toInt());
+
+    if (options.host.isNull() || options.basePort == 0 || options.basePort + options.boards > 65536) {
+        std::fprintf(stderr, "invalid --host or --port/--boards range\n");
+        return 1;
+    }
+
+    QList<QThread*> threads;
+    for (int i = 0; i < options.threads; ++i) {
+        QThread* thread = new QThread();
+        thread->setObjectName(QString("SimIO-%1").arg(i));
+        thread->start();
+        threads.append(thread);
+    }
+
+    QList<SimBoard*> boards;
+    for (int i = 0; i < options.boards; ++i) {
+        SimBoard* board = new SimBoard(i, options);
+        board->moveToThread(threads[i % threads.size()]);
+        QMetaObject::invokeMethod(board, &SimBoard::start, Qt::QueuedConnection);
+        boards.append(board);
+    }
+
+    std::printf("Simulating %d boards on %s:%u-%u over %d threads (latency %d+%d ms, loss %.3f, garbage %.3f)\n",
+                options.boards, qPrintable(options.host.toString()), options.basePort,
+                options.basePort + options.boards - 1, options.threads, options.latencyMs, options.jitterMs,
+                options.lossRate, options.garbageRate);
+    std::fflush(stdout);
+
+    QTimer statsTimer;
+    QElapsedTimer uptime;
+    uptime.start();
+    quint64 lastIn = 0;
+    quint64 lastOut = 0;
+    if (statsSeconds > 0) {
+        QObject::connect(&statsTimer, &QTimer::timeout, [&] {
+            const SimStats& s = SimStats::instance();
+            const quint64 in = s.framesIn.load();
+            const quint64 out = s.framesOut.load();
+            std::printf("[%6llds] conn=%llu login=%llu fail=%llu in=%llu (%.0f/s) out=%llu (%.0f/s) "
+                        "setDO=%llu setCom=%llu events=%llu lost=%llu noise=%lluB malformed=%llu\n",
+                        static_cast<long long>(uptime.elapsed() / 1000),
+                        static_cast<unsigned long long>(s.connections.load()),
+                        static_cast<unsigned long long>(s.logins.load()),
+                        static_cast<unsigned long long>(s.loginFailures.load()),
+                        static_cast<unsigned long long>(in), static_cast<double>(in - lastIn) / statsSeconds,
+                        static_cast<unsigned long long>(out), static_cast<double>(out - lastOut) / statsSeconds,
+                        static_cast<unsigned long long>(s.doCommands.load()),
+                        static_cast<unsigned long long>(s.comCommands.load()),
+                        static_cast<unsigned long long>(s.events.load()),
+                        static_cast<unsigned long long>(s.lost.load()),
+                        static_cast<unsigned long long>(s.garbageBytes.load()),
+                        static_cast<unsigned long long>(s.malformedIn.load()));
+            std::fflush(stdout);
+            lastIn = in;
+            lastOut = out;
+        });
+        statsTimer.start(statsSeconds * 1000);
+    }
+
+    const int rc = app.exec();
+
+    for (SimBoard* board : boards) {
+        QMetaObject::invokeMethod(board, [board] { delete board; }, Qt::BlockingQueuedConnection);
+    }
+    for (QThread* thread : threads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    return rc;
+}
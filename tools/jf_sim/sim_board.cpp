@@ -0,0 +1,271 @@
+#include "sim_board.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QPointer>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QtMath>
+#include <cstdio>
+
+namespace {
+
+// command bytes, see JFPlate::JFPlateFlag
+constexpr quint8 kGetRandomCode = 0x00;
+constexpr quint8 kSetVerifyPassword = 0x01;
+constexpr quint8 kGetVerifyReply = 0x03;
+constexpr quint8 kSetGetDI = 0x10;
+constexpr quint8 kSetGetDO = 0x11;
+constexpr quint8 kSetDO = 0x21;
+constexpr quint8 kSetCom = 0x28;
+constexpr quint8 kGetEventUp = 0x30;
+constexpr quint8 kGetDI = 0x80;
+constexpr quint8 kGetDO = 0x81;
+constexpr quint8 kGetSetDO = 0x91;
+constexpr quint8 kGetSetCom = 0x98;
+
+qint64 nowMs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+} // namespace
+
+SimStats& SimStats::instance()
+{
+    static SimStats s_instance;
+    return s_instance;
+}
+
+SimBoard::SimBoard(int index, const SimOptions& options, QObject* parent)
+    : QObject(parent)
+    , m_index(index)
+    , m_port(static_cast<quint16>(options.basePort + index))
+    , m_options(options)
+    , m_random(static_cast<quint32>(0x4A46u + index))
+    , m_di(qMax(0, options.diModules), 0)
+    , m_do(qMax(0, options.doModules), 0)
+{
+}
+
+SimBoard::~SimBoard() = default;
+
+void SimBoard::start()
+{
+    m_server = new QTcpServer(this);
+    connect(m_server, &QTcpServer::newConnection, this, &SimBoard::onNewConnection);
+    if (!m_server->listen(m_options.host, m_port)) {
+        std::fprintf(stderr, "board %d: listen on %s:%u failed: %s\n", m_index,
+                     qPrintable(m_options.host.toString()), m_port, qPrintable(m_server->errorString()));
+        return;
+    }
+
+    m_eventTimer = new QTimer(this);
+    m_eventTimer->setSingleShot(true);
+    connect(m_eventTimer, &QTimer::timeout, this, &SimBoard::onEventTick);
+}
+
+void SimBoard::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        if (m_client) {
+            m_client->disconnect(this);
+            m_client->abort();
+            m_client->deleteLater();
+        }
+        m_client = socket;
+        connect(m_client, &QTcpSocket::readyRead, this, &SimBoard::onReadyRead);
+        connect(m_client, &QTcpSocket::disconnected, this, &SimBoard::onDisconnected);
+        SimStats::instance().connections.fetch_add(1, std::memory_order_relaxed);
+
+        m_decoder.reset();
+        m_authenticated = false;
+        m_lastDeliveryMs = 0;
+        m_randomCode.resize(16);
+        for (int i = 0; i < m_randomCode.size(); ++i) {
+            m_randomCode[i] = static_cast<char>(m_random.bounded(256));
+        }
+        reply(kGetRandomCode, 0, m_randomCode);
+    }
+}
+
+void SimBoard::onDisconnected()
+{
+    if (m_client == sender()) {
+        m_client->deleteLater();
+        m_client = nullptr;
+        m_authenticated = false;
+        if (m_eventTimer) {
+            m_eventTimer->stop();
+        }
+    }
+}
+
+void SimBoard::onReadyRead()
+{
+    if (!m_client) {
+        return;
+    }
+
+    const quint64 malformedBefore = m_decoder.malformed();
+    for (;;) {
+        int space = 0;
+        char* span = m_decoder.writeSpan(space);
+        const qint64 got = space > 0 ? m_client->read(span, space) : 0;
+        if (got <= 0) {
+            break;
+        }
+        m_decoder.commit(static_cast<int>(got));
+
+        JFFrameView frame;
+        while (m_decoder.next(frame)) {
+            SimStats::instance().framesIn.fetch_add(1, std::memory_order_relaxed);
+            handleFrame(frame);
+        }
+    }
+    SimStats::instance().malformedIn.fetch_add(m_decoder.malformed() - malformedBefore, std::memory_order_relaxed);
+}
+
+void SimBoard::handleFrame(const JFFrameView& frame)
+{
+    SimStats& stats = SimStats::instance();
+
+    if (frame.command() == kSetVerifyPassword) {
+        QByteArray pwd = m_options.password.toUtf8().left(16);
+        pwd.append(QByteArray(16 - pwd.size(), '\0'));
+        const QByteArray expected = QCryptographicHash::hash(m_randomCode + pwd, QCryptographicHash::Md5);
+        if (frame.payload() != expected) {
+            stats.loginFailures.fetch_add(1, std::memory_order_relaxed);
+            m_client->disconnectFromHost();
+            return;
+        }
+        m_authenticated = true;
+        stats.logins.fetch_add(1, std::memory_order_relaxed);
+        reply(kGetVerifyReply, frame.serial(), QByteArray(1, '\x01'));
+        scheduleEvent();
+        return;
+    }
+    if (!m_authenticated) {
+        return;
+    }
+
+    switch (frame.command()) {
+    case kSetGetDI:
+        reply(kGetDI, frame.serial(), stateReport(m_di));
+        break;
+    case kSetGetDO:
+        reply(kGetDO, frame.serial(), stateReport(m_do));
+        break;
+    case kSetDO:
+        stats.doCommands.fetch_add(1, std::memory_order_relaxed);
+        applyOutputs(frame);
+        reply(kGetSetDO, frame.serial(), QByteArray(1, '\x01'));
+        break;
+    case kSetCom:
+        stats.comCommands.fetch_add(1, std::memory_order_relaxed);
+        reply(kGetSetCom, 0, QByteArray(1, '\x01'));
+        break;
+    default:
+        break;
+    }
+}
+
+void SimBoard::applyOutputs(const JFFrameView& frame)
+{
+    // 0x02, then (hard addr, bits 15..8, bits 7..0) per module, as in stateReport()
+    const uchar* data = frame.payloadData();
+    for (int i = 1; i + 2 < frame.payloadSize(); i += 3) {
+        const int module = data[i] - 1;
+        if (module < 0 || module >= m_do.size()) {
+            continue;
+        }
+        m_do[module] = static_cast<quint16>((data[i + 1] << 8) | data[i + 2]);
+    }
+}
+
+QByteArray SimBoard::stateReport(const QVector<quint16>& modules) const
+{
+    QByteArray payload;
+    payload.reserve(modules.size() * 3);
+    for (int i = 0; i < modules.size(); ++i) {
+        payload.append(static_cast<char>(i + 1));
+        payload.append(static_cast<char>(modules[i] >> 8));
+        payload.append(static_cast<char>(modules[i] & 0xFF));
+    }
+    return payload;
+}
+
+void SimBoard::reply(quint8 command, quint16 serial, const QByteArray& payload)
+{
+    SimStats& stats = SimStats::instance();
+    if (m_options.lossRate > 0.0 && m_random.generateDouble() < m_options.lossRate) {
+        stats.lost.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    QByteArray bytes;
+    if (m_options.garbageRate > 0.0 && m_random.generateDouble() < m_options.garbageRate) {
+        const int noise = 1 + m_random.bounded(qMax(1, m_options.garbageBytes));
+        bytes.resize(noise);
+        for (int i = 0; i < noise; ++i) {
+            bytes[i] = static_cast<char>(m_random.bounded(256));
+        }
+        stats.garbageBytes.fetch_add(static_cast<quint64>(noise), std::memory_order_relaxed);
+    }
+    bytes.append(JFFrameDecoder::encode(command, serial, payload));
+    stats.framesOut.fetch_add(1, std::memory_order_relaxed);
+
+    const int delay = m_options.latencyMs + (m_options.jitterMs > 0 ? m_random.bounded(m_options.jitterMs + 1) : 0);
+    if (delay <= 0 && m_lastDeliveryMs <= nowMs()) {
+        transmit(bytes);
+        return;
+    }
+
+    // jitter must not reorder replies on the stream
+    const qint64 deliverAt = qMax(nowMs() + delay, m_lastDeliveryMs);
+    m_lastDeliveryMs = deliverAt;
+    QPointer<QTcpSocket> client = m_client;
+    QTimer::singleShot(static_cast<int>(deliverAt - nowMs()), this, [this, client, bytes] {
+        if (client && client == m_client) {
+            transmit(bytes);
+        }
+    });
+}
+
+void SimBoard::transmit(const QByteArray& bytes)
+{
+    if (m_client && m_client->state() == QAbstractSocket::ConnectedState) {
+        m_client->write(bytes);
+    }
+}
+
+void SimBoard::scheduleEvent()
+{
+    if (!m_eventTimer || m_options.eventRate <= 0.0 || m_di.isEmpty()) {
+        return;
+    }
+
+    // exponential inter-arrival times: events form a Poisson process
+    const double u = qMax(1e-9, m_random.generateDouble());
+    const int waitMs = qBound(1, static_cast<int>(-qLn(u) / m_options.eventRate * 1000.0), 3600 * 1000);
+    m_eventTimer->start(waitMs);
+}
+
+void SimBoard::onEventTick()
+{
+    if (!m_authenticated || m_di.isEmpty()) {
+        return;
+    }
+
+    const int module = m_random.bounded(m_di.size());
+    m_di[module] ^= static_cast<quint16>(1u << m_random.bounded(16));
+
+    QByteArray payload;
+    payload.append(static_cast<char>(module + 1));
+    payload.append(static_cast<char>(m_di[module] >> 8));
+    payload.append(static_cast<char>(m_di[module] & 0xFF));
+    SimStats::instance().events.fetch_add(1, std::memory_order_relaxed);
+    reply(kGetEventUp, 0, payload);
+
+    scheduleEvent();
+}
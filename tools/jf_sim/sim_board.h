@@ -0,0 +1,114 @@
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QHostAddress>
+#include <QRandomGenerator>
+#include <atomic>
+#include "jf_frame.h"
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+/**
+ * @brief Simulator settings shared by all boards
+ */
+struct SimOptions
+{
+    QHostAddress host = QHostAddress::LocalHost;
+    quint16 basePort = 20000;       // board i listens on basePort + i
+    int boards = 10;
+    int threads = 1;
+    QString password = "1234567890abcdef";
+    int diModules = 2;              // 16-channel DI modules per board
+    int doModules = 2;              // 16-channel DO modules per board
+    double eventRate = 0.2;         // spontaneous getEventUp per board per second
+    int latencyMs = 0;              // added to every reply
+    int jitterMs = 0;               // uniform 0..jitter on top of latency
+    double lossRate = 0.0;          // probability a reply is not sent
+    double garbageRate = 0.0;       // probability a reply is preceded by noise
+    int garbageBytes = 32;          // noise burst length, 1..garbageBytes
+};
+
+/**
+ * @brief Process-wide simulator counters
+ */
+struct SimStats
+{
+    std::atomic<quint64> connections{0};
+    std::atomic<quint64> logins{0};
+    std::atomic<quint64> loginFailures{0};
+    std::atomic<quint64> framesIn{0};
+    std::atomic<quint64> framesOut{0};
+    std::atomic<quint64> doCommands{0};
+    std::atomic<quint64> comCommands{0};
+    std::atomic<quint64> events{0};
+    std::atomic<quint64> lost{0};
+    std::atomic<quint64> garbageBytes{0};
+    std::atomic<quint64> malformedIn{0};
+
+    static SimStats& instance();
+};
+
+/**
+ * @brief One simulated JF acquisition board on its own TCP port
+ *
+ * Speaks the board side of the JF protocol: sends the random-code
+ * challenge on connect, checks the MD5 password answer, reports DI/DO
+ * state on setGetDI/setGetDO, applies setDO and acknowledges setDO/setCom
+ * with the request's serial, and raises getEventUp for random DI changes.
+ * DI/DO reports carry one (module address, bits 15..8, bits 7..0) record
+ * per 16-channel module. A new connection replaces the current one.
+ */
+class SimBoard : public QObject
+{
+    Q_OBJECT
+
+public:
+    SimBoard(int index, const SimOptions& options, QObject* parent = nullptr);
+    ~SimBoard() override;
+
+    quint16 port() const { return m_port; }
+
+public slots:
+    /**
+     * @brief Start listening; call on the board's thread
+     */
+    void start();
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void onEventTick();
+
+private:
+    void handleFrame(const JFFrameView& frame);
+    void applyOutputs(const JFFrameView& frame);
+    QByteArray stateReport(const QVector<quint16>& modules) const;
+    void reply(quint8 command, quint16 serial, const QByteArray& payload);
+    void transmit(const QByteArray& bytes);
+    void scheduleEvent();
+
+    int m_index = 0;
+    quint16 m_port = 0;
+    SimOptions m_options;
+    QRandomGenerator m_random;
+
+    QTcpServer* m_server = nullptr;
+    QTcpSocket* m_client = nullptr;
+    QTimer* m_eventTimer = nullptr;
+    JFFrameDecoder m_decoder{16 * 1024};
+
+    QByteArray m_randomCode;
+    bool m_authenticated = false;
+    qint64 m_lastDeliveryMs = 0;    // keeps delayed replies in order
+
+    QVector<quint16> m_di;
+    QVector<quint16> m_do;
+};
+
+#endif // SIM_BOARD_H